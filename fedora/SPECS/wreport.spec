@@ -23,7 +23,7 @@ BuildRequires: /usr/bin/rst2html
 Summary: Tools for working with weather reports
 Group: Applications/Meteo
 Requires: lib%{name}-common
-Requires: lib%{name}3 = %{?epoch:%epoch:}%{version}-%{release}
+Requires: lib%{name}4 = %{?epoch:%epoch:}%{version}-%{release}
 
 %description
  libwreport is a C++ library to read and write weather reports in BUFR and CREX
@@ -32,12 +32,12 @@ Requires: lib%{name}3 = %{?epoch:%epoch:}%{version}-%{release}
 The tools provide simple weather bulletin handling functions
 
 
-%package -n lib%{name}3
+%package -n lib%{name}4
 Summary: shared library for working with weather reports
 Group: Applications/Meteo
 Requires: lib%{name}-common = %{?epoch:%epoch:}%{version}-%{release}
 
-%description -n lib%{name}3
+%description -n lib%{name}4
  libwreport is a C++ library to read and write weather reports in BUFR and CREX
  formats.
  
@@ -67,7 +67,7 @@ libwreport is a C++ library to read and write weather reports in BUFR and CREX
 %package -n lib%{name}-devel
 Summary:  Library for working with (coded) weather reports
 Group: Applications/Meteo
-Requires: lib%{name}3 = %{?epoch:%epoch:}%{version}-%{release}
+Requires: lib%{name}4 = %{?epoch:%epoch:}%{version}-%{release}
 
 %description -n lib%{name}-devel
 libwreport is a C++ library to read and write weather reports in BUFR and CREX
@@ -87,7 +87,7 @@ libwreport is a C++ library to read and write weather reports in BUFR and CREX
 %package -n python3-%{name}3
 Summary: shared library for working with weather reports
 Group: Applications/Meteo
-Requires: lib%{name}3 = %{?epoch:%epoch:}%{version}-%{release}
+Requires: lib%{name}4 = %{?epoch:%epoch:}%{version}-%{release}
 
 %description -n python3-%{name}3
 libwreport is a C++ library to read and write weather reports in BUFR and CREX
@@ -115,8 +115,9 @@ libwreport is a C++ library to read and write weather reports in BUFR and CREX
 %defattr(-,root,root,-)
 %{_bindir}/wrep
 %{_bindir}/wrep-importtable
+%{_bindir}/wrep-compiletable
 
-%files -n lib%{name}3
+%files -n lib%{name}4
 %defattr(-,root,root,-)
 %{_libdir}/libwreport.so.*
 
@@ -20,15 +20,55 @@
  */
 
 #include "options.h"
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
 #include <wreport/bulletin.h>
+#include <wreport/scanner.h>
 
 using namespace wreport;
 
 namespace {
 
+// Read all messages from standard input, handling each one as soon as it
+// has been received
+void read_stdin_raw(const Options& opts, RawHandler& handler)
+{
+    StreamScanner scanner(opts.crex ? StreamScanner::CREX : StreamScanner::BUFR,
+                          [&](const ScannedMessage& msg) {
+                              std::string raw_data((const char*)msg.data,
+                                                   msg.size);
+                              if (opts.crex)
+                                  handler.handle_raw_crex(raw_data, "-",
+                                                          msg.offset);
+                              else
+                                  handler.handle_raw_bufr(raw_data, "-",
+                                                          msg.offset);
+                          });
+
+    char buf[65536];
+    while (true)
+    {
+        ssize_t count = read(0, buf, sizeof(buf));
+        if (count < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            throw error_system("cannot read from standard input");
+        }
+        if (count == 0)
+            break;
+        scanner.feed(buf, count);
+    }
+    scanner.finish();
+}
+
 // Read all BUFR messages from a file
 void read_bufr_raw(const Options& opts, const char* fname, RawHandler& handler)
 {
+    if (strcmp(fname, "-") == 0)
+        return read_stdin_raw(opts, handler);
+
     // Open the input file
     FILE* in = fopen(fname, "rb");
     if (in == NULL)
@@ -72,6 +112,9 @@ void read_bufr_raw(const Options& opts, const char* fname, RawHandler& handler)
  */
 void read_crex_raw(const Options& opts, const char* fname, RawHandler& handler)
 {
+    if (strcmp(fname, "-") == 0)
+        return read_stdin_raw(opts, handler);
+
     // Open the input file
     FILE* in = fopen(fname, "rt");
     if (in == NULL)
@@ -29,6 +29,8 @@ struct PrintVars : public BulletinFullHandler
     PrintVars(const std::vector<wreport::Varcode>& codes, FILE* out = stdout)
         : out(out), codes(codes)
     {
+        // Only decode the variables that are going to be printed
+        bufr_options->decode_varcodes.insert(codes.begin(), codes.end());
     }
 
     const Var* find_varcode(const wreport::Subset& subset, Varcode code)
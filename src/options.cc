@@ -20,8 +20,12 @@
  */
 
 #include "options.h"
+#include <cctype>
+#include <cstdlib>
 #include <cstring>
 #include <wreport/bulletin.h>
+#include <wreport/error.h>
+#include <wreport/notes.h>
 
 using namespace wreport;
 
@@ -37,6 +41,145 @@ void Options::init_varcodes(const char* str)
     }
 }
 
+namespace {
+
+// Throw an error about an invalid filter value
+[[noreturn]] void invalid_filter_value(const std::string& key,
+                                       const std::string& val)
+{
+    error_consistency::throwf("invalid value '%s' for %s", val.c_str(),
+                              key.c_str());
+}
+
+// Parse a number in a filter value
+int parse_filter_int(const std::string& key, const std::string& val)
+{
+    char* end;
+    long res = strtol(val.c_str(), &end, 10);
+    if (!isdigit((unsigned char)val[0]) || *end || res > 65535)
+        invalid_filter_value(key, val);
+    return res;
+}
+
+// Parse a datetime in a filter value, as YYYY[-MM[-DD[THH[:MM[:SS]]]]], with
+// the missing parts left unchanged. A space can be used instead of T.
+void parse_filter_time(const std::string& key, const std::string& val,
+                       int (&out)[6])
+{
+    // Separator before each part, and valid range of each part
+    static const char separators[6] = {0, '-', '-', 'T', ':', ':'};
+    static const int min[6]         = {0, 1, 1, 0, 0, 0};
+    static const int max[6]         = {65535, 12, 31, 23, 59, 59};
+
+    int parsed[6];
+    unsigned count = 0;
+    const char* s  = val.c_str();
+    do
+    {
+        if (count == 6)
+            invalid_filter_value(key, val);
+        if (count > 0)
+        {
+            char sep = *s++;
+            if (sep != separators[count] && (count != 3 || sep != ' '))
+                invalid_filter_value(key, val);
+        }
+        if (!isdigit((unsigned char)*s))
+            invalid_filter_value(key, val);
+        char* end;
+        long part = strtol(s, &end, 10);
+        if (part < min[count] || part > max[count])
+            invalid_filter_value(key, val);
+        parsed[count++] = part;
+        s               = end;
+    } while (*s);
+
+    for (unsigned i = 0; i < count; ++i)
+        out[i] = parsed[i];
+}
+
+// Compare two reference times
+int compare_time(const int (&a)[6], const int (&b)[6])
+{
+    for (unsigned i = 0; i < 6; ++i)
+        if (a[i] != b[i])
+            return a[i] < b[i] ? -1 : 1;
+    return 0;
+}
+
+} // namespace
+
+void HeaderMatcher::parse(const char* str)
+{
+    std::string spec(str);
+    size_t pos = 0;
+    while (pos < spec.size())
+    {
+        size_t end = spec.find(',', pos);
+        if (end == std::string::npos)
+            end = spec.size();
+        std::string item = spec.substr(pos, end - pos);
+        pos              = end + 1;
+
+        size_t eq = item.find('=');
+        if (eq == std::string::npos)
+            error_consistency::throwf("'%s' is not in the form key=value",
+                                      item.c_str());
+        std::string key = item.substr(0, eq);
+        std::string val = item.substr(eq + 1);
+        if (key == "centre")
+            centre = parse_filter_int(key, val);
+        else if (key == "subcentre")
+            subcentre = parse_filter_int(key, val);
+        else if (key == "category")
+            category = parse_filter_int(key, val);
+        else if (key == "subcategory")
+            subcategory = parse_filter_int(key, val);
+        else if (key == "since")
+            parse_filter_time(key, val, since);
+        else if (key == "until")
+            parse_filter_time(key, val, until);
+        else
+            error_consistency::throwf("unknown filter key '%s'", key.c_str());
+    }
+}
+
+bool HeaderMatcher::empty() const
+{
+    return centre == -1 && subcentre == -1 && category == -1 &&
+           subcategory == -1 && since[0] == -1 && until[0] == -1;
+}
+
+bool HeaderMatcher::operator()(const Bulletin& bulletin) const
+{
+    if (centre != -1 && bulletin.originating_centre != centre)
+        return false;
+    if (subcentre != -1 && bulletin.originating_subcentre != subcentre)
+        return false;
+    if (category != -1 && bulletin.data_category != category)
+        return false;
+    if (subcategory != -1 && bulletin.data_subcategory != subcategory)
+        return false;
+    if (since[0] != -1 || until[0] != -1)
+    {
+        int reftime[6] = {bulletin.rep_year,   bulletin.rep_month,
+                          bulletin.rep_day,    bulletin.rep_hour,
+                          bulletin.rep_minute, bulletin.rep_second};
+        if (since[0] != -1 && compare_time(reftime, since) < 0)
+            return false;
+        if (until[0] != -1 && compare_time(reftime, until) > 0)
+            return false;
+    }
+    return true;
+}
+
+HeaderFilter Options::header_filter() const
+{
+    if (matcher.empty())
+        return HeaderFilter();
+    return matcher;
+}
+
 void BulletinHeadHandler::handle_raw_bufr(const std::string& raw_data,
                                           const char* fname, long offset)
 {
@@ -45,6 +188,8 @@ void BulletinHeadHandler::handle_raw_bufr(const std::string& raw_data,
         // Decode the raw data. fname and offset are optional and we pass
         // them just to have nicer error messages
         auto bulletin = BufrBulletin::decode_header(raw_data, fname, offset);
+        if (filter && !filter(*bulletin))
+            return;
 
         // Do something with the decoded information
         handle(*bulletin);
@@ -63,6 +208,8 @@ void BulletinHeadHandler::handle_raw_crex(const std::string& raw_data,
         // Decode the raw data. fname and offset are optional and we pass
         // them just to have nicer error messages
         auto bulletin = CrexBulletin::decode(raw_data, fname, offset);
+        if (filter && !filter(*bulletin))
+            return;
 
         // Do something with the decoded information
         handle(*bulletin);
@@ -73,6 +220,17 @@ void BulletinHeadHandler::handle_raw_crex(const std::string& raw_data,
     }
 }
 
+BulletinFullHandler::BulletinFullHandler()
+    : bufr_options(BufrCodecOptions::create())
+{
+    // Skip decoding the data section of messages rejected by the filter
+    bufr_options->decode_header_filter = [this](const BufrBulletin& b) {
+        return !filter || filter(b);
+    };
+}
+
+BulletinFullHandler::~BulletinFullHandler() {}
+
 void BulletinFullHandler::handle_raw_bufr(const std::string& raw_data,
                                           const char* fname, long offset)
 {
@@ -80,7 +238,10 @@ void BulletinFullHandler::handle_raw_bufr(const std::string& raw_data,
     {
         // Decode the raw data. fname and offset are optional and we pass
         // them just to have nicer error messages
-        auto bulletin = BufrBulletin::decode(raw_data, fname, offset);
+        auto bulletin =
+            BufrBulletin::decode(raw_data, *bufr_options, fname, offset);
+        if (!bulletin)
+            return;
 
         // Do something with the decoded information
         handle(*bulletin);
@@ -96,6 +257,11 @@ void BulletinFullHandler::handle_raw_crex(const std::string& raw_data,
 {
     try
     {
+        // Check the filter before decoding the data section
+        if (filter &&
+            !filter(*CrexBulletin::decode_header(raw_data, fname, offset)))
+            return;
+
         // Decode the raw data. fname and offset are optional and we pass
         // them just to have nicer error messages
         auto bulletin = CrexBulletin::decode(raw_data, fname, offset);
@@ -108,3 +274,145 @@ void BulletinFullHandler::handle_raw_crex(const std::string& raw_data,
         fprintf(stderr, "%s:%ld:%s\n", fname, offset, e.what());
     }
 }
+
+ParallelHandler::ParallelHandler(unsigned jobs, Factory factory, FILE* out)
+    : factory(factory), out(out), max_pending(jobs * 4)
+{
+    // Propagate the notes configuration to the workers
+    std::ostream* notes_target = notes::get_target();
+    for (unsigned i = 0; i < jobs; ++i)
+        workers.emplace_back(
+            [this, notes_target] { worker_main(notes_target); });
+}
+
+ParallelHandler::~ParallelHandler() { stop(); }
+
+void ParallelHandler::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        shutdown = true;
+    }
+    jobs_changed.notify_all();
+    for (auto& w : workers)
+        w.join();
+    workers.clear();
+}
+
+void ParallelHandler::worker_main(std::ostream* notes_target)
+{
+    if (notes_target)
+        notes::set_target(*notes_target);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true)
+    {
+        jobs_changed.wait(lock, [&] { return shutdown || !queue.empty(); });
+        if (queue.empty())
+            return;
+        Job job = std::move(queue.front());
+        queue.pop_front();
+
+        lock.unlock();
+        Result result = run(job);
+        lock.lock();
+
+        results[job.seq] = std::move(result);
+        results_changed.notify_all();
+    }
+}
+
+ParallelHandler::Result ParallelHandler::run(Job& job)
+{
+    Result result;
+    char* buf    = nullptr;
+    size_t size  = 0;
+    FILE* jobout = open_memstream(&buf, &size);
+    if (!jobout)
+    {
+        result.error = "cannot create output buffer";
+        return result;
+    }
+
+    try
+    {
+        auto handler = factory(jobout);
+        if (job.crex)
+            handler->handle_raw_crex(job.raw_data, job.fname, job.offset);
+        else
+            handler->handle_raw_bufr(job.raw_data, job.fname, job.offset);
+        handler->done();
+    }
+    catch (std::exception& e)
+    {
+        result.error = e.what();
+    }
+
+    fclose(jobout);
+    result.output.assign(buf, size);
+    free(buf);
+    return result;
+}
+
+void ParallelHandler::enqueue(bool crex, const std::string& raw_data,
+                              const char* fname, long offset)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+
+    // Limit the number of messages kept in memory
+    while (next_read - next_write >= max_pending)
+    {
+        write_ready(lock);
+        if (next_read - next_write >= max_pending)
+            results_changed.wait(lock);
+    }
+
+    queue.emplace_back(Job{next_read++, crex, raw_data, fname, offset});
+    lock.unlock();
+    jobs_changed.notify_one();
+}
+
+void ParallelHandler::write_ready(std::unique_lock<std::mutex>& lock)
+{
+    while (true)
+    {
+        auto i = results.find(next_write);
+        if (i == results.end())
+            return;
+        Result result = std::move(i->second);
+        results.erase(i);
+
+        // Only this thread writes, so output stays in order while unlocked
+        lock.unlock();
+        fwrite(result.output.data(), result.output.size(), 1, out);
+        if (!result.error.empty())
+            fprintf(stderr, "%s\n", result.error.c_str());
+        lock.lock();
+        ++next_write;
+    }
+}
+
+void ParallelHandler::handle_raw_bufr(const std::string& raw_data,
+                                      const char* fname, long offset)
+{
+    enqueue(false, raw_data, fname, offset);
+}
+
+void ParallelHandler::handle_raw_crex(const std::string& raw_data,
+                                      const char* fname, long offset)
+{
+    enqueue(true, raw_data, fname, offset);
+}
+
+void ParallelHandler::done()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (next_write < next_read)
+    {
+        write_ready(lock);
+        if (next_write < next_read)
+            results_changed.wait(lock);
+    }
+    lock.unlock();
+    fflush(out);
+}
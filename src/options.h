@@ -22,14 +22,48 @@
 #ifndef WREP_OPTIONS_H
 #define WREP_OPTIONS_H
 
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <thread>
 #include <vector>
 #include <wreport/varinfo.h>
 
 namespace wreport {
 struct Bulletin;
+class BufrCodecOptions;
 }
 
+// Selection of messages based on their header
+typedef std::function<bool(const wreport::Bulletin&)> HeaderFilter;
+
+// Header values that messages need to match to be processed
+struct HeaderMatcher
+{
+    // Values to match, or -1 to match any value
+    int centre      = -1;
+    int subcentre   = -1;
+    int category    = -1;
+    int subcategory = -1;
+    // Reference time range, as year, month, day, hour, minute, second; the
+    // first element is -1 for an open range
+    int since[6]    = {-1, 1, 1, 0, 0, 0};
+    int until[6]    = {-1, 12, 31, 23, 59, 59};
+
+    // Add a comma separated list of key=value conditions
+    void parse(const char* str);
+
+    // True if no conditions have been set
+    bool empty() const;
+
+    // Check if a bulletin matches all conditions
+    bool operator()(const wreport::Bulletin& bulletin) const;
+};
+
 enum Action {
     DUMP,
     DUMP_STRUCTURE,
@@ -41,6 +75,7 @@ enum Action {
     TABLES,
     FEATURES,
     LIST_TABLES,
+    INDEX,
     HELP,
 };
 
@@ -51,6 +86,8 @@ struct Options
     bool crex;
     // Verbose processing
     bool verbose;
+    // Number of messages to decode in parallel
+    unsigned jobs;
 
     // Action requested
     enum Action action;
@@ -58,14 +95,24 @@ struct Options
     // List of varcodes selected by the user
     std::vector<wreport::Varcode> varcodes;
 
+    // Conditions on the header of the messages to process
+    HeaderMatcher matcher;
+
     // Initialise with default values
-    Options() : crex(false), verbose(false), action(DUMP) {}
+    Options() : crex(false), verbose(false), jobs(1), action(DUMP) {}
 
     void init_varcodes(const char* str);
+
+    // Filter selecting the messages to process, or an empty function to
+    // process all messages
+    HeaderFilter header_filter() const;
 };
 
 struct RawHandler
 {
+    // If set, only messages whose header it accepts are handled
+    HeaderFilter filter;
+
     virtual ~RawHandler() {}
     virtual void handle_raw_bufr(const std::string& data, const char* fname,
                                  long offset) = 0;
@@ -93,7 +140,11 @@ struct BulletinHeadHandler : public RawHandler
 // Interface for classes that process bulletins, parsing full messages
 struct BulletinFullHandler : public RawHandler
 {
-    virtual ~BulletinFullHandler() {}
+    // Options used to decode BUFR messages
+    std::unique_ptr<wreport::BufrCodecOptions> bufr_options;
+
+    BulletinFullHandler();
+    virtual ~BulletinFullHandler();
 
     /// Decode and handle the decoded bulletin
     void handle_raw_bufr(const std::string& raw_data, const char* fname,
@@ -106,6 +157,74 @@ struct BulletinFullHandler : public RawHandler
     virtual void handle(wreport::Bulletin&) = 0;
 };
 
+/**
+ * Handle messages using a pool of worker threads.
+ *
+ * Each message is handled by a new handler created with the factory, which
+ * writes its output to a memory buffer. Buffers are then written to the
+ * output in the same order as the messages were read.
+ */
+class ParallelHandler : public RawHandler
+{
+public:
+    // Create a handler writing to the given output
+    typedef std::function<std::unique_ptr<RawHandler>(FILE* out)> Factory;
+
+protected:
+    struct Job
+    {
+        unsigned long seq;
+        bool crex;
+        std::string raw_data;
+        const char* fname;
+        long offset;
+    };
+
+    struct Result
+    {
+        std::string output;
+        std::string error;
+    };
+
+    Factory factory;
+    FILE* out;
+    // Maximum number of messages read and not yet written out
+    unsigned max_pending;
+    std::vector<std::thread> workers;
+
+    std::mutex mutex;
+    // Notified when jobs are queued or when the workers should exit
+    std::condition_variable jobs_changed;
+    // Notified when results are available
+    std::condition_variable results_changed;
+    std::deque<Job> queue;
+    std::map<unsigned long, Result> results;
+    // Sequence number of the next message read
+    unsigned long next_read  = 0;
+    // Sequence number of the next message to write
+    unsigned long next_write = 0;
+    bool shutdown            = false;
+
+    void worker_main(std::ostream* notes_target);
+    Result run(Job& job);
+    void enqueue(bool crex, const std::string& raw_data, const char* fname,
+                 long offset);
+    // Write the results that are ready, in order. Must hold the lock.
+    void write_ready(std::unique_lock<std::mutex>& lock);
+    void stop();
+
+public:
+    ParallelHandler(unsigned jobs, Factory factory, FILE* out);
+    ~ParallelHandler();
+
+    void handle_raw_bufr(const std::string& data, const char* fname,
+                         long offset) override;
+    void handle_raw_crex(const std::string& data, const char* fname,
+                         long offset) override;
+    /// Wait until all the messages read have been handled and written out
+    void done() override;
+};
+
 // Signature for functions that read bulletins from a file
 typedef void (*bulletin_reader)(const Options&, const char*,
                                 RawHandler& handler);
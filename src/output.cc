@@ -43,6 +43,13 @@ struct PrintTrace : public BulletinFullHandler
     {
         try
         {
+            // Check the filter before tracing the decoding: decode_verbose
+            // does not take decoding options, so the header is decoded
+            // separately
+            if (filter && !filter(*wreport::BufrBulletin::decode_header(
+                              raw_data, fname, offset)))
+                return;
+
             // Decode the raw data. fname and offset are optional and we pass
             // them just to have nicer error messages
             auto bulletin = wreport::BufrBulletin::decode_verbose(
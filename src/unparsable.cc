@@ -25,8 +25,18 @@ struct CopyUnparsable : public RawHandler
     FILE* log;
     unsigned unparsed;
 
-    CopyUnparsable(FILE* out, FILE* log = 0) : out(out), log(log), unparsed(0)
+    /// Options used to decode BUFR messages
+    std::unique_ptr<BufrCodecOptions> bufr_options;
+
+    CopyUnparsable(FILE* out, FILE* log = 0)
+        : out(out), log(log), unparsed(0),
+          bufr_options(BufrCodecOptions::create())
     {
+        // Skip decoding the data section of messages rejected by the filter.
+        // Messages whose header cannot be decoded are always unparsable
+        bufr_options->decode_header_filter = [this](const BufrBulletin& b) {
+            return !filter || filter(b);
+        };
     }
 
     void handle_raw_bufr(const std::string& raw_data, const char* fname,
@@ -34,7 +44,7 @@ struct CopyUnparsable : public RawHandler
     {
         try
         {
-            BufrBulletin::decode(raw_data, fname, offset);
+            BufrBulletin::decode(raw_data, *bufr_options, fname, offset);
         }
         catch (std::exception& e)
         {
@@ -50,6 +60,10 @@ struct CopyUnparsable : public RawHandler
     {
         try
         {
+            // Messages whose header cannot be decoded are always unparsable
+            if (filter && !filter(*CrexBulletin::decode_header(
+                              raw_data, fname, offset)))
+                return;
             CrexBulletin::decode(raw_data, fname, offset);
         }
         catch (std::exception& e)
@@ -0,0 +1,144 @@
+#include "config.h"
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <wreport/dtable.h>
+#include <wreport/notes.h>
+#include <wreport/vartable.h>
+
+#ifdef HAS_GETOPT_LONG
+#include <getopt.h>
+#endif
+
+using namespace wreport;
+using namespace std;
+namespace fs = std::filesystem;
+
+namespace {
+
+bool verbose = false;
+
+void do_usage(FILE* out)
+{
+    fputs("Usage: wrep-compiletable {file|dir} [{file|dir}...]\n", out);
+}
+
+void do_help(FILE* out)
+{
+    do_usage(out);
+    fputs("Write compiled versions of B*.txt and D*.txt tables, that wreport\n"
+          "uses instead of parsing the text tables while they do not change.\n"
+          "Directories are searched for tables, non recursively.\n"
+          "Options:\n"
+          "  -v,--verbose        verbose operation\n"
+          "  -h,--help           print this help message\n"
+#ifndef HAS_GETOPT_LONG
+          "NOTE: long options are not supported on this system\n"
+#endif
+          ,
+          out);
+}
+
+/// Compile a table, choosing B or D by the first letter of its file name
+bool compile_table(const fs::path& path)
+{
+    std::string name = path.filename();
+    if (name.empty() || path.extension() != ".txt")
+        return false;
+
+    notes::logf("%s: compiling\n", path.c_str());
+    switch (name[0])
+    {
+        case 'B': Vartable::compile(path); return true;
+        case 'D': DTable::compile(path); return true;
+        default:  return false;
+    }
+}
+
+void process_dir(const fs::path& path)
+{
+    for (const auto& entry : fs::directory_iterator(path))
+        compile_table(entry.path());
+}
+
+void process_file(const fs::path& path)
+{
+    if (!compile_table(path))
+        fprintf(stderr, "%s: not a B*.txt or D*.txt table, skipped\n",
+                path.c_str());
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+#ifdef HAS_GETOPT_LONG
+    static struct option long_options[] = {
+        /* These options set a flag. */
+        {"verbose", no_argument, NULL, 'v'},
+        {"help",    no_argument, NULL, 'h'},
+        {0,         0,           0,    0  }
+    };
+#endif
+
+    // Parse command line options
+    while (1)
+    {
+        // getopt_long stores the option index here
+        int option_index = 0;
+
+#ifdef HAS_GETOPT_LONG
+        int c = getopt_long(argc, argv, "vh", long_options, &option_index);
+#else
+        int c = getopt(argc, argv, "vh");
+#endif
+
+        // Detect the end of the options
+        if (c == -1)
+            break;
+
+        switch (c)
+        {
+            case 'v': verbose = true; break;
+            case 'h':
+                do_help(stdout);
+                return 0;
+                break;
+            default:
+                fprintf(stderr, "unknown option character %c (%d)\n", c, c);
+                do_help(stderr);
+                return 1;
+        }
+    }
+
+    // Print out processing remarks if verbose
+    if (verbose)
+        notes::set_target(cerr);
+
+    // Ensure we have some file to process
+    if (optind >= argc)
+    {
+        do_usage(stderr);
+        return 1;
+    }
+
+    try
+    {
+        while (optind < argc)
+        {
+            fs::path path(argv[optind++]);
+            if (fs::is_directory(path))
+                process_dir(path);
+            else
+                process_file(path);
+        }
+    }
+    catch (std::exception& e)
+    {
+        fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+
+    return 0;
+}
@@ -1,9 +1,11 @@
 #include "config.h"
 #include "options.h"
 #include <cstdio>
+#include <cstdlib>
 #include <iostream>
 #include <string>
 #include <wreport/error.h>
+#include <wreport/index.h>
 #include <wreport/internals/tabledir.h>
 #include <wreport/notes.h>
 
@@ -26,7 +28,9 @@ namespace {
 
 void do_usage(FILE* out)
 {
-    fputs("Usage: wrep [options] file1 [file2 [file3 ..]]\n", out);
+    fputs("Usage: wrep [options] file1 [file2 [file3 ..]]\n"
+          "Use - as file name to read from standard input\n",
+          out);
 }
 
 void do_help(FILE* out)
@@ -52,6 +56,18 @@ void do_help(FILE* out)
         "bulletin\n"
         "  -F,--features       print the features used by each bulletin\n"
         "  -L,--list-tables    print a list of all tables found\n"
+        "  -f,--filter=FILTER  only process messages whose header matches\n"
+        "                      FILTER, a comma-separated list of key=value\n"
+        "                      with keys centre, subcentre, category,\n"
+        "                      subcategory, since and until (e.g.\n"
+        "                      \"centre=80,category=0,since=2024-01-01T06\");\n"
+        "                      the data section of other messages is not\n"
+        "                      decoded\n"
+        "  -I,--index          write an index of the messages in each file,\n"
+        "                      to FILE.idx\n"
+        "  -j,--jobs=N         decode N messages in parallel, keeping the "
+        "output\n"
+        "                      in input order (ignored with --tables)\n"
 #ifndef HAS_GETOPT_LONG
         "NOTE: long options are not supported on this system\n"
 #endif
@@ -59,6 +75,55 @@ void do_help(FILE* out)
         out);
 }
 
+/// Create the handler for the action requested by the user
+std::unique_ptr<RawHandler> make_action_handler(const Options& options,
+                                                FILE* out)
+{
+    switch (options.action)
+    {
+        case TRACE:          return std::make_unique<PrintTrace>(out);
+        case DUMP:           return std::make_unique<PrintContents>(out);
+        case DUMP_STRUCTURE: return std::make_unique<PrintStructure>(out);
+        case DUMP_DDS:       return std::make_unique<PrintDDS>(out);
+        case PRINT_VARS:
+            return std::make_unique<PrintVars>(options.varcodes, out);
+        case UNPARSABLE: return std::make_unique<CopyUnparsable>(out, stderr);
+        case TABLES:     return std::make_unique<PrintTables>(out);
+        case FEATURES:   return std::make_unique<PrintFeatures>(out);
+        default:         return std::unique_ptr<RawHandler>();
+    }
+}
+
+/// Create the handler for the action requested by the user, processing only
+/// the messages selected by the filter options
+std::unique_ptr<RawHandler> make_handler(const Options& options, FILE* out)
+{
+    auto res = make_action_handler(options, out);
+    if (res)
+        res->filter = options.header_filter();
+    return res;
+}
+
+/// Write the index of the BUFR messages in a file
+void do_index(const char* fname)
+{
+    if (string(fname) == "-")
+        throw error_consistency("standard input cannot be indexed");
+
+    MessageIndex index(fname);
+    index.build();
+    index.write();
+
+    size_t undecoded = 0;
+    for (const auto& rec : index.records())
+        if (!rec.header_decoded)
+            ++undecoded;
+    printf("%s: %zu messages indexed", fname, index.records().size());
+    if (undecoded)
+        printf(", %zu with headers that cannot be decoded", undecoded);
+    putchar('\n');
+}
+
 } // namespace
 
 int main(int argc, char* argv[])
@@ -78,6 +143,9 @@ int main(int argc, char* argv[])
         {"tables",      no_argument,       NULL, 'T'},
         {"features",    no_argument,       NULL, 'F'},
         {"list-tables", no_argument,       NULL, 'L'},
+        {"index",       no_argument,       NULL, 'I'},
+        {"filter",      required_argument, NULL, 'f'},
+        {"jobs",        required_argument, NULL, 'j'},
         {"help",        no_argument,       NULL, 'h'},
         {0,             0,                 0,    0  }
     };
@@ -91,10 +159,10 @@ int main(int argc, char* argv[])
         int option_index = 0;
 
 #ifdef HAS_GETOPT_LONG
-        int c = getopt_long(argc, argv, "cdsDpivtUTFLh:", long_options,
+        int c = getopt_long(argc, argv, "cdsDpivtUTFLIf:j:h:", long_options,
                             &option_index);
 #else
-        int c = getopt(argc, argv, "cdsDpivtUTFLh:");
+        int c = getopt(argc, argv, "cdsDpivtUTFLIf:j:h:");
 #endif
 
         // Detect the end of the options
@@ -118,6 +186,27 @@ int main(int argc, char* argv[])
             case 'T': options.action = TABLES; break;
             case 'F': options.action = FEATURES; break;
             case 'L': options.action = LIST_TABLES; break;
+            case 'I': options.action = INDEX; break;
+            case 'f':
+                try
+                {
+                    options.matcher.parse(optarg);
+                }
+                catch (std::exception& e)
+                {
+                    fprintf(stderr, "invalid filter %s: %s\n", optarg,
+                            e.what());
+                    return 1;
+                }
+                break;
+            case 'j':
+                options.jobs = strtoul(optarg, nullptr, 10);
+                if (options.jobs == 0)
+                {
+                    fprintf(stderr, "invalid number of jobs: %s\n", optarg);
+                    return 1;
+                }
+                break;
             case 'h': options.action = HELP; break;
             default:
                 fprintf(stderr, "unknown option character %c (%d)\n", c, c);
@@ -131,24 +220,55 @@ int main(int argc, char* argv[])
         notes::set_target(cerr);
 
     // Choose the right handler for the action requested by the user
-    unique_ptr<RawHandler> handler;
     switch (options.action)
     {
-        case HELP:           do_help(stdout); return 0;
-        case INFO:           do_info(); return 0;
-        case LIST_TABLES:    tabledir::Tabledirs::get().print(stdout); return 0;
-        case TRACE:          handler.reset(new PrintTrace(stdout)); break;
-        case DUMP:           handler.reset(new PrintContents(stdout)); break;
-        case DUMP_STRUCTURE: handler.reset(new PrintStructure(stdout)); break;
-        case DUMP_DDS:       handler.reset(new PrintDDS(stdout)); break;
-        case PRINT_VARS:     handler.reset(new PrintVars(options.varcodes)); break;
-        case UNPARSABLE:
-            handler.reset(new CopyUnparsable(stdout, stderr));
-            break;
-        case TABLES:   handler.reset(new PrintTables(stdout)); break;
-        case FEATURES: handler.reset(new PrintFeatures(stdout)); break;
+        case HELP:        do_help(stdout); return 0;
+        case INFO:        do_info(); return 0;
+        case LIST_TABLES: tabledir::Tabledirs::get().print(stdout); return 0;
+        default:          break;
+    }
+
+    // Indexing only decodes message headers, and does not use a handler
+    if (options.action == INDEX)
+    {
+        if (optind >= argc)
+        {
+            do_usage(stderr);
+            return 1;
+        }
+        if (options.crex)
+        {
+            fprintf(stderr, "only BUFR files can be indexed\n");
+            return 1;
+        }
+        int res = 0;
+        while (optind < argc)
+        {
+            const char* fname = argv[optind++];
+            try
+            {
+                do_index(fname);
+            }
+            catch (std::exception& e)
+            {
+                fprintf(stderr, "%s:%s\n", fname, e.what());
+                res = 1;
+            }
+        }
+        return res;
     }
 
+    unique_ptr<RawHandler> handler;
+    // PrintTables prints a header before the first message, so it needs to
+    // see all the messages in sequence
+    if (options.jobs > 1 && options.action != TABLES)
+        handler.reset(new ParallelHandler(
+            options.jobs,
+            [&options](FILE* out) { return make_handler(options, out); },
+            stdout));
+    else
+        handler = make_handler(options, stdout);
+
     // Ensure we have some file to process
     if (optind >= argc)
     {
@@ -0,0 +1,119 @@
+#include "arena.h"
+#include "bulletin.h"
+#include "internals/varinfo.h"
+#include "tests.h"
+#include <cstdint>
+
+using namespace wreport;
+using namespace wreport::tests;
+using namespace std;
+
+namespace {
+
+class Tests : public TestCase
+{
+    using TestCase::TestCase;
+
+    void register_tests() override
+    {
+        add_method("allocate", []() {
+            Arena arena(128);
+            wassert(actual(arena.capacity()) == 0u);
+
+            char* a = static_cast<char*>(arena.allocate(10));
+            char* b = static_cast<char*>(arena.allocate(10));
+            wassert(actual((uintptr_t)a % Arena::alignment) == 0u);
+            wassert(actual((uintptr_t)b % Arena::alignment) == 0u);
+            wassert_true(b >= a + 10);
+            wassert(actual(arena.capacity()) == 128u);
+
+            // Allocations larger than a block get a block of their own
+            arena.allocate(1024);
+            wassert(actual(arena.capacity()) == 1152u);
+
+            // After a reset, memory is reused
+            arena.reset();
+            wassert_true(arena.allocate(10) == a);
+            arena.allocate(100);
+            arena.allocate(1024);
+            wassert(actual(arena.capacity()) == 1152u);
+        });
+
+        add_method("var", []() {
+            _Varinfo info;
+            varinfo::set_string(info, WR_VAR(0, 1, 19), "LONG STATION NAME",
+                                32);
+            _Varinfo ainfo;
+            varinfo::set_string(ainfo, WR_VAR(0, 33, 7), "LONG ATTRIBUTE", 20);
+
+            Arena arena;
+            std::unique_ptr<Var> var;
+            Var moved(&info);
+            {
+                Arena::Use use(&arena);
+                var.reset(new Var(&info, "Lorem ipsum dolor sit amet"));
+                var->seta(Var(&ainfo, "consectetur adipiscing"));
+                var->seta(Var(&ainfo, "sed do eiusmod temp"));
+                wassert_true(arena.capacity() > 0);
+
+                // Moving a variable within the arena keeps the arena storage
+                moved = std::move(*var);
+                *var  = std::move(moved);
+            }
+            wassert(actual(var->enqc()) == "Lorem ipsum dolor sit amet");
+            wassert(actual(var->enqa(WR_VAR(0, 33, 7))->enqc()) ==
+                    "sed do eiusmod temp");
+
+            // Moving outside of the arena copies the contents to the heap
+            moved = std::move(*var);
+            wassert_false(var->isset());
+            wassert_false(var->next_attr());
+            var.reset();
+            arena.reset();
+            {
+                Arena::Use use(&arena);
+                Var overwrite(&info, "Ut enim ad minim veniam, quis");
+                overwrite.seta(Var(&ainfo, "nostrud exercitation"));
+            }
+            wassert(actual(moved.enqc()) == "Lorem ipsum dolor sit amet");
+            wassert(actual(moved.enqa(WR_VAR(0, 33, 7))->enqc()) ==
+                    "sed do eiusmod temp");
+
+            // Heap attributes can be mixed with arena ones
+            {
+                Arena::Use use(&arena);
+                moved.seta(Var(&ainfo, "ullamco laboris nisi"));
+                moved.unseta(WR_VAR(0, 33, 7));
+                moved.seta(Var(&ainfo, "ut aliquip ex ea commodo"));
+            }
+            wassert(actual(moved.enqa(WR_VAR(0, 33, 7))->enqc()) ==
+                    "ut aliquip ex ea com");
+        });
+
+        add_method("bulletin", []() {
+            auto reused = BufrBulletin::create();
+            reused->arena.reset(new Arena);
+            for (const char* fname :
+                 {"bufr/gts-synop-rad1.bufr", "bufr/synop-longname.bufr",
+                  "bufr/C23000.bufr", "bufr/ed4-compr-string.bufr",
+                  "bufr/temp-gts1.bufr", "bufr/C04004.bufr"})
+            {
+                WREPORT_TEST_INFO(info);
+                info() << fname;
+                std::string raw = slurpfile(fname);
+                auto expected   = BufrBulletin::decode(raw, fname);
+                BufrBulletin::decode(raw, *reused, fname);
+                wassert(actual(reused->diff(*expected)) == 0u);
+            }
+            // Decoding the same messages again does not need more memory
+            size_t capacity = reused->arena->capacity();
+            wassert_true(capacity > 0);
+            for (const char* fname :
+                 {"bufr/gts-synop-rad1.bufr", "bufr/synop-longname.bufr"})
+                BufrBulletin::decode(slurpfile(fname), *reused, fname);
+            wassert(actual(reused->arena->capacity()) == capacity);
+        });
+    }
+} test("arena");
+
+} // namespace
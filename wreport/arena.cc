@@ -0,0 +1,42 @@
+#include "arena.h"
+
+namespace wreport {
+
+const size_t Arena::alignment;
+
+thread_local Arena* Arena::current = nullptr;
+
+Arena::Arena(size_t block_size) : block_size(block_size) {}
+
+Arena::~Arena() {}
+
+void* Arena::allocate_slow(size_t size)
+{
+    // Move on to the next block that is big enough, if we have one from
+    // before the last reset
+    if (!blocks.empty())
+        ++cur_block;
+    while (cur_block < blocks.size() && blocks[cur_block].size < size)
+        ++cur_block;
+
+    if (cur_block >= blocks.size())
+    {
+        size_t new_size = size > block_size ? size : block_size;
+        blocks.emplace_back(
+            Block{std::unique_ptr<char[]>(new char[new_size]), new_size});
+        cur_block = blocks.size() - 1;
+    }
+
+    cur_pos = size;
+    return blocks[cur_block].data.get();
+}
+
+size_t Arena::capacity() const
+{
+    size_t res = 0;
+    for (const auto& b : blocks)
+        res += b.size;
+    return res;
+}
+
+} // namespace wreport
@@ -0,0 +1,109 @@
+#ifndef WREPORT_ARENA_H
+#define WREPORT_ARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace wreport {
+
+/**
+ * Memory arena for the contents of decoded variables.
+ *
+ * Memory is handed out from large blocks, and it is never freed individually:
+ * reset() makes all of it available again in one go, keeping the blocks for
+ * reuse.
+ *
+ * While an arena is active in a thread (see Arena::Use), Var allocates in it
+ * the string and binary values that do not fit its inline storage, and the
+ * storage of its attributes. Such variables must not outlive the next
+ * reset() of the arena: moving them when no arena is active copies their
+ * contents to the heap, so they can safely be moved out of a Bulletin.
+ *
+ * Destroying variables that only use inline or arena storage does no work
+ * besides checking a flag, so clearing a decoded Bulletin with an arena does
+ * not need to look at each variable's Varinfo or call into the library.
+ */
+class Arena
+{
+protected:
+    struct Block
+    {
+        std::unique_ptr<char[]> data;
+        size_t size;
+    };
+
+    /// Memory blocks, reused across resets
+    std::vector<Block> blocks;
+
+    /// Size of newly allocated blocks
+    size_t block_size;
+
+    /// Index in blocks of the block currently used for allocation
+    size_t cur_block = 0;
+
+    /// Offset in the current block of the next free byte
+    size_t cur_pos = 0;
+
+    /// Allocate \a size bytes from a new or recycled block
+    void* allocate_slow(size_t size);
+
+public:
+    /// Alignment of all returned allocations
+    static const size_t alignment = alignof(std::max_align_t);
+
+    /// Arena used by Var allocations in this thread, or nullptr if none
+    static thread_local Arena* current;
+
+    /**
+     * Make an arena the current one for the duration of a scope.
+     *
+     * If the arena is nullptr, allocations in the scope use the heap.
+     */
+    class Use
+    {
+        Arena* previous;
+
+    public:
+        explicit Use(Arena* arena) : previous(current) { current = arena; }
+        ~Use() { current = previous; }
+        Use(const Use&)            = delete;
+        Use& operator=(const Use&) = delete;
+    };
+
+    explicit Arena(size_t block_size = 64 * 1024);
+    Arena(const Arena&)            = delete;
+    Arena& operator=(const Arena&) = delete;
+    ~Arena();
+
+    /// Allocate \a size bytes, aligned to Arena::alignment
+    void* allocate(size_t size)
+    {
+        size = (size + alignment - 1) & ~(alignment - 1);
+        if (!blocks.empty() && cur_pos + size <= blocks[cur_block].size)
+        {
+            void* res = blocks[cur_block].data.get() + cur_pos;
+            cur_pos += size;
+            return res;
+        }
+        return allocate_slow(size);
+    }
+
+    /**
+     * Make all the memory allocated so far available again.
+     *
+     * Any object still using memory from the arena becomes invalid.
+     */
+    void reset()
+    {
+        cur_block = 0;
+        cur_pos   = 0;
+    }
+
+    /// Total size of the memory blocks owned by the arena
+    size_t capacity() const;
+};
+
+} // namespace wreport
+
+#endif
@@ -1,4 +1,19 @@
 #include "benchmark.h"
+#include <cstdlib>
+#include <new>
+
+// Count memory allocations, for the benchmarks that report them
+void* operator new(std::size_t size)
+{
+    wreport::benchmark::allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* res = malloc(size ? size : 1))
+        return res;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept { free(ptr); }
+
+void operator delete(void* ptr, std::size_t) noexcept { free(ptr); }
 
 int main(int argc, const char* argv[])
 {
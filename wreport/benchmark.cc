@@ -13,8 +13,10 @@ double ticks_per_sec = sysconf(_SC_CLK_TCK);
 namespace wreport {
 namespace benchmark {
 
-Task::Task(Benchmark* parent, const std::string& name)
-    : parent(parent), name(name)
+std::atomic<unsigned long> allocations(0);
+
+Task::Task(Benchmark* parent, const std::string& name, bool count_allocations)
+    : parent(parent), name(name), count_allocations(count_allocations)
 {
     parent->tasks.push_back(this);
 }
@@ -24,9 +26,11 @@ void Task::collect(std::function<void()> f)
     run_count += 1;
 
     struct tms tms_start, tms_end;
+    unsigned long allocations_start = allocations;
     times(&tms_start);
     f();
     times(&tms_end);
+    last_allocations = allocations - allocations_start;
 
     utime += tms_end.tms_utime - tms_start.tms_utime;
     stime += tms_end.tms_stime - tms_start.tms_stime;
@@ -73,13 +77,17 @@ void Benchmark::print_timings()
     {
         fprintf(stdout,
                 "%s.%s: %u runs, user: %.2fs (%.1f%%), sys: %.2fs (%.1f%%), "
-                "total: %.2fs (%.1f%%)\n",
+                "total: %.2fs (%.1f%%)",
                 name.c_str(), t->name.c_str(), t->run_count,
                 t->utime / ticks_per_sec, t->utime * 100.0 / task_main.utime,
                 t->stime / ticks_per_sec, t->stime * 100.0 / task_main.stime,
                 (t->utime + t->stime) / ticks_per_sec,
                 (t->utime + t->stime) * 100.0 /
                     (task_main.utime + task_main.stime));
+        if (t->count_allocations)
+            fprintf(stdout, ", allocations in the last run: %lu",
+                    t->last_allocations);
+        fputc('\n', stdout);
     }
 }
 
@@ -5,6 +5,7 @@
  * Simple benchmark infrastructure.
  */
 
+#include <atomic>
 #include <cstdio>
 #include <functional>
 #include <string>
@@ -15,6 +16,15 @@ namespace benchmark {
 
 struct Benchmark;
 
+/**
+ * Number of memory allocations done so far by the program.
+ *
+ * It is only updated by programs that count allocations, by replacing the
+ * global operator new with one that increments it, like the wreport benchmark
+ * runner does.
+ */
+extern std::atomic<unsigned long> allocations;
+
 /// Collect timings for one task
 struct Task
 {
@@ -28,8 +38,13 @@ struct Task
     clock_t utime      = 0;
     // Total system time
     clock_t stime      = 0;
+    // True if the task counts memory allocations
+    bool count_allocations;
+    // Number of memory allocations in the last run
+    unsigned long last_allocations = 0;
 
-    Task(Benchmark* parent, const std::string& name);
+    Task(Benchmark* parent, const std::string& name,
+         bool count_allocations = false);
 
     // Run the given function and collect timings for it
     void collect(std::function<void()> f);
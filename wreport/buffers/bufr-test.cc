@@ -14,6 +14,41 @@ class Tests : public TestCase
     void register_tests() override
     {
         add_method("empty", []() noexcept {});
+
+        add_method("add_bits", []() {
+            std::string buf;
+            buffers::BufrOutput out(buf);
+            out.add_bits(1, 1);
+            out.add_bits(2, 3);
+            out.add_bits(0, 0);
+            out.add_bits(0xf5, 4);
+            wassert(actual(buf.size()) == 1u);
+            out.add_bits(0x3ca, 12);
+            out.add_bits(0x53ca53ca, 32);
+            wassert(actual(out.pbyte_len) == 4);
+            out.append_byte(0x53);
+            out.append_short(0xca5a);
+            out.flush();
+            wassert(actual(buf) ==
+                    std::string("\xa5\x3c\xa5\x3c\xa5\x3c\xa5\x3c\xa5\xa0",
+                                10));
+        });
+
+        add_method("append_aligned", []() {
+            std::string buf;
+            buffers::BufrOutput out(buf);
+            out.append_byte(0x12);
+            out.append_short(0x3456);
+            out.append_string("foo", 48);
+            out.append_binary((const unsigned char*)"\xab\xcd", 12);
+            out.append_missing(40);
+            out.flush();
+            wassert(actual(buf) ==
+                    std::string("\x12\x34\x56"
+                                "foo   "
+                                "\xab\xdf\xff\xff\xff\xff\xf0",
+                                16));
+        });
     }
 } test("buffers_bufr");
 
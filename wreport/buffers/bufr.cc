@@ -2,6 +2,7 @@
 #include "config.h"
 #include "wreport/var.h"
 #include <cstdarg>
+#include <cstring>
 
 // #define TRACE_INTERPRETER
 
@@ -34,29 +35,24 @@ BufrOutput::BufrOutput(std::string& out) : out(out), pbyte(0), pbyte_len(0) {}
 
 void BufrOutput::add_bits(uint32_t val, int n)
 {
-    /* Mask for reading data out of val */
-    uint32_t mask = 1 << (n - 1);
-    int i;
-
-    for (i = 0; i < n; i++)
-    {
-        pbyte <<= 1;
-        pbyte |= ((val & mask) != 0) ? 1 : 0;
-        val <<= 1;
-        pbyte_len++;
+    if (n <= 0)
+        return;
 
-        if (pbyte_len == 8)
-            flush();
-    }
-#if 0
-    IFTRACE {
-        /* Prewrite it when tracing, to allow to dump the buffer as it's
-         * written */
-        while (e->out->len + 1 > e->out->alloclen)
-            DBA_RUN_OR_RETURN(dba_rawmsg_expand_buffer(e->out));
-        e->out->buf[e->out->len] = e->pbyte << (8 - e->pbyte_len);
-    }
-#endif
+    // Join the pending bits with the new ones: at most 7 + 32 bits
+    uint64_t acc   = ((uint64_t)pbyte << n) |
+                   (n == 32 ? val : val & ((UINT32_C(1) << n) - 1));
+    unsigned total = pbyte_len + n;
+
+    // Emit all the complete bytes at once
+    char buf[5];
+    unsigned nbytes = total / 8;
+    for (unsigned i = 0; i < nbytes; ++i)
+        buf[i] = (char)(acc >> (total - 8 * (i + 1)));
+    out.append(buf, nbytes);
+
+    // Keep the remaining bits for the next call
+    pbyte_len = total % 8;
+    pbyte     = (uint8_t)(acc & ((1u << pbyte_len) - 1));
 }
 
 void BufrOutput::append_string(const Var& var, unsigned len_bits)
@@ -66,6 +62,16 @@ void BufrOutput::append_string(const Var& var, unsigned len_bits)
 
 void BufrOutput::append_string(const char* val, unsigned len_bits)
 {
+    if (pbyte_len == 0 && len_bits % 8 == 0)
+    {
+        // Byte aligned: copy the string and its space padding as they are
+        size_t len  = len_bits / 8;
+        size_t vlen = strnlen(val, len);
+        out.append(val, vlen);
+        out.append(len - vlen, ' ');
+        return;
+    }
+
     unsigned i, bi;
     bool eol = false;
     for (i = 0, bi = 0; bi < len_bits; ++i)
@@ -96,6 +102,15 @@ void BufrOutput::append_string(const char* val, unsigned len_bits)
 
 void BufrOutput::append_binary(const unsigned char* val, unsigned len_bits)
 {
+    if (pbyte_len == 0)
+    {
+        // Byte aligned: copy all the whole bytes at once
+        out.append((const char*)val, len_bits / 8);
+        if (len_bits % 8)
+            add_bits(val[len_bits / 8], len_bits % 8);
+        return;
+    }
+
     unsigned i, bi;
     for (i = 0, bi = 0; bi < len_bits; ++i)
     {
@@ -20,7 +20,12 @@ struct BufrOutput
     /// Output buffer to which we append encoded data
     std::string& out;
 
-    /// Byte to which we are appending bits to encode
+    /**
+     * Bits not yet written to out, right aligned.
+     *
+     * Complete bytes are always written to out right away, so this holds at
+     * most 7 bits.
+     */
     uint8_t pbyte;
 
     /// Number of bits already encoded in pbyte
@@ -52,13 +57,33 @@ struct BufrOutput
     }
 
     /// Append a 16 bits integer
-    void append_short(unsigned short val) { add_bits(val, 16); }
+    void append_short(unsigned short val)
+    {
+        if (pbyte_len == 0)
+        {
+            const char buf[2] = {(char)(val >> 8), (char)val};
+            out.append(buf, 2);
+        }
+        else
+            add_bits(val, 16);
+    }
 
     /// Append an 8 bits integer
-    void append_byte(unsigned char val) { add_bits(val, 8); }
+    void append_byte(unsigned char val)
+    {
+        if (pbyte_len == 0)
+            out += (char)val;
+        else
+            add_bits(val, 8);
+    }
 
     /// Append a missing value \a len_bits long
-    void append_missing(unsigned len_bits) { add_bits(0xffffffff, len_bits); }
+    void append_missing(unsigned len_bits)
+    {
+        for (; len_bits > 32; len_bits -= 32)
+            add_bits(0xffffffff, 32);
+        add_bits(0xffffffff, len_bits);
+    }
 
     /// Append a string variable
     void append_string(const Var& var, unsigned len_bits);
@@ -21,8 +21,14 @@ namespace wreport {
 namespace buffers {
 
 CrexInput::CrexInput(const std::string& in, const char* fname, size_t offset)
-    : data(in.c_str()), data_len(in.size()), fname(fname), offset(offset),
-      cur(data), has_check_digit(false)
+    : CrexInput(in.data(), in.size(), fname, offset)
+{
+}
+
+CrexInput::CrexInput(const char* data, size_t size, const char* fname,
+                     size_t offset)
+    : data(data), data_len(size), fname(fname), offset(offset), cur(data),
+      has_check_digit(false)
 {
     for (int i = 0; i < 5; ++i)
         sec[i] = 0;
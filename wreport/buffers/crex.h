@@ -61,6 +61,16 @@ struct CrexInput
      */
     CrexInput(const std::string& in, const char* fname, size_t offset);
 
+    /**
+     * Wrap a memory buffer into a CrexInput, without copying it
+     *
+     * @param data
+     *   The data to read, which does not need to be null terminated
+     * @param size
+     *   The size of \a data
+     */
+    CrexInput(const char* data, size_t size, const char* fname, size_t offset);
+
     /// Return true if the cursor is at the end of the buffer
     bool eof() const;
 
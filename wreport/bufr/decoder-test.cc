@@ -1,6 +1,10 @@
+#include "wreport/notes.h"
 #include "wreport/options.h"
 #include "wreport/tests.h"
+#include "wreport/vartable.h"
 #include <functional>
+#include <set>
+#include <sstream>
 
 using namespace wreport;
 using namespace wreport::tests;
@@ -10,6 +14,51 @@ namespace {
 
 typedef tests::TestCodec<BufrBulletin> TestBufr;
 
+/**
+ * Encode a message with 8 subsets, whose decoding logs notes for each subset:
+ * it has associated fields with the reserved significance B31021=9, and an
+ * unsupported C24000 modifier.
+ *
+ * The encoder cannot write associated fields with a reserved significance, so
+ * this encodes the same data with significance 1 and 8, which both use
+ * B33002, and merges the two messages: the only bits that differ are those of
+ * B31021, and 1 | 8 = 9.
+ */
+std::string encode_reserved_significance(bool compression)
+{
+    auto encode = [&](int significance) {
+        auto msg                               = BufrBulletin::create();
+        msg->edition_number                    = 4;
+        msg->master_table_version_number       = 24;
+        msg->master_table_version_number_local = 0;
+        msg->originating_centre                = 98;
+        msg->compression                       = compression;
+        msg->rep_year                          = 2024;
+        msg->rep_month                         = 1;
+        msg->rep_day                           = 1;
+        msg->load_tables();
+        msg->datadesc = {WR_VAR(2, 4, 8),   WR_VAR(0, 31, 21),
+                         WR_VAR(0, 12, 101), WR_VAR(2, 4, 0),
+                         WR_VAR(2, 24, 0),  WR_VAR(0, 12, 101)};
+        for (unsigned i = 0; i < 8; ++i)
+        {
+            Subset& s = msg->obtain_subset(i);
+            s.store_variable_i(WR_VAR(0, 31, 21), significance);
+            s.store_variable_d(WR_VAR(0, 12, 101), 273.15 + i);
+            s.back().seta(
+                Var(msg->tables.btable->query(WR_VAR(0, 33, 2)), (int)i % 3));
+            s.store_variable_d(WR_VAR(0, 12, 101), 280.15 + i);
+        }
+        return msg->encode();
+    };
+
+    std::string res  = encode(1);
+    std::string sig8 = encode(8);
+    for (unsigned i = 0; i < res.size(); ++i)
+        res[i] |= sig8[i];
+    return res;
+}
+
 class Tests : public TestCase
 {
     using TestCase::TestCase;
@@ -118,6 +167,140 @@ void Tests::register_tests()
         wassert(actual(s[18].enqs()) == "GXLEK");
     });
 
+    add_method("decode_varcodes", []() {
+        // Decoding only some varcodes gives the same variables as a full
+        // decoding, without the others
+        auto opts       = BufrCodecOptions::create();
+        unsigned tested = 0;
+        for (const auto& fname : all_test_files("bufr"))
+        {
+            std::string raw = slurpfile(fname);
+            std::unique_ptr<BufrBulletin> full;
+            try
+            {
+                full = BufrBulletin::decode(raw, fname.c_str());
+            }
+            catch (std::exception&)
+            {
+                continue;
+            }
+            if (full->subsets.empty() || full->subsets[0].empty())
+                continue;
+
+            WREPORT_TEST_INFO(info);
+            info() << fname;
+
+            // Select every other varcode found in the first subset
+            std::set<Varcode> all;
+            for (const auto& var : full->subsets[0])
+                all.insert(var.code());
+            opts->decode_varcodes.clear();
+            bool odd = false;
+            for (const auto& code : all)
+            {
+                if (odd)
+                    opts->decode_varcodes.insert(code);
+                odd = !odd;
+            }
+            if (opts->decode_varcodes.empty())
+                continue;
+
+            auto part = wcallchecked(
+                BufrBulletin::decode(raw, *opts, fname.c_str()));
+            wassert(actual(part->subsets.size()) == full->subsets.size());
+            for (unsigned i = 0; i < full->subsets.size(); ++i)
+            {
+                std::vector<const Var*> expected;
+                for (const auto& var : full->subsets[i])
+                    if (opts->decode_varcodes.count(var.code()))
+                        expected.push_back(&var);
+                const Subset& s = part->subsets[i];
+                wassert(actual(s.size()) == expected.size());
+                for (unsigned j = 0; j < s.size(); ++j)
+                    wassert_true(s[j] == *expected[j]);
+            }
+            ++tested;
+        }
+        wassert(actual(tested) > 0u);
+    });
+
+    add_method("decode_threads", []() {
+        // Decoding in parallel gives the same result, or the same error, as
+        // decoding serially
+        auto opts                    = BufrCodecOptions::create();
+        opts->decode_threads         = 4;
+        unsigned tested_compressed   = 0;
+        unsigned tested_uncompressed = 0;
+        for (const auto& fname : all_test_files("bufr"))
+        {
+            WREPORT_TEST_INFO(info);
+            info() << fname;
+
+            std::string raw = slurpfile(fname);
+            std::unique_ptr<BufrBulletin> serial;
+            std::string serial_error;
+            try
+            {
+                serial = BufrBulletin::decode(raw, fname.c_str());
+            }
+            catch (std::exception& e)
+            {
+                serial_error = e.what();
+            }
+
+            std::unique_ptr<BufrBulletin> parallel;
+            std::string parallel_error;
+            try
+            {
+                parallel = BufrBulletin::decode(raw, *opts, fname.c_str());
+            }
+            catch (std::exception& e)
+            {
+                parallel_error = e.what();
+            }
+
+            wassert(actual(parallel_error) == serial_error);
+            if (!serial)
+                continue;
+            wassert(actual(parallel->diff(*serial)) == 0u);
+            if (serial->subsets.size() < 2)
+                continue;
+            if (serial->compression)
+                ++tested_compressed;
+            else
+                ++tested_uncompressed;
+        }
+        wassert(actual(tested_compressed) > 0u);
+        wassert(actual(tested_uncompressed) > 0u);
+    });
+
+    add_method("decode_threads_notes", []() {
+        // Decoding in parallel logs the same notes as decoding serially
+        auto opts            = BufrCodecOptions::create();
+        opts->decode_threads = 4;
+        for (bool compression : {false, true})
+        {
+            WREPORT_TEST_INFO(info);
+            info() << "compression: " << compression;
+            std::string raw = encode_reserved_significance(compression);
+
+            std::stringstream serial;
+            {
+                notes::Collect c(serial);
+                wassert(BufrBulletin::decode(raw));
+            }
+            wassert(actual(serial.str()).contains("B31021=9"));
+            wassert(actual(serial.str()).contains("C modifier 224000"));
+
+            std::stringstream parallel;
+            {
+                notes::Collect c(parallel);
+                wassert(BufrBulletin::decode(raw, *opts));
+            }
+            wassert(actual(parallel.str()) == serial.str());
+        }
+    });
+
     declare_test("bufr/bufr1", [](const BufrBulletin& msg) {
         wassert(actual(msg.edition_number) == 3);
         wassert(actual(msg.rep_year) == 2004);
@@ -1,7 +1,16 @@
 #include "decoder.h"
 #include "trace.h"
+#include "wreport/notes.h"
+#include "wreport/options.h"
 #include "wreport/vartable.h"
+#include <atomic>
+#include <cmath>
 #include <cstring>
+#include <exception>
+#include <optional>
+#include <sstream>
+#include <system_error>
+#include <thread>
 
 namespace wreport {
 namespace bufr {
@@ -12,6 +21,71 @@ static inline uint32_t all_ones(int bitlen)
     return ((1 << (bitlen - 1)) - 1) | (1 << (bitlen - 1));
 }
 
+/**
+ * Call job(i) for each i in [0, count), using up to \a threads threads
+ * including the calling one.
+ *
+ * The other threads use the domain error options and the notes target of the
+ * calling thread. job must not throw.
+ */
+template <typename Job>
+static void run_parallel(unsigned threads, unsigned count, Job job)
+{
+    std::atomic<unsigned> next(0);
+    bool silent                    = options::var_silent_domain_errors;
+    bool clamp                     = options::var_clamp_domain_errors;
+    options::DomainErrorHook* hook = options::var_hook_domain_errors;
+    std::ostream* notes_target     = notes::get_target();
+
+    auto worker = [&] {
+        auto o_silent = options::local_override(
+            options::var_silent_domain_errors, silent);
+        auto o_clamp = options::local_override(
+            options::var_clamp_domain_errors, clamp);
+        auto o_hook = options::local_override(
+            options::var_hook_domain_errors, hook);
+        if (notes_target)
+            notes::set_target(*notes_target);
+        while (true)
+        {
+            unsigned i = next++;
+            if (i >= count)
+                break;
+            job(i);
+        }
+    };
+
+    std::vector<std::thread> workers;
+    try
+    {
+        for (unsigned i = 1; i < std::min(threads, count); ++i)
+            workers.emplace_back(worker);
+    }
+    catch (std::system_error&)
+    {
+        // Go on with the threads that could be started
+    }
+    worker();
+    for (auto& w : workers)
+        w.join();
+}
+
+/// Decode the compressed values of a B variable, sending them to \a dest
+template <typename Sink>
+static void decode_compressed_b_value(Input& in, Varinfo info,
+                                      unsigned subset_count, Sink& dest)
+{
+    switch (info->type)
+    {
+        case Vartype::String: in.decode_string(info, subset_count, dest); break;
+        case Vartype::Binary: throw error_unimplemented("decode_b_binary TODO");
+        case Vartype::Integer:
+        case Vartype::Decimal:
+            in.decode_compressed_number(info, subset_count, dest);
+            break;
+    }
+}
+
 Decoder::Decoder(const std::string& buf, const char* fname, size_t offset,
                  BufrBulletin& out)
     : in(buf), out(out)
@@ -20,9 +94,20 @@ Decoder::Decoder(const std::string& buf, const char* fname, size_t offset,
     in.start_offset = offset;
 }
 
+Decoder::Decoder(const uint8_t* data, size_t size, const char* fname,
+                 size_t offset, BufrBulletin& out)
+    : in(data, size), out(out)
+{
+    in.fname        = fname;
+    in.start_offset = offset;
+}
+
 void Decoder::read_options(const BufrCodecOptions& opts)
 {
     conf_add_undef_attrs = opts.decode_adds_undef_attrs;
+    if (!opts.decode_varcodes.empty())
+        wanted = &opts.decode_varcodes;
+    threads = opts.decode_threads;
 }
 
 void Decoder::decode_sec1ed3()
@@ -214,6 +299,8 @@ void Decoder::decode_header()
 
 void Decoder::decode_data()
 {
+    Arena::Use use_arena(out.arena.get());
+
     out.obtain_subset(expected_subsets - 1);
 
     /* Read BUFR section 4 (Data section) */
@@ -221,7 +308,15 @@ void Decoder::decode_data()
           in.read_number(4, 0, 3), in.read_byte(4, 0), in.read_byte(4, 1),
           in.read_byte(4, 2), in.read_byte(4, 3));
 
-    if (out.compression)
+    bool parallel = threads > 1 && !verbose_output && !out.arena &&
+                    out.subsets.size() > 1;
+    if (parallel && (out.compression
+                         ? !wanted && decode_compressed_parallel()
+                         : decode_subsets_parallel()))
+    {
+        // The data section has been decoded using multiple threads
+    }
+    else if (out.compression)
     {
         // Run only once
         CompressedDecoderTarget target(in, out);
@@ -230,7 +325,10 @@ void Decoder::decode_data()
             dec.reset(
                 new VerboseDataSectionDecoder(out, target, verbose_output));
         else
+        {
+            target.wanted = wanted;
             dec.reset(new DataSectionDecoder(out, target));
+        }
         dec->associated_field.skip_missing = !conf_add_undef_attrs;
         dec->run();
     }
@@ -245,7 +343,10 @@ void Decoder::decode_data()
                 dec.reset(
                     new VerboseDataSectionDecoder(out, target, verbose_output));
             else
+            {
+                target.wanted = wanted;
                 dec.reset(new DataSectionDecoder(out, target));
+            }
             dec->associated_field.skip_missing = !conf_add_undef_attrs;
             dec->run();
         }
@@ -268,6 +369,210 @@ void Decoder::decode_data()
         }
     }
 
+    decode_sec5();
+}
+
+bool Decoder::decode_subsets_parallel()
+{
+    // Skip through the data section, recording the input state at the start
+    // of each subset. Nothing is added to the scratch subset, and only the
+    // values needed to interpret the data descriptors are decoded
+    static const std::set<Varcode> nothing;
+    Input start = in;
+    std::vector<Input> starts;
+    starts.reserve(out.subsets.size());
+    Subset scratch(out.tables);
+    // Subsets are interpreted again below: discard the notes of this pass
+    std::ostringstream scan_notes;
+    std::optional<notes::Collect> collect_scan;
+    if (notes::logs())
+        collect_scan.emplace(scan_notes);
+    try
+    {
+        for (unsigned i = 0; i < out.subsets.size(); ++i)
+        {
+            starts.push_back(in);
+            UncompressedDecoderTarget target(in, scratch);
+            target.wanted = &nothing;
+            DataSectionDecoder dec(out, target);
+            dec.associated_field.skip_missing = !conf_add_undef_attrs;
+            dec.run();
+        }
+    }
+    catch (std::exception&)
+    {
+        // Let serial decoding report the first error in the data section
+        in = start;
+        return false;
+    }
+    collect_scan.reset();
+
+    // Decode the subsets in parallel, each from its own copy of the input.
+    // The notes of each subset are collected separately, to send them in
+    // the same order as serial decoding
+    std::vector<std::exception_ptr> errors(out.subsets.size());
+    std::vector<std::ostringstream> subset_notes(
+        notes::logs() ? out.subsets.size() : 0);
+    run_parallel(threads, out.subsets.size(), [&](unsigned i) {
+        try
+        {
+            std::optional<notes::Collect> collect;
+            if (!subset_notes.empty())
+                collect.emplace(subset_notes[i]);
+            UncompressedDecoderTarget target(starts[i], out.subsets[i]);
+            target.wanted = wanted;
+            DataSectionDecoder dec(out, target);
+            dec.associated_field.skip_missing = !conf_add_undef_attrs;
+            dec.run();
+        }
+        catch (...)
+        {
+            errors[i] = std::current_exception();
+        }
+    });
+
+    // Report the error of the first failed subset, as serial decoding would
+    for (unsigned i = 0; i < errors.size(); ++i)
+    {
+        if (!subset_notes.empty())
+            notes::log() << subset_notes[i].str();
+        if (errors[i])
+            std::rethrow_exception(errors[i]);
+    }
+    return true;
+}
+
+bool Decoder::decode_compressed_parallel()
+{
+    // Skim through the data section, recording where the values of each data
+    // descriptor start, and decoding only the values needed to interpret the
+    // data descriptors
+    Input start = in;
+    CompressedScanTarget scan(in, out);
+    // Collect the notes of the scan, and of the decoding of each block, to
+    // send them in the same order as serial decoding
+    const bool collect_notes = notes::logs();
+    std::ostringstream scan_notes;
+    std::optional<notes::Collect> collect_scan;
+    if (collect_notes)
+    {
+        collect_scan.emplace(scan_notes);
+        scan.scan_notes = &scan_notes;
+    }
+    try
+    {
+        DataSectionDecoder dec(out, scan);
+        dec.associated_field.skip_missing = !conf_add_undef_attrs;
+        dec.run();
+    }
+    catch (std::exception&)
+    {
+        // Let serial decoding report the first error in the data section
+        in = start;
+        return false;
+    }
+    collect_scan.reset();
+
+    run_parallel(threads, out.subsets.size(),
+                 [&](unsigned i) { scan.prepare_subset(i); });
+
+    // Values and attributes of the same variable are decoded in order by the
+    // same job
+    std::vector<std::vector<unsigned>> jobs(scan.layout.size());
+    for (unsigned i = 0; i < scan.blocks.size(); ++i)
+        jobs[scan.blocks[i].pos].push_back(i);
+
+    std::vector<std::exception_ptr> errors(scan.blocks.size());
+    std::vector<std::ostringstream> block_notes(
+        collect_notes ? scan.blocks.size() : 0);
+    run_parallel(threads, jobs.size(), [&](unsigned job) {
+        for (unsigned i : jobs[job])
+        {
+            try
+            {
+                std::optional<notes::Collect> collect;
+                if (collect_notes)
+                    collect.emplace(block_notes[i]);
+                scan.decode_block(scan.blocks[i]);
+            }
+            catch (...)
+            {
+                errors[i] = std::current_exception();
+                return;
+            }
+        }
+    });
+
+    // Send the notes and report the error of the first failed block, as serial
+    // decoding would
+    std::string logged = scan_notes.str();
+    size_t sent        = 0;
+    for (unsigned i = 0; i < errors.size(); ++i)
+    {
+        if (collect_notes)
+        {
+            size_t offset = scan.blocks[i].notes_offset;
+            notes::log() << logged.substr(sent, offset - sent)
+                         << block_notes[i].str();
+            sent = offset;
+        }
+        if (errors[i])
+            std::rethrow_exception(errors[i]);
+    }
+    if (collect_notes)
+        notes::log() << logged.substr(sent);
+    return true;
+}
+
+void Decoder::decode_data_columns(ColumnarData& columns)
+{
+    if (!out.compression)
+        throw error_unimplemented(
+            "columnar decoding is only supported for compressed messages");
+
+    columns.clear();
+    columns.subset_count = expected_subsets;
+
+    ColumnarDecoderTarget target(in, columns);
+    DataSectionDecoder dec(out, target);
+    dec.associated_field.skip_missing = !conf_add_undef_attrs;
+    dec.run();
+
+    decode_sec5();
+}
+
+void Decoder::decode_data_visitor(DecodeVisitor& visitor)
+{
+    if (out.compression)
+    {
+        // All subsets are decoded at the same time
+        for (unsigned i = 0; i < expected_subsets; ++i)
+            visitor.begin_subset(i);
+        VisitorDecoderTarget target(in, visitor, 0, expected_subsets, true);
+        DataSectionDecoder dec(out, target);
+        dec.associated_field.skip_missing = !conf_add_undef_attrs;
+        dec.run();
+        for (unsigned i = 0; i < expected_subsets; ++i)
+            visitor.end_subset(i);
+    }
+    else
+    {
+        for (unsigned i = 0; i < expected_subsets; ++i)
+        {
+            visitor.begin_subset(i);
+            VisitorDecoderTarget target(in, visitor, i, 1, false);
+            DataSectionDecoder dec(out, target);
+            dec.associated_field.skip_missing = !conf_add_undef_attrs;
+            dec.run();
+            visitor.end_subset(i);
+        }
+    }
+
+    decode_sec5();
+}
+
+void Decoder::decode_sec5()
+{
     /* Read BUFR section 5 (Data section) */
     in.check_available_section_data(5, 0, 4,
                                     "section 5 of BUFR message (end section)");
@@ -284,6 +589,24 @@ void Decoder::decode_data()
     //     subsets_no, out.subsets.size());
 }
 
+/*
+ * DecoderTarget
+ */
+
+bool DecoderTarget::add_to_layout(Varinfo info)
+{
+    if (!wanted)
+        return true;
+    layout.push_back(info);
+    if (wanted->find(info->code) == wanted->end())
+    {
+        layout_pos.push_back(skipped);
+        return false;
+    }
+    layout_pos.push_back(added++);
+    return true;
+}
+
 /*
  * UncompressedDecoderTarget
  */
@@ -293,13 +616,19 @@ UncompressedDecoderTarget::UncompressedDecoderTarget(Input& in, Subset& out)
 {
 }
 
-const Subset& UncompressedDecoderTarget::reference_subset() const
+void UncompressedDecoderTarget::define_bitmap(bulletin::Bitmaps& bitmaps,
+                                              const Var& bitmap) const
 {
-    return out;
+    if (wanted)
+        bitmaps.define(bitmap, layout);
+    else
+        bitmaps.define(bitmap, out);
 }
 
 Varinfo UncompressedDecoderTarget::lookup_info(unsigned pos) const
 {
+    if (wanted)
+        return layout[pos];
     return out[pos].info();
 }
 
@@ -318,6 +647,8 @@ Var UncompressedDecoderTarget::decode_uniform_b_value(Varinfo info)
 
 const Var& UncompressedDecoderTarget::decode_and_add_to_all(Varinfo info)
 {
+    if (!add_to_layout(info))
+        return last_skipped.emplace(decode_uniform_b_value(info));
     out.store_variable(decode_uniform_b_value(info));
     return out.back();
 }
@@ -331,6 +662,9 @@ const Var& UncompressedDecoderTarget::decode_and_add_bitmap(
     // Create a single use varinfo to store the bitmap
     Varinfo info = tables.get_bitmap(code, buf);
 
+    if (!add_to_layout(info))
+        return last_skipped.emplace(info, buf);
+
     // Store the bitmap
     out.store_variable(Var(info, buf));
 
@@ -340,6 +674,12 @@ const Var& UncompressedDecoderTarget::decode_and_add_bitmap(
 void UncompressedDecoderTarget::decode_and_set_attribute(Varinfo info,
                                                          unsigned pos)
 {
+    pos = output_pos(pos);
+    if (pos == skipped)
+    {
+        in.skip_bits(info->bit_len);
+        return;
+    }
     Var var = decode_uniform_b_value(info);
     TRACE(" define_attribute adding var %01d%02d%03d %s as attribute to "
           "%01d%02d%03d\n",
@@ -351,6 +691,11 @@ void UncompressedDecoderTarget::decode_and_set_attribute(Varinfo info,
 
 void UncompressedDecoderTarget::decode_and_add_b_value(Varinfo info)
 {
+    if (!add_to_layout(info))
+    {
+        in.skip_bits(info->bit_len);
+        return;
+    }
     Var var = decode_uniform_b_value(info);
     out.store_variable(var);
     IFTRACE
@@ -363,12 +708,19 @@ void UncompressedDecoderTarget::decode_and_add_b_value(Varinfo info)
 void UncompressedDecoderTarget::decode_and_add_b_value_with_associated_field(
     Varinfo info, const bulletin::AssociatedField& field)
 {
+    if (!add_to_layout(info))
+    {
+        in.skip_bits(field.bit_count);
+        in.skip_bits(info->bit_len);
+        return;
+    }
+
     /// If set, it is the associated field for the next variable to be decoded
     TRACE("decode_b_data:reading %d bits of C04 information\n",
           field.bit_count);
     uint32_t val = in.get_bits(field.bit_count);
     TRACE("decode_b_data:read C04 information %x\n", val);
-    auto cur_associated_field = field.make_attribute(val);
+    auto cur_associated_field = field.attribute(val);
 
     Var var = decode_uniform_b_value(info);
     out.store_variable(var);
@@ -377,19 +729,25 @@ void UncompressedDecoderTarget::decode_and_add_b_value_with_associated_field(
         TRACE(" define_variable decoded: ");
         out.back().print(stderr);
     }
-    if (cur_associated_field.get())
+    if (cur_associated_field)
     {
         IFTRACE
         {
             TRACE(" define_variable with associated field: ");
             cur_associated_field->print(stderr);
         }
-        out.back().seta(std::move(cur_associated_field));
+        out.back().seta(std::move(*cur_associated_field));
     }
 }
 
 void UncompressedDecoderTarget::decode_and_add_raw_character_data(Varinfo info)
 {
+    if (!add_to_layout(info))
+    {
+        in.skip_bits(info->len * 8);
+        return;
+    }
+
     std::string buf;
     buf.resize(info->len);
     TRACE("decode_c_data:character data %d long\n", info->len);
@@ -446,13 +804,19 @@ CompressedDecoderTarget::CompressedDecoderTarget(Input& in, Bulletin& out)
 {
 }
 
-const Subset& CompressedDecoderTarget::reference_subset() const
+void CompressedDecoderTarget::define_bitmap(bulletin::Bitmaps& bitmaps,
+                                            const Var& bitmap) const
 {
-    return out.subsets[0];
+    if (wanted)
+        bitmaps.define(bitmap, layout);
+    else
+        bitmaps.define(bitmap, out.subsets[0]);
 }
 
 Varinfo CompressedDecoderTarget::lookup_info(unsigned pos) const
 {
+    if (wanted)
+        return layout[pos];
     return out.subset(0)[pos].info();
 }
 
@@ -471,16 +835,23 @@ Var CompressedDecoderTarget::decode_uniform_b_value(Varinfo info)
     return var;
 }
 
-void CompressedDecoderTarget::decode_b_value(
-    Varinfo info, std::function<void(unsigned, Var&&)> dest)
+template <typename Sink>
+void CompressedDecoderTarget::decode_b_value(Varinfo info, Sink& dest)
+{
+    decode_compressed_b_value(in, info, subset_count, dest);
+}
+
+void CompressedDecoderTarget::skip_b_value(Varinfo info)
 {
     switch (info->type)
     {
-        case Vartype::String: in.decode_string(info, subset_count, dest); break;
+        case Vartype::String:
+            in.skip_compressed_string(info, subset_count);
+            break;
         case Vartype::Binary: throw error_unimplemented("decode_b_binary TODO");
         case Vartype::Integer:
         case Vartype::Decimal:
-            in.decode_compressed_number(info, subset_count, dest);
+            in.skip_compressed_number(info, subset_count);
             break;
     }
 }
@@ -488,6 +859,8 @@ void CompressedDecoderTarget::decode_b_value(
 const Var& CompressedDecoderTarget::decode_and_add_to_all(Varinfo info)
 {
     Var res(decode_uniform_b_value(info));
+    if (!add_to_layout(info))
+        return last_skipped.emplace(std::move(res));
     for (unsigned i = 0; i < subset_count; ++i)
         out.subsets[i].store_variable(res);
     return out.subsets[0].back();
@@ -503,6 +876,9 @@ const Var& CompressedDecoderTarget::decode_and_add_bitmap(const Tables& tables,
     // Create a single use varinfo to store the bitmap
     Varinfo info = tables.get_bitmap(code, buf);
 
+    if (!add_to_layout(info))
+        return last_skipped.emplace(info, buf);
+
     // Store the bitmap
     Var bmp(info, buf);
     for (unsigned i = 0; i < subset_count; ++i)
@@ -514,34 +890,39 @@ const Var& CompressedDecoderTarget::decode_and_add_bitmap(const Tables& tables,
 void CompressedDecoderTarget::decode_and_set_attribute(Varinfo info,
                                                        unsigned pos)
 {
-    decode_b_value(info, [&](unsigned idx, Var&& var) {
-        TRACE("define_attribute:seta subset[%u][%u] (%01d%02d%03d) "
-              "%01d%02d%03d %s\n",
-              idx, pos, WR_VAR_FXY(out.subsets[idx][pos].code()),
-              WR_VAR_FXY(var.code()), var.enq("-"));
-        if (!var.isset())
-            return;
-        out.subsets[idx][pos].seta(std::move(var));
-    });
+    pos = output_pos(pos);
+    if (pos == skipped)
+    {
+        skip_b_value(info);
+        return;
+    }
+    AttributeToSubsets dest(out, subset_count, pos);
+    decode_b_value(info, dest);
 }
 
 void CompressedDecoderTarget::decode_and_add_b_value(Varinfo info)
 {
-    DispatchToSubsets dest(out, subset_count);
-    switch (info->type)
+    if (!add_to_layout(info))
     {
-        case Vartype::String: in.decode_string(info, subset_count, dest); break;
-        case Vartype::Binary: throw error_unimplemented("decode_b_binary TODO");
-        case Vartype::Integer:
-        case Vartype::Decimal:
-            in.decode_compressed_number(info, subset_count, dest);
-            break;
+        skip_b_value(info);
+        return;
     }
+    DispatchToSubsets dest(out, subset_count);
+    decode_b_value(info, dest);
 }
 
 void CompressedDecoderTarget::decode_and_add_b_value_with_associated_field(
     Varinfo info, const bulletin::AssociatedField& field)
 {
+    if (!add_to_layout(info))
+    {
+        if (info->type == Vartype::String || info->type == Vartype::Binary)
+            skip_b_value(info);
+        else
+            in.skip_compressed_number_af(info, field, subset_count);
+        return;
+    }
+
     DispatchToSubsets dest(out, subset_count);
     switch (info->type)
     {
@@ -549,10 +930,7 @@ void CompressedDecoderTarget::decode_and_add_b_value_with_associated_field(
         case Vartype::Binary: throw error_unimplemented("decode_b_binary TODO");
         case Vartype::Integer:
         case Vartype::Decimal:
-            in.decode_compressed_number_af(
-                info, field, subset_count, [&](unsigned subset_no, Var&& var) {
-                    dest.add_var(subset_no, std::move(var));
-                });
+            in.decode_compressed_number_af(info, field, subset_count, dest);
             break;
     }
 }
@@ -601,6 +979,518 @@ void CompressedDecoderTarget::print_last_attribute_added(FILE* out,
     }
 }
 
+/*
+ * CompressedScanTarget
+ */
+
+CompressedBlock::CompressedBlock(const Input& start, Varinfo info,
+                                 unsigned pos)
+    : start(start), info(info), pos(pos)
+{
+}
+
+CompressedScanTarget::CompressedScanTarget(Input& in, Bulletin& out)
+    : CompressedDecoderTarget(in, out)
+{
+}
+
+CompressedBlock& CompressedScanTarget::add_block(Varinfo info, unsigned pos)
+{
+    CompressedBlock& res = blocks.emplace_back(in, info, pos);
+    if (scan_notes)
+        res.notes_offset = scan_notes->tellp();
+    return res;
+}
+
+void CompressedScanTarget::define_bitmap(bulletin::Bitmaps& bitmaps,
+                                         const Var& bitmap) const
+{
+    bitmaps.define(bitmap, layout);
+}
+
+Varinfo CompressedScanTarget::lookup_info(unsigned pos) const
+{
+    return layout[pos];
+}
+
+const Var& CompressedScanTarget::decode_and_add_to_all(Varinfo info)
+{
+    CompressedBlock& block = add_block(info, layout.size());
+    layout.push_back(info);
+    return block.uniform.emplace(decode_uniform_b_value(info));
+}
+
+const Var& CompressedScanTarget::decode_and_add_bitmap(const Tables& tables,
+                                                       Varcode code,
+                                                       unsigned bitmap_size)
+{
+    std::string buf        = in.decode_compressed_bitmap(bitmap_size);
+    Varinfo info           = tables.get_bitmap(code, buf);
+    CompressedBlock& block = add_block(info, layout.size());
+    layout.push_back(info);
+    return block.uniform.emplace(info, buf);
+}
+
+void CompressedScanTarget::decode_and_set_attribute(Varinfo info, unsigned pos)
+{
+    add_block(info, pos).attribute = true;
+    skip_b_value(info);
+}
+
+void CompressedScanTarget::decode_and_add_b_value(Varinfo info)
+{
+    add_block(info, layout.size());
+    layout.push_back(info);
+    skip_b_value(info);
+}
+
+void CompressedScanTarget::decode_and_add_b_value_with_associated_field(
+    Varinfo info, const bulletin::AssociatedField& field)
+{
+    CompressedBlock& block = add_block(info, layout.size());
+    block.af_bit_count     = field.bit_count;
+    block.af_significance  = field.significance;
+    block.af_skip_missing  = field.skip_missing;
+    layout.push_back(info);
+    if (info->type == Vartype::String || info->type == Vartype::Binary)
+        skip_b_value(info);
+    else
+        in.skip_compressed_number_af(info, field, subset_count);
+}
+
+void CompressedScanTarget::prepare_subset(unsigned subset)
+{
+    Subset& dest = out.subsets[subset];
+    dest.reserve(layout.size());
+    for (Varinfo info : layout)
+        dest.store_variable_undef(info);
+}
+
+void CompressedScanTarget::decode_block(const CompressedBlock& block)
+{
+    if (block.uniform)
+    {
+        for (unsigned i = 0; i < subset_count; ++i)
+            out.subsets[i][block.pos] = *block.uniform;
+        return;
+    }
+
+    Input input(block.start);
+    if (block.attribute)
+    {
+        AttributeToSubsets dest(out, subset_count, block.pos);
+        decode_compressed_b_value(input, block.info, subset_count, dest);
+        return;
+    }
+
+    SetInSubsets dest(out, subset_count, block.pos);
+    if (!block.af_bit_count || block.info->type == Vartype::String ||
+        block.info->type == Vartype::Binary)
+    {
+        decode_compressed_b_value(input, block.info, subset_count, dest);
+        return;
+    }
+
+    bulletin::AssociatedField field(*out.tables.btable);
+    field.bit_count    = block.af_bit_count;
+    field.significance = block.af_significance;
+    field.skip_missing = block.af_skip_missing;
+    input.decode_compressed_number_af(block.info, field, subset_count, dest);
+}
+
+/*
+ * ColumnarDecoderTarget
+ */
+
+ColumnarDecoderTarget::ColumnarDecoderTarget(Input& in, ColumnarData& out)
+    : DecoderTarget(in), out(out)
+{
+}
+
+Column& ColumnarDecoderTarget::add_column(Varinfo info)
+{
+    layout.push_back(info);
+    out.columns.emplace_back(info);
+    Column& res = out.columns.back();
+    res.resize(out.subset_count);
+    return res;
+}
+
+void ColumnarDecoderTarget::define_bitmap(bulletin::Bitmaps& bitmaps,
+                                          const Var& bitmap) const
+{
+    bitmaps.define(bitmap, layout);
+}
+
+Varinfo ColumnarDecoderTarget::lookup_info(unsigned pos) const
+{
+    return out.columns[pos].info;
+}
+
+Var ColumnarDecoderTarget::decode_uniform_b_value(Varinfo info)
+{
+    Var var(info);
+    switch (info->type)
+    {
+        case Vartype::String: in.decode_string(var, out.subset_count); break;
+        case Vartype::Binary: throw error_unimplemented("decode_b_binary TODO");
+        case Vartype::Integer:
+        case Vartype::Decimal:
+            in.decode_compressed_semantic_number(var, out.subset_count);
+            break;
+    }
+    return var;
+}
+
+void ColumnarDecoderTarget::decode_b_value(Column& column)
+{
+    Varinfo info = column.info;
+    switch (info->type)
+    {
+        case Vartype::String:
+            in.decode_string(info, out.subset_count,
+                             [&](unsigned subset, Var&& var) {
+                                 column.set(subset, var);
+                             });
+            return;
+        case Vartype::Binary: throw error_unimplemented("decode_b_binary TODO");
+        case Vartype::Integer:
+        case Vartype::Decimal: break;
+    }
+
+    uint32_t base;
+    uint32_t diffbits;
+    if (in.decode_compressed_base(info, base, diffbits))
+        // The column is already filled with missing values
+        return;
+
+    if (!diffbits)
+    {
+        column.set_all(Var(info, info->decode_binary(base)));
+        return;
+    }
+
+    // Values outside the range of the variable are handled as domain errors
+    // by going through Var, as when decoding into subsets
+    if (info->type == Vartype::Decimal)
+    {
+        in.decode_compressed_numbers(info, base, diffbits, out.subset_count,
+                                     column.doubles.data(),
+                                     column.missing.data());
+        for (unsigned i = 0; i < out.subset_count; ++i)
+        {
+            if (column.missing[i])
+                continue;
+            double val = column.doubles[i];
+            if (val < info->dmin || val > info->dmax)
+                column.set(i, Var(info, val));
+        }
+        return;
+    }
+
+    std::vector<double> values(out.subset_count);
+    in.decode_compressed_numbers(info, base, diffbits, out.subset_count,
+                                 values.data(), column.missing.data());
+    for (unsigned i = 0; i < out.subset_count; ++i)
+    {
+        if (column.missing[i])
+            continue;
+        long val = lround(values[i]);
+        if (val < info->imin || val > info->imax)
+            column.set(i, Var(info, values[i]));
+        else
+            column.ints[i] = (int32_t)val;
+    }
+}
+
+const Var& ColumnarDecoderTarget::decode_and_add_to_all(Varinfo info)
+{
+    const Var& res = last_added.emplace(decode_uniform_b_value(info));
+    add_column(info).set_all(res);
+    return res;
+}
+
+const Var& ColumnarDecoderTarget::decode_and_add_bitmap(const Tables& tables,
+                                                        Varcode code,
+                                                        unsigned bitmap_size)
+{
+    // Read the bitmap
+    std::string buf = in.decode_compressed_bitmap(bitmap_size);
+
+    // Create a single use varinfo to store the bitmap
+    Varinfo info = tables.get_bitmap(code, buf);
+
+    const Var& res = last_added.emplace(info, buf);
+    add_column(info).set_all(res);
+    return res;
+}
+
+void ColumnarDecoderTarget::decode_and_set_attribute(Varinfo info,
+                                                     unsigned pos)
+{
+    decode_b_value(
+        out.columns[pos].obtain_attribute(info, out.subset_count));
+}
+
+void ColumnarDecoderTarget::decode_and_add_b_value(Varinfo info)
+{
+    decode_b_value(add_column(info));
+}
+
+void ColumnarDecoderTarget::decode_and_add_b_value_with_associated_field(
+    Varinfo info, const bulletin::AssociatedField& field)
+{
+    Column& column = add_column(info);
+    std::function<void(unsigned, Var&&)> dest = [&](unsigned subset,
+                                                    Var&& var) {
+        column.set(subset, var);
+        if (const Var* attr = var.next_attr())
+            column.obtain_attribute(attr->info(), out.subset_count)
+                .set(subset, *attr);
+    };
+    switch (info->type)
+    {
+        case Vartype::String:
+            in.decode_string(info, out.subset_count, dest);
+            break;
+        case Vartype::Binary: throw error_unimplemented("decode_b_binary TODO");
+        case Vartype::Integer:
+        case Vartype::Decimal:
+            in.decode_compressed_number_af(info, field, out.subset_count, dest);
+            break;
+    }
+}
+
+void ColumnarDecoderTarget::decode_and_add_raw_character_data(Varinfo info)
+{
+    error_unimplemented::throwf(
+        "C05%03d character data found in compressed message and it is not "
+        "clear how it should be handled",
+        WR_VAR_Y(info->code));
+}
+
+int ColumnarDecoderTarget::decode_c03_refval_override(unsigned bits)
+{
+    error_unimplemented::throwf(
+        "C03%03u reference value override found in compressed message and it "
+        "is not clear how it should be handled",
+        bits);
+}
+
+void ColumnarDecoderTarget::print_last_variable_added(FILE* out)
+{
+    const Column& column = this->out.columns.back();
+    for (unsigned i = 0; i < column.size(); ++i)
+    {
+        column.var(i).format(out, "-");
+        putc(' ', out);
+    }
+}
+
+void ColumnarDecoderTarget::print_last_attribute_added(FILE* out,
+                                                       Varcode code,
+                                                       unsigned pos)
+{
+    const Column* attr = this->out.columns[pos].attribute(code);
+    for (unsigned i = 0; i < this->out.subset_count; ++i)
+    {
+        if (attr)
+            attr->var(i).format(out, "-");
+        else
+            putc('-', out);
+        putc(' ', out);
+    }
+}
+
+/*
+ * VisitorDecoderTarget
+ */
+
+VisitorDecoderTarget::VisitorDecoderTarget(Input& in, DecodeVisitor& visitor,
+                                           unsigned subset,
+                                           unsigned subset_count,
+                                           bool compressed)
+    : DecoderTarget(in), visitor(visitor), subset(subset),
+      subset_count(subset_count), compressed(compressed)
+{
+}
+
+void VisitorDecoderTarget::define_bitmap(bulletin::Bitmaps& bitmaps,
+                                         const Var& bitmap) const
+{
+    bitmaps.define(bitmap, layout);
+}
+
+Varinfo VisitorDecoderTarget::lookup_info(unsigned pos) const
+{
+    return layout[pos];
+}
+
+Var VisitorDecoderTarget::decode_uniform_b_value(Varinfo info)
+{
+    Var var(info);
+    switch (info->type)
+    {
+        case Vartype::String:
+            if (compressed)
+                in.decode_string(var, subset_count);
+            else
+                in.decode_string(var);
+            break;
+        case Vartype::Binary:
+            if (compressed)
+                throw error_unimplemented("decode_b_binary TODO");
+            in.decode_binary(var);
+            break;
+        case Vartype::Integer:
+        case Vartype::Decimal:
+            if (compressed)
+                in.decode_compressed_semantic_number(var, subset_count);
+            else
+                in.decode_number(var);
+            break;
+    }
+    return var;
+}
+
+void VisitorDecoderTarget::add_to_all(const Var& var)
+{
+    layout.push_back(var.info());
+    for (unsigned i = 0; i < subset_count; ++i)
+        visitor.value(subset + i, var);
+}
+
+void VisitorDecoderTarget::decode_compressed(
+    Varinfo info, DispatchToVisitor& dest,
+    const bulletin::AssociatedField* field)
+{
+    switch (info->type)
+    {
+        case Vartype::String: in.decode_string(info, subset_count, dest); break;
+        case Vartype::Binary: throw error_unimplemented("decode_b_binary TODO");
+        case Vartype::Integer:
+        case Vartype::Decimal:
+            if (field)
+                in.decode_compressed_number_af(info, *field, subset_count,
+                                               dest);
+            else
+                in.decode_compressed_number(info, subset_count, dest);
+            break;
+    }
+}
+
+const Var& VisitorDecoderTarget::decode_and_add_to_all(Varinfo info)
+{
+    const Var& res = last_added.emplace(decode_uniform_b_value(info));
+    add_to_all(res);
+    return res;
+}
+
+const Var& VisitorDecoderTarget::decode_and_add_bitmap(const Tables& tables,
+                                                       Varcode code,
+                                                       unsigned bitmap_size)
+{
+    // Read the bitmap
+    std::string buf = compressed ? in.decode_compressed_bitmap(bitmap_size)
+                                 : in.decode_uncompressed_bitmap(bitmap_size);
+
+    // Create a single use varinfo to store the bitmap
+    Varinfo info = tables.get_bitmap(code, buf);
+
+    const Var& res = last_added.emplace(info, buf);
+    add_to_all(res);
+    return res;
+}
+
+void VisitorDecoderTarget::decode_and_set_attribute(Varinfo info, unsigned pos)
+{
+    if (compressed)
+    {
+        DispatchToVisitor dest(visitor, subset_count, pos, true);
+        decode_compressed(info, dest);
+        return;
+    }
+    Var var = decode_uniform_b_value(info);
+    if (var.isset())
+        visitor.attribute(subset, pos, var);
+}
+
+void VisitorDecoderTarget::decode_and_add_b_value(Varinfo info)
+{
+    unsigned pos = layout.size();
+    layout.push_back(info);
+    if (compressed)
+    {
+        DispatchToVisitor dest(visitor, subset_count, pos, false);
+        decode_compressed(info, dest);
+        return;
+    }
+    visitor.value(subset, decode_uniform_b_value(info));
+}
+
+void VisitorDecoderTarget::decode_and_add_b_value_with_associated_field(
+    Varinfo info, const bulletin::AssociatedField& field)
+{
+    unsigned pos = layout.size();
+    layout.push_back(info);
+    if (compressed)
+    {
+        DispatchToVisitor dest(visitor, subset_count, pos, false);
+        decode_compressed(info, dest, &field);
+        return;
+    }
+
+    uint32_t val = in.get_bits(field.bit_count);
+    auto attr    = field.attribute(val);
+    visitor.value(subset, decode_uniform_b_value(info));
+    if (attr)
+        visitor.attribute(subset, pos, *attr);
+}
+
+void VisitorDecoderTarget::decode_and_add_raw_character_data(Varinfo info)
+{
+    if (compressed)
+        error_unimplemented::throwf(
+            "C05%03d character data found in compressed message and it is "
+            "not clear how it should be handled",
+            WR_VAR_Y(info->code));
+
+    std::string buf;
+    buf.resize(info->len);
+    for (unsigned i = 0; i < info->len; ++i)
+        buf[i] = in.get_bits(8);
+    layout.push_back(info);
+    visitor.value(subset, Var(info, buf));
+}
+
+int VisitorDecoderTarget::decode_c03_refval_override(unsigned bits)
+{
+    if (compressed)
+        error_unimplemented::throwf(
+            "C03%03u reference value override found in compressed message and "
+            "it is not clear how it should be handled",
+            bits);
+
+    uint32_t res      = in.get_bits(bits);
+    uint32_t sign_bit = 1 << (bits - 1);
+
+    if (res & (1 << (bits - 1)))
+        return -(res & ~sign_bit);
+    else
+        return res;
+}
+
+void VisitorDecoderTarget::print_last_variable_added(FILE* out)
+{
+    // Values are not stored, and there is nothing to print
+}
+
+void VisitorDecoderTarget::print_last_attribute_added(FILE* out, Varcode code,
+                                                      unsigned pos)
+{
+    // Values are not stored, and there is nothing to print
+}
+
 /*
  * DataSectionDecoder
  */
@@ -648,7 +1538,7 @@ void DataSectionDecoder::define_bitmap(unsigned bitmap_size)
         TRACE("\n");
     }
 
-    bitmaps.define(bmp, target.reference_subset());
+    target.define_bitmap(bitmaps, bmp);
 }
 
 void DataSectionDecoder::define_attribute(Varinfo info, unsigned pos)
@@ -1,15 +1,18 @@
 #ifndef WREPORT_BUFR_DECODER_H
 #define WREPORT_BUFR_DECODER_H
 
+#include <iosfwd>
+#include <optional>
+#include <set>
+#include <vector>
 #include <wreport/bufr/input.h>
 #include <wreport/bulletin.h>
 #include <wreport/bulletin/interpreter.h>
+#include <wreport/columns.h>
 #include <wreport/var.h>
 
 namespace wreport {
 namespace bufr {
-struct DispatchToSubsets;
-
 struct Decoder
 {
     /// Input data
@@ -24,9 +27,15 @@ struct Decoder
     unsigned optional_section_length = 0;
     /// If set, be verbose and print a trace of decoding to the given file
     FILE* verbose_output             = nullptr;
+    /// If set, only variables with these codes are added to the output
+    const std::set<Varcode>* wanted  = nullptr;
+    /// Maximum number of threads used to decode the data section
+    unsigned threads                 = 1;
 
     Decoder(const std::string& buf, const char* fname, size_t offset,
             BufrBulletin& out);
+    Decoder(const uint8_t* data, size_t size, const char* fname, size_t offset,
+            BufrBulletin& out);
 
     void read_options(const BufrCodecOptions& opts);
 
@@ -38,6 +47,44 @@ struct Decoder
 
     /* Decode message data section after the header has been decoded */
     void decode_data();
+
+    /**
+     * Decode the subsets of an uncompressed data section using multiple
+     * threads.
+     *
+     * A first pass skips through the data section to find where each subset
+     * starts, then the subsets are decoded in parallel into the subsets of
+     * out, which must have already been created.
+     *
+     * @returns false, without decoding anything, if the first pass fails
+     */
+    bool decode_subsets_parallel();
+
+    /**
+     * Decode a compressed data section using multiple threads.
+     *
+     * A first pass skims through the data section to find where the values
+     * of each data descriptor start, then they are decoded in parallel into
+     * the subsets of out, which must have already been created.
+     *
+     * @returns false, without decoding anything, if the first pass fails
+     */
+    bool decode_compressed_parallel();
+
+    /**
+     * Decode the data section of a compressed message by columns, after the
+     * header has been decoded
+     */
+    void decode_data_columns(ColumnarData& columns);
+
+    /**
+     * Decode the data section sending its contents to \a visitor, after the
+     * header has been decoded
+     */
+    void decode_data_visitor(DecodeVisitor& visitor);
+
+    /* Check the end section, and record where sections end */
+    void decode_sec5();
 };
 
 struct DecoderTarget
@@ -45,17 +92,62 @@ struct DecoderTarget
     /// Input buffer
     Input& in;
 
+    /**
+     * If set, only variables with these codes are added to the output, and
+     * the others are skipped
+     */
+    const std::set<Varcode>* wanted = nullptr;
+
+    /**
+     * When skipping variables, Varinfo of all the variables decoded so far,
+     * including those that have not been added to the output.
+     *
+     * Variable positions given to the target, like those used by bitmaps,
+     * refer to this sequence.
+     */
+    std::vector<Varinfo> layout;
+
+    /**
+     * When skipping variables, position in the output of each variable in
+     * layout, or skipped if it has not been added
+     */
+    std::vector<unsigned> layout_pos;
+
+    /// Value used in layout_pos for variables that have not been added
+    static constexpr unsigned skipped = (unsigned)-1;
+
+    /// Last value decoded and not added to the output
+    std::optional<Var> last_skipped;
+
+    /// Number of variables added to the output
+    unsigned added = 0;
+
     DecoderTarget(Input& in) : in(in) {}
     virtual ~DecoderTarget() {}
 
     /**
-     * Return the reference to a subset that is receiving the data currently
-     * decoded.
+     * Account for a new variable described by \a info.
      *
-     * For uncompressed decoders, this is the current subset. For compressed
-     * decoders, it is the first subset.
+     * @returns true if it should be added to the output, false if it should
+     * be skipped
      */
-    virtual const Subset& reference_subset() const = 0;
+    bool add_to_layout(Varinfo info);
+
+    /**
+     * Return the position in the output of the variable at position \a pos,
+     * or skipped if it has not been added
+     */
+    unsigned output_pos(unsigned pos) const
+    {
+        return wanted ? layout_pos[pos] : pos;
+    }
+
+    /**
+     * Activate \a bitmap in \a bitmaps, referring to the variables decoded so
+     * far
+     */
+    virtual void define_bitmap(bulletin::Bitmaps& bitmaps,
+                               const Var& bitmap) const = 0;
 
     /**
      * Return information about a value previously stored at the given position
@@ -126,7 +218,8 @@ struct UncompressedDecoderTarget : public DecoderTarget
 
     UncompressedDecoderTarget(Input& in, Subset& out);
 
-    const Subset& reference_subset() const override;
+    void define_bitmap(bulletin::Bitmaps& bitmaps,
+                       const Var& bitmap) const override;
     Varinfo lookup_info(unsigned pos) const override;
     Var decode_uniform_b_value(Varinfo info) override;
     const Var& decode_and_add_to_all(Varinfo info) override;
@@ -154,7 +247,183 @@ struct CompressedDecoderTarget : public DecoderTarget
 
     CompressedDecoderTarget(Input& in, Bulletin& out);
 
-    const Subset& reference_subset() const override;
+    void define_bitmap(bulletin::Bitmaps& bitmaps,
+                       const Var& bitmap) const override;
+    Varinfo lookup_info(unsigned pos) const override;
+    Var decode_uniform_b_value(Varinfo info) override;
+    const Var& decode_and_add_to_all(Varinfo info) override;
+    const Var& decode_and_add_bitmap(const Tables& tables, Varcode code,
+                                     unsigned bitmap_size) override;
+    void decode_and_set_attribute(Varinfo info, unsigned pos) override;
+    void decode_and_add_b_value(Varinfo info) override;
+    void decode_and_add_b_value_with_associated_field(
+        Varinfo info, const bulletin::AssociatedField& field) override;
+    void decode_and_add_raw_character_data(Varinfo info) override;
+    int decode_c03_refval_override(unsigned bits) override;
+
+    void print_last_variable_added(FILE* out) override;
+    void print_last_attribute_added(FILE* out, Varcode code,
+                                    unsigned pos) override;
+
+protected:
+    /// Decode a compressed B value and send it to the given sink
+    template <typename Sink> void decode_b_value(Varinfo info, Sink& dest);
+
+    /// Skip a compressed B value without decoding it
+    void skip_b_value(Varinfo info);
+};
+
+/// Location of the values of a data descriptor in a compressed data section
+struct CompressedBlock
+{
+    /// Input positioned at the start of the values
+    Input start;
+
+    /// Description of the values
+    Varinfo info;
+
+    /// Position in the subsets of the variable that receives the values
+    unsigned pos;
+
+    /// True if the values are attributes of the variable at pos
+    bool attribute = false;
+
+    /// Bit count of the associated field of each value, or 0 if none
+    unsigned af_bit_count = 0;
+
+    /// Significance of the associated field
+    unsigned af_significance = 0;
+
+    /// Skip missing associated field values
+    bool af_skip_missing = false;
+
+    /// Value already decoded during the scan, the same in all subsets
+    std::optional<Var> uniform;
+
+    /// Length of the notes logged by the scan before reaching the block
+    size_t notes_offset = 0;
+
+    CompressedBlock(const Input& start, Varinfo info, unsigned pos);
+};
+
+/**
+ * Decoder target for compressed data sections that only records where the
+ * values of each data descriptor start, decoding only replication factors,
+ * bitmaps and the other values needed to interpret the data descriptors.
+ *
+ * The recorded blocks can then be decoded in any order, and blocks referring
+ * to different variables can be decoded concurrently.
+ */
+struct CompressedScanTarget : public CompressedDecoderTarget
+{
+    /// Blocks found in the data section, in order
+    std::vector<CompressedBlock> blocks;
+
+    /**
+     * Stream collecting the notes logged by the scan, used to record where
+     * each block starts in them, or nullptr if notes are not collected
+     */
+    std::ostringstream* scan_notes = nullptr;
+
+    CompressedScanTarget(Input& in, Bulletin& out);
+
+    /// Add a block starting at the current input position
+    CompressedBlock& add_block(Varinfo info, unsigned pos);
+
+    void define_bitmap(bulletin::Bitmaps& bitmaps,
+                       const Var& bitmap) const override;
+    Varinfo lookup_info(unsigned pos) const override;
+    const Var& decode_and_add_to_all(Varinfo info) override;
+    const Var& decode_and_add_bitmap(const Tables& tables, Varcode code,
+                                     unsigned bitmap_size) override;
+    void decode_and_set_attribute(Varinfo info, unsigned pos) override;
+    void decode_and_add_b_value(Varinfo info) override;
+    void decode_and_add_b_value_with_associated_field(
+        Varinfo info, const bulletin::AssociatedField& field) override;
+
+    /**
+     * Fill a subset of out with missing values for all the variables found by
+     * the scan
+     */
+    void prepare_subset(unsigned subset);
+
+    /**
+     * Decode the values of a block into the subsets prepared with
+     * prepare_subset()
+     */
+    void decode_block(const CompressedBlock& block);
+};
+
+/**
+ * Decoder target for compressed data sections, that stores the values of each
+ * variable as a Column instead of creating a Var per subset
+ */
+struct ColumnarDecoderTarget : public DecoderTarget
+{
+    /// Output columns
+    ColumnarData& out;
+
+    /// Last value decoded with decode_and_add_to_all or decode_and_add_bitmap
+    std::optional<Var> last_added;
+
+    ColumnarDecoderTarget(Input& in, ColumnarData& out);
+
+    void define_bitmap(bulletin::Bitmaps& bitmaps,
+                       const Var& bitmap) const override;
+    Varinfo lookup_info(unsigned pos) const override;
+    Var decode_uniform_b_value(Varinfo info) override;
+    const Var& decode_and_add_to_all(Varinfo info) override;
+    const Var& decode_and_add_bitmap(const Tables& tables, Varcode code,
+                                     unsigned bitmap_size) override;
+    void decode_and_set_attribute(Varinfo info, unsigned pos) override;
+    void decode_and_add_b_value(Varinfo info) override;
+    void decode_and_add_b_value_with_associated_field(
+        Varinfo info, const bulletin::AssociatedField& field) override;
+    void decode_and_add_raw_character_data(Varinfo info) override;
+    int decode_c03_refval_override(unsigned bits) override;
+
+    void print_last_variable_added(FILE* out) override;
+    void print_last_attribute_added(FILE* out, Varcode code,
+                                    unsigned pos) override;
+
+protected:
+    /// Add a new column for \a info
+    Column& add_column(Varinfo info);
+
+    /// Decode a compressed B value into \a column
+    void decode_b_value(Column& column);
+};
+
+/**
+ * Decoder target that sends the decoded values to a DecodeVisitor, without
+ * storing them
+ */
+struct VisitorDecoderTarget : public DecoderTarget
+{
+    /// Visitor receiving the decoded values
+    DecodeVisitor& visitor;
+
+    /// Index of the subset being decoded, for uncompressed messages
+    unsigned subset;
+
+    /// Number of subsets decoded at the same time
+    unsigned subset_count;
+
+    /// True if decoding a compressed data section
+    bool compressed;
+
+    /// Last value decoded with decode_and_add_to_all or decode_and_add_bitmap
+    std::optional<Var> last_added;
+
+    /**
+     * Create a target for a subset of an uncompressed message, or for all the
+     * subsets of a compressed message
+     */
+    VisitorDecoderTarget(Input& in, DecodeVisitor& visitor, unsigned subset,
+                         unsigned subset_count, bool compressed);
+
+    void define_bitmap(bulletin::Bitmaps& bitmaps,
+                       const Var& bitmap) const override;
     Varinfo lookup_info(unsigned pos) const override;
     Var decode_uniform_b_value(Varinfo info) override;
     const Var& decode_and_add_to_all(Varinfo info) override;
@@ -172,8 +441,12 @@ struct CompressedDecoderTarget : public DecoderTarget
                                     unsigned pos) override;
 
 protected:
-    void decode_b_value(Varinfo info,
-                        std::function<void(unsigned, Var&&)> dest);
+    /// Send the same value to all the subsets being decoded
+    void add_to_all(const Var& var);
+
+    /// Decode a compressed B value and send it to the visitor
+    void decode_compressed(Varinfo info, DispatchToVisitor& dest,
+                           const bulletin::AssociatedField* field = nullptr);
 };
 
 struct DataSectionDecoder : public bulletin::Interpreter
@@ -1,4 +1,6 @@
 #include "input.h"
+#include "wreport/buffers/bufr.h"
+#include "wreport/internals/varinfo.h"
 #include "wreport/tests.h"
 
 using namespace wreport;
@@ -14,6 +16,178 @@ class Tests : public TestCase
     void register_tests() override
     {
         add_method("empty", []() noexcept {});
+
+        add_method("get_bits", []() {
+            // 0xa5 = 10100101, 0x3c = 00111100
+            std::string buf("\xa5\x3c\xa5\x3c\xa5\x3c\xa5\x3c\xa5\x3c",
+                            10);
+            bufr::Input in(buf);
+            wassert(actual(in.get_bits(1)) == 1u);
+            wassert(actual(in.get_bits(3)) == 2u);
+            wassert(actual(in.get_bits(0)) == 0u);
+            wassert(actual(in.get_bits(4)) == 5u);
+            wassert(actual(in.offset()) == 1u);
+            wassert(actual(in.get_bits(12)) == 0x3cau);
+            wassert(actual(in.get_bits(32)) == 0x53ca53cau);
+            wassert(actual(in.bits_left()) == 28u);
+            in.skip_bits(9);
+            wassert(actual(in.get_bits(7)) == 0x4au);
+            wassert(actual(in.get_bits(12)) == 0x53cu);
+            wassert(actual(in.bits_left()) == 0u);
+        });
+
+        add_method("get_bits_end", []() {
+            std::string buf("\xff\x00\xff", 3);
+            bufr::Input in(buf);
+            wassert(actual(in.get_bits(12)) == 0xff0u);
+            auto e = wassert_throws(error_parse, in.get_bits(13));
+            wassert(actual(e.what()).contains("end of buffer"));
+            wassert(actual(in.get_bits(12)) == 0x0ffu);
+            e = wassert_throws(error_parse, in.get_bits(1));
+            wassert(actual(e.what()).contains("end of buffer"));
+
+            bufr::Input in1(buf);
+            in1.skip_bits(20);
+            wassert(actual(in1.get_bits(4)) == 0xfu);
+            bufr::Input in2(buf);
+            e = wassert_throws(error_parse, in2.skip_bits(25));
+            wassert(actual(e.what()).contains("end of buffer"));
+        });
+
+        add_method("get_bits_compare", []() {
+            // Compare with a bit by bit reference implementation
+            std::string buf;
+            for (unsigned i = 0; i < 256; ++i)
+                buf += (char)(i * 37 + 11);
+            bufr::Input in(buf);
+            unsigned bitpos = 0;
+            for (unsigned n = 0; in.bits_left() > 32; n = (n + 7) % 33)
+            {
+                uint32_t expected = 0;
+                for (unsigned i = 0; i < n; ++i, ++bitpos)
+                {
+                    uint8_t byte = buf[bitpos / 8];
+                    expected     = (expected << 1) |
+                               ((byte >> (7 - bitpos % 8)) & 1);
+                }
+                wassert(actual(in.get_bits(n)) == expected);
+            }
+        });
+
+        add_method("get_bits_array", []() {
+            std::string buf;
+            for (unsigned i = 0; i < 256; ++i)
+                buf += (char)(i * 37 + 11);
+            for (unsigned n = 0; n <= 32; ++n)
+            {
+                bufr::Input in1(buf);
+                bufr::Input in2(buf);
+                in1.skip_bits(3);
+                in2.skip_bits(3);
+                unsigned count = (buf.size() * 8 - 3) / (n ? n : 1);
+                std::vector<uint32_t> values(count);
+                in1.get_bits_array(n, count, values.data());
+                for (unsigned i = 0; i < count; ++i)
+                    wassert(actual(values[i]) == in2.get_bits(n));
+                wassert(actual(in1.bits_left()) == in2.bits_left());
+                wassert(actual(in1.offset()) == in2.offset());
+            }
+
+            bufr::Input in(buf);
+            std::vector<uint32_t> values(300);
+            auto e = wassert_throws(error_parse,
+                                    in.get_bits_array(7, 300, values.data()));
+            wassert(actual(e.what()).contains("end of buffer"));
+        });
+
+        add_method("decode_compressed_numbers", []() {
+            _Varinfo info;
+            varinfo::set_bufr(info, WR_VAR(0, 12, 101), "TEMPERATURE", "K", 16,
+                              0, 2);
+            // 13 6-bits differences, the last one set to all ones
+            std::string buf;
+            for (unsigned i = 0; i < 9; ++i)
+                buf += (char)(i * 29 + 3);
+            buf += "\xff\xff";
+
+            std::vector<double> values(13);
+            std::vector<uint8_t> missing(13);
+            bufr::Input in1(buf);
+            in1.decode_compressed_numbers(&info, 27315, 6, 13, values.data(),
+                                          missing.data());
+
+            bufr::Input in2(buf);
+            for (unsigned i = 0; i < 13; ++i)
+            {
+                Var var(&info);
+                in2.decode_compressed_number(var, 27315, 6);
+                wassert(actual((bool)missing[i]) == !var.isset());
+                if (var.isset())
+                    wassert(actual(values[i]) == var.enqd());
+            }
+            wassert(actual((bool)missing[12]) == true);
+            wassert(actual(in1.offset()) == in2.offset());
+        });
+
+        add_method("decode_compressed_number_sinks", []() {
+            _Varinfo info;
+            varinfo::set_bufr(info, WR_VAR(0, 12, 101), "TEMPERATURE", "K", 16,
+                              0, 2);
+            // Base value, 6 difference bits, 13 differences with the last one
+            // set to all ones
+            std::string buf;
+            buffers::BufrOutput out(buf);
+            out.add_bits(27315, 16);
+            out.add_bits(6, 6);
+            for (unsigned i = 0; i < 12; ++i)
+                out.add_bits(i * 5, 6);
+            out.add_bits(0x3f, 6);
+            out.flush();
+
+            // Callback interface
+            std::vector<unsigned> indices;
+            std::vector<Var> vars;
+            bufr::Input in1(buf);
+            in1.decode_compressed_number(&info, 13, [&](unsigned i, Var&& var) {
+                indices.push_back(i);
+                vars.emplace_back(std::move(var));
+            });
+            wassert(actual(vars.size()) == 13u);
+            wassert(actual(indices[12]) == 12u);
+            wassert(actual(vars[3].enqd()) == 273.30);
+            wassert_false(vars[12].isset());
+
+            // Sink storing variables in the subsets
+            auto bulletin                         = BufrBulletin::create();
+            bulletin->edition_number              = 4;
+            bulletin->originating_centre          = 98;
+            bulletin->master_table_version_number = 19;
+            bulletin->load_tables();
+            for (unsigned i = 0; i < 13; ++i)
+                bulletin->obtain_subset(i);
+            bufr::DispatchToSubsets dest(*bulletin, 13);
+            bufr::Input in2(buf);
+            in2.decode_compressed_number(&info, 13, dest);
+            wassert(actual(in2.offset()) == in1.offset());
+            for (unsigned i = 0; i < 13; ++i)
+            {
+                wassert(actual(bulletin->subsets[i].size()) == 1u);
+                wassert_true(bulletin->subsets[i][0] == vars[i]);
+            }
+
+            // Sink setting attributes, skipping missing values
+            _Varinfo ainfo;
+            varinfo::set_bufr(ainfo, WR_VAR(0, 33, 7), "CONFIDENCE", "%", 16,
+                              0, 2);
+            bufr::AttributeToSubsets adest(*bulletin, 13, 0);
+            bufr::Input in3(buf);
+            in3.decode_compressed_number(&ainfo, 13, adest);
+            wassert(actual(in3.offset()) == in1.offset());
+            const Var* attr = bulletin->subsets[3][0].enqa(WR_VAR(0, 33, 7));
+            wassert_true(attr);
+            wassert(actual(attr->enqd()) == 273.30);
+            wassert_false(bulletin->subsets[12][0].next_attr());
+        });
     }
 } test("bufr_input");
 
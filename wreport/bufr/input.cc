@@ -4,6 +4,8 @@
 #include "wreport/bulletin/associated_fields.h"
 #include <algorithm>
 #include <cstdarg>
+#include <cstring>
+#include <optional>
 #include <regex.h>
 
 namespace {
@@ -18,17 +20,76 @@ static inline uint32_t all_ones(int bitlen)
     return ((1 << (bitlen - 1)) - 1) | (1 << (bitlen - 1));
 }
 
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__) &&     \
+    defined(__ELF__)
+// Also build AVX2 and SSE4.2 versions of the function, and pick the best one
+// for the running CPU when the library is loaded
+#define WREPORT_SIMD_CLONES                                                    \
+    __attribute__((target_clones("avx2", "sse4.2", "default")))
+#else
+#define WREPORT_SIMD_CLONES
+#endif
+
+/**
+ * Turn difference values of a compressed BUFR into decoded values and missing
+ * value flags, computing the same as _Varinfo::decode_binary.
+ */
+WREPORT_SIMD_CLONES void
+decode_compressed_batch(uint32_t base, uint32_t missing_diff,
+                        uint32_t missing_value, double bit_ref, double scale,
+                        bool divide, unsigned count, const uint32_t* diffs,
+                        double* values, uint8_t* missing)
+{
+    unsigned i = 0;
+#if defined(__GNUC__)
+    // Process 4 values at a time using vector extensions, which the compiler
+    // maps to the SIMD instructions available in each clone
+    typedef uint32_t v4u32 __attribute__((vector_size(16)));
+    typedef int32_t v4i32 __attribute__((vector_size(16)));
+    typedef double v4f64 __attribute__((vector_size(32)));
+    for (; i + 4 <= count; i += 4)
+    {
+        v4u32 diff;
+        memcpy(&diff, diffs + i, sizeof(diff));
+        v4u32 raw = diff + base;
+        v4i32 miss = (diff == missing_diff) | (raw == missing_value);
+        for (unsigned j = 0; j < 4; ++j)
+            missing[i + j] = miss[j] & 1;
+        // Convert from unsigned as a signed value plus an offset, since there
+        // is no unsigned conversion before AVX-512
+        v4f64 val = __builtin_convertvector((v4i32)(raw ^ 0x80000000u), v4f64) +
+                    2147483648.0;
+        if (divide)
+            val = (val + bit_ref) / scale;
+        else
+            val = (val + bit_ref) * scale;
+        memcpy(values + i, &val, sizeof(val));
+    }
+#endif
+    for (; i < count; ++i)
+    {
+        uint32_t raw = base + diffs[i];
+        missing[i]   = (diffs[i] == missing_diff) || (raw == missing_value);
+        if (divide)
+            values[i] = ((double)raw + bit_ref) / scale;
+        else
+            values[i] = ((double)raw + bit_ref) * scale;
+    }
+}
+
 } // namespace
 
 namespace wreport {
 namespace bufr {
 
-Input::Input(const std::string& in) : sec()
+Input::Input(const std::string& in)
+    : Input((const uint8_t*)in.data(), in.size())
+{
+}
+
+Input::Input(const uint8_t* data, size_t size)
+    : data(data), data_len(size), sec()
 {
-    data     = (const unsigned char*)in.data();
-    data_len = in.size();
-    for (auto& s : sec)
-        s = 0;
 }
 
 void Input::scan_section_length(unsigned sec_no)
@@ -69,6 +130,47 @@ void Input::scan_other_sections(bool has_optional)
     s4_cursor = sec[4] + 4;
 }
 
+void Input::get_bits_array(unsigned n, unsigned count, uint32_t* out)
+{
+    if (n > 32)
+        parse_error("cannot read values of %u bits: the maximum supported is "
+                    "32",
+                    n);
+
+    if (n == 0)
+    {
+        std::fill(out, out + count, 0);
+        return;
+    }
+
+    if ((size_t)n * count > bits_left())
+        parse_error("end of buffer while looking for %u values of %u bits of "
+                    "bit-packed data",
+                    count, n);
+
+    // Work on an absolute bit position kept in a local variable, which the
+    // compiler can keep in a register
+    size_t pos      = (size_t)s4_cursor * 8 - pbyte_len;
+    // Stop the fast path when a 64 bit load would go past the end of data
+    size_t fast_end = data_len >= 8 ? (data_len - 8) * 8 : 0;
+    unsigned i      = 0;
+    for (; i < count && pos < fast_end; ++i, pos += n)
+    {
+        // pos % 8 + n is at most 39, which fits in the loaded word
+        uint64_t word = read_word(pos / 8);
+        out[i]        = (uint32_t)((word << (pos % 8)) >> (64 - n));
+    }
+
+    // Resynchronise the byte cursor with the bit position
+    s4_cursor = (pos + 7) / 8;
+    pbyte_len = s4_cursor * 8 - pos;
+    pbyte     = pbyte_len ? data[s4_cursor - 1] << (8 - pbyte_len) : 0;
+
+    // Read the remaining values near the end of the buffer
+    for (; i < count; ++i)
+        out[i] = get_bits(n);
+}
+
 void Input::debug_dump_next_bits(const char* desc, unsigned count,
                                  const std::vector<unsigned>& groups) const
 {
@@ -295,7 +397,7 @@ void Input::decode_string(Var& dest)
 {
     Varinfo info = dest.info();
 
-    sys::TempBuffer str(info->bit_len / 8 + 2);
+    char* str = m_string.get(info->bit_len / 8 + 2);
     size_t len;
     bool missing = !decode_string(info->bit_len, str, len);
 
@@ -442,9 +544,143 @@ void Input::decode_compressed_number(Var& dest, uint32_t base,
     }
 }
 
+void Input::decode_compressed_numbers(Varinfo info, uint32_t base,
+                                      unsigned diffbits, unsigned count,
+                                      double* values, uint8_t* missing)
+{
+    if (info->bit_len == 0)
+        // Let decode_binary throw the appropriate exception
+        info->decode_binary(base);
+
+    uint32_t* diffs = m_diffs.get(count);
+    get_bits_array(diffbits, count, diffs);
+
+    bool divide  = info->scale >= 0;
+    double scale = 1.0;
+    for (int i = 0; i < abs(info->scale); ++i)
+        scale *= 10.0;
+    decode_compressed_batch(base, all_ones(diffbits), all_ones(info->bit_len),
+                            info->bit_ref, scale, divide, count, diffs, values,
+                            missing);
+}
+
+template <typename Sink>
+void Input::decode_compressed_number(Varinfo info, unsigned subsets,
+                                     Sink& dest)
+{
+    // Data field base value
+    uint32_t base;
+
+    // Number of bits used for each difference value
+    uint32_t diffbits;
+
+    bool missing = decode_compressed_base(info, base, diffbits);
+    if (missing)
+        dest.add_missing(info);
+    else if (!diffbits)
+        dest.add_same(Var(info, info->decode_binary(base)));
+    else
+    {
+        double* values   = m_values.get(subsets);
+        uint8_t* missing = m_missing.get(subsets);
+        decode_compressed_numbers(info, base, diffbits, subsets, values,
+                                  missing);
+        for (unsigned i = 0; i < subsets; ++i)
+        {
+            if (missing[i])
+                dest.add_var(i, Var(info));
+            else
+                dest.add_var(i, Var(info, values[i]));
+        }
+    }
+}
+
+template <typename Sink>
+void Input::decode_string(Varinfo info, unsigned subsets, Sink& dest)
+{
+    // Decode the base value
+    char* str = m_string.get(info->bit_len / 8 + 2);
+    size_t len;
+    bool missing = !decode_string(info->bit_len, str, len);
+
+    // Decode the number of bits (encoded in 6 bits) for each difference
+    // value
+    uint32_t diffbits = get_bits(6);
+
+    if (missing && diffbits == 0)
+        dest.add_missing(info);
+    else if (diffbits == 0)
+    {
+        // Add the same string to all the subsets
+        dest.add_same(Var(info, str));
+    }
+    else
+    {
+        /* Let's also check that the number of
+         * difference characters is the same length as
+         * the reference string */
+        if (diffbits * 8 > info->bit_len)
+            error_unimplemented::throwf(
+                "compressed strings with %u bits have %u bit deltas (deltas "
+                "should not be longer than field)",
+                info->bit_len, diffbits * 8);
+
+        for (unsigned i = 0; i < subsets; ++i)
+        {
+            // Set the variable value
+            if (decode_string(diffbits * 8, str, len))
+            {
+                // Compute the value for this subset
+                dest.add_var(i, Var(info, str));
+            }
+            else
+            {
+                // Missing value
+                dest.add_var(i, Var(info));
+            }
+        }
+    }
+}
+
+namespace {
+
+/**
+ * Sink wrapper that sets the decoded associated field values as attributes of
+ * the variables before forwarding them
+ */
+template <typename Sink> struct WithAssociatedFields
+{
+    Sink& dest;
+    std::vector<std::optional<Var>>& associated_fields;
+
+    void attach(unsigned subset, Var& var)
+    {
+        if (associated_fields[subset])
+            var.seta(std::move(*associated_fields[subset]));
+    }
+    void add_missing(Varinfo info)
+    {
+        for (unsigned i = 0; i < associated_fields.size(); ++i)
+            add_var(i, Var(info));
+    }
+    void add_same(const Var& var)
+    {
+        for (unsigned i = 0; i < associated_fields.size(); ++i)
+            add_var(i, Var(var));
+    }
+    void add_var(unsigned subset, Var&& var)
+    {
+        attach(subset, var);
+        dest.add_var(subset, std::move(var));
+    }
+};
+
+} // namespace
+
+template <typename Sink>
 void Input::decode_compressed_number_af(
     Varinfo info, const bulletin::AssociatedField& associated_field,
-    unsigned subsets, std::function<void(unsigned, Var&&)> dest)
+    unsigned subsets, Sink& dest)
 {
     // debug_dump_next_bits("Input:decode_compressed_base:", 500,
     // {associated_field.bit_count, 6, info->bit_len, 6});
@@ -477,27 +713,47 @@ void Input::decode_compressed_number_af(
     }
     else
     {
-        Var var(info);
-
-        std::vector<std::unique_ptr<Var>> associated_fields(subsets);
+        std::vector<std::optional<Var>> associated_fields(subsets);
         for (unsigned i = 0; i < subsets; ++i)
         {
             uint32_t diff  = get_bits(af_diffbits);
             uint32_t value = af_base + diff;
             TRACE("Input:decode_compressed_base:decoded af %ubits %u+%u=%u\n",
                   af_diffbits, af_base, diff, value);
-            associated_fields[i] = associated_field.make_attribute(value);
+            associated_fields[i] = associated_field.attribute(value);
         }
 
-        decode_compressed_number(
-            info, subsets, [&](unsigned subset, Var&& var) {
-                if (associated_fields[subset].get())
-                    var.seta(std::move(associated_fields[subset]));
-                dest(subset, std::move(var));
-            });
+        WithAssociatedFields<Sink> af_dest{dest, associated_fields};
+        decode_compressed_number(info, subsets, af_dest);
     }
 }
 
+void Input::skip_compressed_number(Varinfo info, unsigned subsets)
+{
+    skip_bits(info->bit_len);
+    uint32_t diffbits = get_bits(6);
+    skip_bits(diffbits * subsets);
+}
+
+void Input::skip_compressed_number_af(
+    Varinfo info, const bulletin::AssociatedField& associated_field,
+    unsigned subsets)
+{
+    // See decode_compressed_number_af for the layout of the data
+    uint32_t af_base     = get_bits(associated_field.bit_count);
+    uint32_t af_diffbits = get_bits(6);
+    if (af_base != all_ones(associated_field.bit_count))
+        skip_bits(af_diffbits * subsets);
+    skip_compressed_number(info, subsets);
+}
+
+void Input::skip_compressed_string(Varinfo info, unsigned subsets)
+{
+    skip_bits(info->bit_len);
+    uint32_t diffbits = get_bits(6);
+    skip_bits(diffbits * 8 * subsets);
+}
+
 void Input::decode_compressed_semantic_number(Var& dest, unsigned)
 {
     Varinfo info = dest.info();
@@ -543,77 +799,11 @@ void Input::decode_compressed_semantic_number(Var& dest, unsigned)
     }
 }
 
-void Input::decode_string(Varinfo info, unsigned subsets,
-                          std::function<void(unsigned, Var&&)> dest)
-{
-    sys::TempBuffer str(info->bit_len / 8 + 2);
-    size_t len;
-    bool missing = !decode_string(info->bit_len, str, len);
-
-    /* Store the variable that we found */
-
-    /* If compression is in use, then we just decoded the base value.  Now
-     * we need to decode all the offsets */
-
-    /* Decode the number of bits (encoded in 6 bits) that these difference
-     * values occupy */
-    uint32_t diffbits = get_bits(6);
-
-    // TRACE("datadesc:decode_b_string:compressed string, base:%.*s, diff bits
-    // %d\n", (int)len, str, diffbits);
-
-    if (diffbits != 0)
-    {
-        Var var(info);
-
-        /* Let's also check that the number of
-         * difference characters is the same length as
-         * the reference string */
-        if (diffbits * 8 > info->bit_len)
-            error_unimplemented::throwf(
-                "compressed strings with %u bits have %u bit deltas (deltas "
-                "should not be longer than field)",
-                info->bit_len, diffbits);
-
-        for (unsigned i = 0; i < subsets; ++i)
-        {
-            // Set the variable value
-            if (decode_string(diffbits * 8, str, len))
-            {
-                /* Compute the value for this subset */
-                // TRACE("datadesc:decode_b_string:decoded[%d] as \"%s\"\n", i,
-                // str);
-                var.setc(str);
-            }
-            else
-            {
-                /* Missing value */
-                // TRACE("datadesc:decode_b_string:decoded[%d] as missing\n",
-                // i);
-                var.unset();
-            }
-
-            // Add it to this subset
-            dest(i, std::move(var));
-        }
-    }
-    else
-    {
-        Var var(info);
-        if (!missing)
-            var.setc(str);
-
-        // Add the string to all the subsets
-        for (unsigned i = 0; i < subsets; ++i)
-            dest(i, Var(var));
-    }
-}
-
 void Input::decode_string(Var& dest, unsigned subsets)
 {
     Varinfo info = dest.info();
 
-    sys::TempBuffer str(info->bit_len / 8 + 2);
+    char* str = m_string.get(info->bit_len / 8 + 2);
     size_t len;
     bool missing = !decode_string(info->bit_len, str, len);
 
@@ -700,107 +890,57 @@ void Input::decode_string(Var& dest, unsigned subsets)
 void Input::decode_compressed_number(Varinfo info, unsigned subsets,
                                      std::function<void(unsigned, Var&&)> dest)
 {
-    // Data field base value
-    uint32_t base;
-
-    // Number of bits used for each difference value
-    uint32_t diffbits;
-
-    bool missing = decode_compressed_base(info, base, diffbits);
-    if (missing)
-    {
-        for (unsigned i = 0; i < subsets; ++i)
-            dest(i, Var(info));
-    }
-    else if (!diffbits)
-    {
-        Var var(info, info->decode_binary(base));
-        for (unsigned i = 0; i < subsets; ++i)
-            dest(i, Var(var));
-    }
-    else
-    {
-        Var var(info);
-        for (unsigned i = 0; i < subsets; ++i)
-        {
-            decode_compressed_number(var, base, diffbits);
-            dest(i, std::move(var));
-        }
-    }
+    DispatchToFunction sink(dest, subsets);
+    decode_compressed_number(info, subsets, sink);
 }
 
 void Input::decode_string(Varinfo info, unsigned subsets,
-                          DispatchToSubsets& dest)
+                          std::function<void(unsigned, Var&&)> dest)
 {
-    // Decode the base value
-    sys::TempBuffer str(info->bit_len / 8 + 2);
-    size_t len;
-    bool missing = !decode_string(info->bit_len, str, len);
-
-    // Decode the number of bits (encoded in 6 bits) for each difference
-    // value
-    uint32_t diffbits = get_bits(6);
-
-    if (missing && diffbits == 0)
-        dest.add_missing(info);
-    else if (diffbits == 0)
-    {
-        // Add the same string to all the subsets
-        dest.add_same(Var(info, str));
-    }
-    else
-    {
-        /* Let's also check that the number of
-         * difference characters is the same length as
-         * the reference string */
-        if (diffbits * 8 > info->bit_len)
-            error_unimplemented::throwf(
-                "compressed strings with %u bits have %u bit deltas (deltas "
-                "should not be longer than field)",
-                info->bit_len, diffbits * 8);
-
-        for (unsigned i = 0; i < subsets; ++i)
-        {
-            // Set the variable value
-            if (decode_string(diffbits * 8, str, len))
-            {
-                // Compute the value for this subset
-                dest.add_var(i, Var(info, str));
-            }
-            else
-            {
-                // Missing value
-                dest.add_var(i, Var(info));
-            }
-        }
-    }
+    DispatchToFunction sink(dest, subsets);
+    decode_string(info, subsets, sink);
 }
 
-void Input::decode_compressed_number(Varinfo info, unsigned subsets,
-                                     DispatchToSubsets& dest)
+void Input::decode_compressed_number_af(
+    Varinfo info, const bulletin::AssociatedField& associated_field,
+    unsigned subsets, std::function<void(unsigned, Var&&)> dest)
 {
-    // Data field base value
-    uint32_t base;
-
-    // Number of bits used for each difference value
-    uint32_t diffbits;
-
-    bool missing = decode_compressed_base(info, base, diffbits);
-    if (missing)
-        dest.add_missing(info);
-    else if (!diffbits)
-        dest.add_same(Var(info, info->decode_binary(base)));
-    else
-    {
-        Var var(info);
-        for (unsigned i = 0; i < subsets; ++i)
-        {
-            decode_compressed_number(var, base, diffbits);
-            dest.add_var(i, std::move(var));
-        }
-    }
+    DispatchToFunction sink(dest, subsets);
+    decode_compressed_number_af(info, associated_field, subsets, sink);
 }
 
+// Instantiate the compressed decoding functions for the known sinks
+template void Input::decode_compressed_number(Varinfo, unsigned,
+                                              DispatchToSubsets&);
+template void Input::decode_string(Varinfo, unsigned, DispatchToSubsets&);
+template void
+Input::decode_compressed_number_af(Varinfo, const bulletin::AssociatedField&,
+                                   unsigned, DispatchToSubsets&);
+template void Input::decode_compressed_number(Varinfo, unsigned,
+                                              AttributeToSubsets&);
+template void Input::decode_string(Varinfo, unsigned, AttributeToSubsets&);
+template void
+Input::decode_compressed_number_af(Varinfo, const bulletin::AssociatedField&,
+                                   unsigned, AttributeToSubsets&);
+template void Input::decode_compressed_number(Varinfo, unsigned,
+                                              SetInSubsets&);
+template void Input::decode_string(Varinfo, unsigned, SetInSubsets&);
+template void
+Input::decode_compressed_number_af(Varinfo, const bulletin::AssociatedField&,
+                                   unsigned, SetInSubsets&);
+template void Input::decode_compressed_number(Varinfo, unsigned,
+                                              DispatchToFunction&);
+template void Input::decode_string(Varinfo, unsigned, DispatchToFunction&);
+template void
+Input::decode_compressed_number_af(Varinfo, const bulletin::AssociatedField&,
+                                   unsigned, DispatchToFunction&);
+template void Input::decode_compressed_number(Varinfo, unsigned,
+                                              DispatchToVisitor&);
+template void Input::decode_string(Varinfo, unsigned, DispatchToVisitor&);
+template void
+Input::decode_compressed_number_af(Varinfo, const bulletin::AssociatedField&,
+                                   unsigned, DispatchToVisitor&);
+
 std::string Input::decode_uncompressed_bitmap(unsigned size)
 {
     std::string buf;
@@ -1,11 +1,14 @@
 #ifndef WREPORT_BUFR_INPUT_H
 #define WREPORT_BUFR_INPUT_H
 
+#include <cstring>
 #include <functional>
 #include <string>
+#include <vector>
 #include <wreport/bulletin.h>
 #include <wreport/error.h>
 #include <wreport/var.h>
+#include <wreport/visitor.h>
 
 namespace wreport {
 struct Bulletin;
@@ -16,6 +19,20 @@ struct AssociatedField;
 
 namespace bufr {
 
+/**
+ * Sinks for compressed values.
+ *
+ * The functions that decode a compressed value for all the subsets of a
+ * message are templates over a sink type with three methods:
+ *
+ *  - add_missing(Varinfo): the value is missing in all subsets
+ *  - add_same(const Var&): the value is the same in all subsets
+ *  - add_var(unsigned subset, Var&&): the value for one subset
+ *
+ * They are instantiated for the sinks defined in this file.
+ */
+
+/// Sink that appends the decoded values to each subset
 struct DispatchToSubsets
 {
     Bulletin& out;
@@ -37,7 +54,133 @@ struct DispatchToSubsets
     }
     void add_var(unsigned subset, Var&& var)
     {
-        out.subsets[subset].store_variable(var);
+        out.subsets[subset].store_variable(std::move(var));
+    }
+};
+
+/**
+ * Sink that sets the decoded values as attributes of the variable at position
+ * \a pos in each subset, skipping missing values
+ */
+struct AttributeToSubsets
+{
+    Bulletin& out;
+    unsigned subset_count;
+    unsigned pos;
+    AttributeToSubsets(Bulletin& out, unsigned subset_count, unsigned pos)
+        : out(out), subset_count(subset_count), pos(pos)
+    {
+    }
+
+    void add_missing(Varinfo) {}
+    void add_same(const Var& var)
+    {
+        if (!var.isset())
+            return;
+        for (unsigned i = 0; i < subset_count; ++i)
+            out.subsets[i][pos].seta(var);
+    }
+    void add_var(unsigned subset, Var&& var)
+    {
+        if (!var.isset())
+            return;
+        out.subsets[subset][pos].seta(std::move(var));
+    }
+};
+
+/**
+ * Sink that replaces the variable at position \a pos in each subset, which
+ * already contains a missing value with the same Varinfo
+ */
+struct SetInSubsets
+{
+    Bulletin& out;
+    unsigned subset_count;
+    unsigned pos;
+    SetInSubsets(Bulletin& out, unsigned subset_count, unsigned pos)
+        : out(out), subset_count(subset_count), pos(pos)
+    {
+    }
+
+    void add_missing(Varinfo) {}
+    void add_same(const Var& var)
+    {
+        for (unsigned i = 0; i < subset_count; ++i)
+            out.subsets[i][pos] = var;
+    }
+    void add_var(unsigned subset, Var&& var)
+    {
+        out.subsets[subset][pos] = std::move(var);
+    }
+};
+
+/// Sink that forwards each decoded value to a callback
+struct DispatchToFunction
+{
+    const std::function<void(unsigned, Var&&)>& dest;
+    unsigned subset_count;
+    DispatchToFunction(const std::function<void(unsigned, Var&&)>& dest,
+                       unsigned subset_count)
+        : dest(dest), subset_count(subset_count)
+    {
+    }
+
+    void add_missing(Varinfo info)
+    {
+        for (unsigned i = 0; i < subset_count; ++i)
+            dest(i, Var(info));
+    }
+    void add_same(const Var& var)
+    {
+        for (unsigned i = 0; i < subset_count; ++i)
+            dest(i, Var(var));
+    }
+    void add_var(unsigned subset, Var&& var) { dest(subset, std::move(var)); }
+};
+
+/**
+ * Sink that sends the decoded values to a DecodeVisitor, as the variable at
+ * position \a pos, or as attributes of it
+ */
+struct DispatchToVisitor
+{
+    DecodeVisitor& visitor;
+    unsigned subset_count;
+    unsigned pos;
+    /// If true, values are attributes of the variable at \a pos
+    bool attributes;
+
+    DispatchToVisitor(DecodeVisitor& visitor, unsigned subset_count,
+                      unsigned pos, bool attributes)
+        : visitor(visitor), subset_count(subset_count), pos(pos),
+          attributes(attributes)
+    {
+    }
+
+    void add_missing(Varinfo info)
+    {
+        if (attributes)
+            return;
+        Var var(info);
+        for (unsigned i = 0; i < subset_count; ++i)
+            visitor.value(i, var);
+    }
+    void add_same(const Var& var)
+    {
+        for (unsigned i = 0; i < subset_count; ++i)
+            add_var(i, var);
+    }
+    void add_var(unsigned subset, const Var& var)
+    {
+        if (attributes)
+        {
+            if (var.isset())
+                visitor.attribute(subset, pos, var);
+            return;
+        }
+        visitor.value(subset, var);
+        for (const Var* a = var.next_attr(); a; a = a->next_attr())
+            visitor.attribute(subset, pos, *a);
     }
 };
 
@@ -47,6 +190,39 @@ struct DispatchToSubsets
 class Input
 {
 protected:
+    /**
+     * Memory reused by successive decoding calls, to avoid allocating it for
+     * each decoded value.
+     *
+     * Its contents are not copied when the Input is copied.
+     */
+    template <typename T> class Scratch
+    {
+        std::vector<T> m_buf;
+
+    public:
+        Scratch() = default;
+        Scratch(const Scratch&) {}
+        Scratch& operator=(const Scratch&) { return *this; }
+
+        /// Return a buffer of at least \a size elements, with any contents
+        T* get(size_t size)
+        {
+            if (m_buf.size() < size)
+                m_buf.resize(size);
+            return m_buf.data();
+        }
+    };
+
+    /// Difference values of compressed numbers
+    Scratch<uint32_t> m_diffs;
+    /// Decoded values of compressed numbers
+    Scratch<double> m_values;
+    /// Missing flags of compressed numbers
+    Scratch<uint8_t> m_missing;
+    /// Decoded strings
+    Scratch<char> m_string;
+
     /**
      * Scan length of section \a sec_no, filling in the start of the next
      * section in sec[sec_no + 1]
@@ -98,6 +274,16 @@ public:
      */
     explicit Input(const std::string& in);
 
+    /**
+     * Wrap a memory buffer into a Input
+     *
+     * @param data
+     *   Buffer with the data to read
+     * @param size
+     *   Size of the buffer
+     */
+    Input(const uint8_t* data, size_t size);
+
     /**
      * Scan the message filling in the sec[] array of start offsets of sections
      * 0 and 1.
@@ -163,62 +349,111 @@ public:
         return read_number(sec[section] + pos, byte_len);
     }
 
+    /**
+     * Read a big endian 64 bit word starting at byte offset \a pos.
+     *
+     * The caller must ensure that \a pos + 8 <= data_len.
+     */
+    uint64_t read_word(unsigned pos) const
+    {
+        uint64_t res;
+        memcpy(&res, data + pos, sizeof(res));
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        res = __builtin_bswap64(res);
+#endif
+        return res;
+    }
+
     /**
      * Get the integer value of the next 'n' bits from the decode input
      * n must be <= 32.
+     *
+     * Throws error_parse if there are less than n bits left in the buffer.
      */
     uint32_t get_bits(unsigned n)
     {
-        uint32_t result = 0;
-
-        if (s4_cursor == data_len)
-            parse_error(
-                "end of buffer while looking for %u bits of bit-packed data",
-                n);
+        // Fast path: the bits are all in the current partial byte
+        if (n <= (unsigned)pbyte_len)
+        {
+            if (n == 0)
+                return 0;
+            uint32_t result = pbyte >> (8 - n);
+            pbyte           = pbyte << n;
+            pbyte_len -= n;
+            return result;
+        }
 
-        // TODO: review and benchmark and possibly simplify
-        // (a possible alternative approach is to keep a current bitmask that
-        // starts at 0x80 and is shifted right by 1 at each read until it
-        // reaches 0, and get rid of pbyte_len)
-        for (unsigned i = 0; i < n; i++)
+        // Bits left in pbyte, right aligned
+        uint32_t head   = pbyte >> (8 - pbyte_len);
+        // Number of bits that we need to read from the following bytes
+        unsigned needed = n - pbyte_len;
+        // Number of whole bytes that we need to load
+        unsigned nbytes = (needed + 7) / 8;
+
+        uint64_t word;
+        if (s4_cursor + 8 <= data_len)
+            word = read_word(s4_cursor);
+        else
         {
-            if (pbyte_len == 0)
-            {
-                pbyte_len = 8;
-                pbyte     = data[s4_cursor++];
-            }
-            result <<= 1;
-            if (pbyte & 0x80)
-                result |= 1;
-            pbyte <<= 1;
-            pbyte_len--;
+            // Near the end of the buffer: load only what is needed
+            if (s4_cursor + nbytes > data_len)
+                parse_error(
+                    "end of buffer while looking for %u bits of bit-packed "
+                    "data",
+                    n);
+            word = 0;
+            for (unsigned i = 0; i < nbytes; ++i)
+                word |= (uint64_t)data[s4_cursor + i] << (56 - i * 8);
         }
 
+        // needed is at most 32, so head can be shifted without overflowing
+        uint32_t result = (uint32_t)(((uint64_t)head << needed) |
+                                     (word >> (64 - needed)));
+
+        s4_cursor += nbytes;
+        pbyte_len = nbytes * 8 - needed;
+        // Keep the unused bits of the last loaded byte, left aligned
+        pbyte     = (uint8_t)(word >> (64 - nbytes * 8)) << (8 - pbyte_len);
         return result;
     }
 
     /**
-     * Skip the next n bits
+     * Skip the next n bits.
+     *
+     * Throws error_parse if there are less than n bits left in the buffer.
      */
     void skip_bits(unsigned n)
     {
-        if (s4_cursor == data_len)
+        if (n <= (unsigned)pbyte_len)
+        {
+            pbyte = pbyte << n;
+            pbyte_len -= n;
+            return;
+        }
+
+        unsigned needed = n - pbyte_len;
+        unsigned nbytes = (needed + 7) / 8;
+        if (s4_cursor + nbytes > data_len)
             parse_error(
                 "end of buffer while looking for %u bits of bit-packed data",
                 n);
 
-        for (unsigned i = 0; i < n; i++)
-        {
-            if (pbyte_len == 0)
-            {
-                pbyte_len = 8;
-                pbyte     = data[s4_cursor++];
-            }
-            pbyte <<= 1;
-            pbyte_len--;
-        }
+        s4_cursor += nbytes;
+        pbyte_len = nbytes * 8 - needed;
+        pbyte     = data[s4_cursor - 1] << (8 - pbyte_len);
     }
 
+    /**
+     * Read \a count consecutive values, each \a n bits long, into \a out.
+     *
+     * It is the same as calling get_bits(n) \a count times, but it runs as a
+     * single pass over the input. n must be <= 32.
+     *
+     * Throws error_parse if there are less than n * count bits left in the
+     * buffer.
+     */
+    void get_bits_array(unsigned n, unsigned count, uint32_t* out);
+
     /// Dump to stderr 'count' bits of 'buf', starting at the 'ofs-th' bit
     void debug_dump_next_bits(const char* desc, unsigned count,
                               const std::vector<unsigned>& groups = {}) const;
@@ -314,12 +549,43 @@ public:
      */
     void decode_number(Var& dest);
 
+    /**
+     * Decode \a count difference values of a number described by \a info,
+     * from a compressed BUFR.
+     *
+     * @param info
+     *   Description of the variable being decoded
+     * @param base
+     *   The base value for the compressed numbers
+     * @param diffbits
+     *   The number of bits used to encode each difference from \a base
+     * @param count
+     *   The number of difference values to decode
+     * @retval values
+     *   Array of \a count decoded values. Values corresponding to missing
+     *   data are undefined
+     * @retval missing
+     *   Array of \a count flags, set to 1 when the corresponding value is
+     *   missing, and 0 otherwise
+     */
+    void decode_compressed_numbers(Varinfo info, uint32_t base,
+                                   unsigned diffbits, unsigned count,
+                                   double* values, uint8_t* missing);
+
     /**
      * Decode the base value for a variable in a compressed BUFR
      */
     bool decode_compressed_base(Varinfo info, uint32_t& base,
                                 uint32_t& diffbits);
 
+    /**
+     * Decode a number as described by \a info from a compressed bufr with
+     * \a subsets subsets, and send the resulting variables to the sink \a
+     * dest
+     */
+    template <typename Sink>
+    void decode_compressed_number(Varinfo info, unsigned subsets, Sink& dest);
+
     /**
      * Decode a number as described by \a info from a compressed bufr with
      * \a subsets subsets, and send the resulting variables to \a dest
@@ -327,10 +593,22 @@ public:
     void decode_compressed_number(Varinfo info, unsigned subsets,
                                   std::function<void(unsigned, Var&&)> dest);
 
-    void decode_string(Varinfo info, unsigned subsets, DispatchToSubsets& dest);
+    /**
+     * Decode a string as described by \a info from a compressed bufr with \a
+     * subsets subsets, and send the resulting variables to the sink \a dest
+     */
+    template <typename Sink>
+    void decode_string(Varinfo info, unsigned subsets, Sink& dest);
 
-    void decode_compressed_number(Varinfo info, unsigned subsets,
-                                  DispatchToSubsets& dest);
+    /**
+     * Decode a number as described by \a info from a compressed bufr with
+     * \a subsets subsets, with its associated field, and send the resulting
+     * variables to the sink \a dest
+     */
+    template <typename Sink>
+    void decode_compressed_number_af(Varinfo info,
+                                     const bulletin::AssociatedField& afield,
+                                     unsigned subsets, Sink& dest);
 
     /**
      * Decode a number as described by \a info from a compressed bufr with
@@ -341,6 +619,27 @@ public:
                                      unsigned subsets,
                                      std::function<void(unsigned, Var&&)> dest);
 
+    /**
+     * Skip a number as described by \a info from a compressed bufr with \a
+     * subsets subsets, without decoding it
+     */
+    void skip_compressed_number(Varinfo info, unsigned subsets);
+
+    /**
+     * Skip a number with its associated field, as described by \a info and
+     * \a afield, from a compressed bufr with \a subsets subsets, without
+     * decoding it
+     */
+    void skip_compressed_number_af(Varinfo info,
+                                   const bulletin::AssociatedField& afield,
+                                   unsigned subsets);
+
+    /**
+     * Skip a string as described by \a info from a compressed bufr with \a
+     * subsets subsets, without decoding it
+     */
+    void skip_compressed_string(Varinfo info, unsigned subsets);
+
     /**
      * Decode a number as described by dest.info(), and set it as value for \a
      * dest. The number is decoded for \a subsets compressed datasets, and an
@@ -179,6 +179,106 @@ class Tests : public TestCase
             test_info() << "reencoded";
             wassert(test(msg1));
         });
+        add_method("encode_compressed", []() {
+            // Encode a BUFR with compression and different values in each
+            // subset
+            unique_ptr<BufrBulletin> pmsg(BufrBulletin::create());
+            BufrBulletin& msg = *pmsg;
+            msg.clear();
+
+            // Initialise common message bits
+            msg.edition_number                    = 4;
+            msg.data_category                     = 0;
+            msg.data_subcategory                  = 255;
+            msg.data_subcategory_local            = 0;
+            msg.originating_centre                = 98;
+            msg.originating_subcentre             = 0;
+            msg.master_table_version_number       = 12;
+            msg.master_table_version_number_local = 1;
+            msg.compression                       = true;
+            msg.rep_year                          = 2008;
+            msg.rep_month                         = 5;
+            msg.rep_day                           = 3;
+            msg.rep_hour                          = 12;
+            msg.rep_minute                        = 30;
+            msg.rep_second                        = 0;
+            msg.load_tables();
+
+            msg.datadesc.push_back(WR_VAR(0, 1, 19));
+            msg.datadesc.push_back(WR_VAR(0, 1, 15));
+            msg.datadesc.push_back(WR_VAR(0, 4, 1));
+            msg.datadesc.push_back(WR_VAR(0, 12, 101));
+            msg.datadesc.push_back(WR_VAR(0, 1, 1));
+
+            for (unsigned i = 0; i < 4; ++i)
+            {
+                Subset& s = msg.obtain_subset(i);
+                // Different strings
+                s.store_variable_c(WR_VAR(0, 1, 19),
+                                   ("Station " + std::to_string(i)).c_str());
+                // Same strings
+                s.store_variable_c(WR_VAR(0, 1, 15), "Somewhere");
+                // Same numbers
+                s.store_variable_i(WR_VAR(0, 4, 1), 2008);
+                // Different numbers, with a missing value
+                if (i == 2)
+                    s.store_variable_undef(WR_VAR(0, 12, 101));
+                else
+                    s.store_variable_d(WR_VAR(0, 12, 101), 273.15 + i);
+                // All missing
+                s.store_variable_undef(WR_VAR(0, 1, 1));
+            }
+
+            string rmsg = wcallchecked(msg.encode());
+
+            auto msg1 = BufrBulletin::decode(rmsg);
+            wassert_true(msg1->compression);
+            wassert(actual(msg1->subsets.size()) == 4u);
+            wassert(actual(msg.diff(*msg1)) == 0u);
+            wassert(actual(msg1->subset(1)[0].enqc()) == "Station 1");
+            wassert(actual(msg1->subset(3)[1].enqc()) == "Somewhere");
+            wassert(actual(msg1->subset(3)[3].enqd()) == 276.15);
+            wassert_false(msg1->subset(2)[3].isset());
+            wassert_false(msg1->subset(0)[4].isset());
+
+            // Compression makes the message smaller
+            msg.compression          = false;
+            string uncompressed_rmsg = wcallchecked(msg.encode());
+            wassert(actual(rmsg.size()) < uncompressed_rmsg.size());
+
+            // Subsets with different layouts cannot be compressed
+            msg.compression = true;
+            msg.obtain_subset(3).store_variable_i(WR_VAR(0, 4, 1), 2009);
+            wassert_throws(error_consistency, msg.encode());
+        });
+        add_method("reencode_compressed", []() {
+            // Compressed test messages are smaller than their uncompressed
+            // version when reencoded
+            size_t compressed_size   = 0;
+            size_t uncompressed_size = 0;
+            for (const auto& fname : all_test_files("bufr"))
+            {
+                std::unique_ptr<BufrBulletin> msg;
+                try
+                {
+                    msg = BufrBulletin::decode(slurpfile(fname));
+                }
+                catch (std::exception&)
+                {
+                    continue;
+                }
+                if (!msg->compression || msg->subsets.size() < 2)
+                    continue;
+
+                WREPORT_TEST_INFO(info);
+                info() << fname;
+                compressed_size += wcallchecked(msg->encode()).size();
+                msg->compression = false;
+                uncompressed_size += wcallchecked(msg->encode()).size();
+            }
+            wassert(actual(compressed_size) > 0u);
+            wassert(actual(compressed_size) < uncompressed_size);
+        });
         add_method("var_ranges", []() {
             // Test variable ranges during encoding
             unique_ptr<BufrBulletin> pmsg(BufrBulletin::create());
@@ -3,6 +3,7 @@
 #include "bulletin/internals.h"
 #include "config.h"
 #include "vartable.h"
+#include <algorithm>
 #include <cstring>
 #include <netinet/in.h>
 
@@ -156,6 +157,330 @@ struct DDSEncoder : public bulletin::UncompressedEncoder
     }
 };
 
+static inline uint32_t all_ones(int bitlen)
+{
+    return ((1 << (bitlen - 1)) - 1) | (1 << (bitlen - 1));
+}
+
+/// Number of bits needed to encode \a val
+static inline unsigned bits_needed(uint64_t val)
+{
+    unsigned res = 0;
+    for (; val; val >>= 1)
+        ++res;
+    return res;
+}
+
+/**
+ * Encode the data section of all subsets at once, using BUFR compression.
+ *
+ * All subsets must contain the same sequence of variables: the first subset is
+ * used to drive the interpretation of the data descriptors, and each value is
+ * encoded as a base value, the number of bits of the differences, and the
+ * difference from the base value for each subset.
+ */
+struct CompressedDDSEncoder : public bulletin::Interpreter
+{
+    const Bulletin& bulletin;
+    buffers::BufrOutput& ob;
+    /// Index of the next variable to be visited
+    unsigned current_var = 0;
+    /// Variables at the current position, one per subset
+    std::vector<const Var*> vars;
+
+    CompressedDDSEncoder(const Bulletin& b, buffers::BufrOutput& ob)
+        : Interpreter(b.tables, b.datadesc), bulletin(b), ob(ob),
+          vars(b.subsets.size())
+    {
+        for (unsigned i = 1; i < b.subsets.size(); ++i)
+            if (b.subsets[i].size() != b.subsets[0].size())
+                error_consistency::throwf(
+                    "cannot compress subsets with a different number of "
+                    "variables (subset 0 has %zu, subset %u has %zu)",
+                    b.subsets[0].size(), i, b.subsets[i].size());
+    }
+
+    /// Fill vars with the variables at position \a pos in all subsets
+    void get_vars(unsigned pos)
+    {
+        const Subset& first = bulletin.subsets[0];
+        if (pos >= first.size())
+            error_consistency::throwf(
+                "cannot return variable #%u out of a maximum of %zu", pos,
+                first.size());
+        Varcode code = first[pos].code();
+        for (unsigned i = 0; i < vars.size(); ++i)
+        {
+            vars[i] = &bulletin.subsets[i][pos];
+            if (vars[i]->code() != code)
+                error_consistency::throwf(
+                    "cannot compress subsets with different variables: "
+                    "variable #%u is %01d%02d%03d in subset 0 and %01d%02d%03d "
+                    "in subset %u",
+                    pos, WR_VAR_FXY(code), WR_VAR_FXY(vars[i]->code()), i);
+        }
+    }
+
+    /// Get the next variable, which needs to be the same in all subsets
+    const Var& get_uniform_var()
+    {
+        get_vars(current_var++);
+        for (unsigned i = 1; i < vars.size(); ++i)
+            if (!vars[i]->value_equals(*vars[0]))
+                error_consistency::throwf(
+                    "cannot compress a %01d%02d%03d variable (like a "
+                    "repetition count or a bitmap) that differs across "
+                    "subsets",
+                    WR_VAR_FXY(vars[0]->code()));
+        return *vars[0];
+    }
+
+    /// Encode a value that is the same in all subsets
+    void encode_uniform(Varinfo info, const Var& var)
+    {
+        if (info->type == Vartype::Binary)
+            throw error_unimplemented(
+                "encoding compressed binary values is not implemented");
+        ob.append_var(info, var);
+        ob.add_bits(0, 6);
+    }
+
+    /**
+     * Encode \a values (one per subset, with all ones meaning missing) as a
+     * compressed number \a bit_len bits long
+     */
+    void encode_numbers(const std::vector<uint32_t>& values, unsigned bit_len)
+    {
+        const uint32_t missing = all_ones(bit_len);
+        uint32_t min           = missing;
+        uint32_t max           = 0;
+        bool has_missing       = false;
+        for (auto val : values)
+        {
+            if (val == missing)
+            {
+                has_missing = true;
+                continue;
+            }
+            if (val < min)
+                min = val;
+            if (val > max)
+                max = val;
+        }
+
+        if (min == missing || (!has_missing && min == max))
+        {
+            // All missing or all the same
+            ob.add_bits(min, bit_len);
+            ob.add_bits(0, 6);
+            return;
+        }
+
+        // Differences cannot be all ones, as that means missing
+        unsigned diffbits = bits_needed((uint64_t)max - min + 1);
+        ob.add_bits(min, bit_len);
+        ob.add_bits(diffbits, 6);
+        for (auto val : values)
+        {
+            if (val == missing)
+                ob.append_missing(diffbits);
+            else
+                ob.add_bits(val - min, diffbits);
+        }
+    }
+
+    /// Encode the values in vars, according to \a info
+    void encode_vars(Varinfo info)
+    {
+        switch (info->type)
+        {
+            case Vartype::String: encode_strings(info); break;
+            case Vartype::Binary:
+                throw error_unimplemented(
+                    "encoding compressed binary values is not implemented");
+            case Vartype::Integer:
+            case Vartype::Decimal:
+            {
+                std::vector<uint32_t> values(vars.size());
+                for (unsigned i = 0; i < vars.size(); ++i)
+                    values[i] = vars[i] && vars[i]->isset()
+                                  ? info->encode_binary(vars[i]->enqd())
+                                  : all_ones(info->bit_len);
+                encode_numbers(values, info->bit_len);
+                break;
+            }
+        }
+    }
+
+    void encode_strings(Varinfo info)
+    {
+        bool same = true;
+        for (unsigned i = 1; same && i < vars.size(); ++i)
+        {
+            if (!vars[i] || !vars[0])
+                same = vars[i] == vars[0];
+            else if (vars[i]->isset() != vars[0]->isset())
+                same = false;
+            else if (vars[i]->isset())
+                same = strcmp(vars[i]->enqc(), vars[0]->enqc()) == 0;
+        }
+
+        if (same)
+        {
+            if (vars[0])
+                ob.append_var(info, *vars[0]);
+            else
+                ob.append_missing(info);
+            ob.add_bits(0, 6);
+            return;
+        }
+
+        // Zero base value, then the difference length in bytes, then the full
+        // string for each subset
+        unsigned len = info->bit_len / 8;
+        if (len > 63)
+            error_unimplemented::throwf(
+                "cannot compress %01d%02d%03d strings %u bytes long, that "
+                "differ across subsets (the maximum is 63)",
+                WR_VAR_FXY(info->code), len);
+        for (unsigned bits = info->bit_len; bits > 0;)
+        {
+            unsigned count = bits > 32 ? 32 : bits;
+            ob.add_bits(0, count);
+            bits -= count;
+        }
+        ob.add_bits(len, 6);
+        for (auto var : vars)
+        {
+            if (var && var->isset())
+                ob.append_string(var->enqc(), len * 8);
+            else
+                ob.append_missing(len * 8);
+        }
+    }
+
+    /// Set vars to the attributes \a code of the variables at \a pos
+    void get_attrs(unsigned pos, Varcode code)
+    {
+        get_vars(pos);
+        for (auto& var : vars)
+        {
+            const Var* attr = var->enqa(code);
+            var             = attr && attr->isset() ? attr : nullptr;
+        }
+    }
+
+    void define_substituted_value(unsigned pos) override
+    {
+        // Use the details of the corrisponding variable for encoding
+        Varinfo info = bulletin.subsets[0][pos].info();
+        get_attrs(pos, info->code);
+        encode_vars(info);
+    }
+
+    void define_attribute(Varinfo info, unsigned pos) override
+    {
+        get_attrs(pos, info->code);
+        encode_vars(info);
+    }
+
+    void define_variable(Varinfo info) override
+    {
+        get_vars(current_var++);
+        encode_vars(info);
+    }
+
+    void define_variable_with_associated_field(Varinfo info) override
+    {
+        get_vars(current_var++);
+
+        // The associated field is encoded first, as a compressed number, with
+        // no deltas if it is missing in all subsets
+        std::vector<uint32_t> values(vars.size());
+        for (unsigned i = 0; i < vars.size(); ++i)
+        {
+            const Var* att = associated_field.get_attribute(*vars[i]);
+            values[i]      = att && att->isset()
+                                   ? att->enqi()
+                                   : all_ones(associated_field.bit_count);
+        }
+        uint32_t min = *std::min_element(values.begin(), values.end());
+        uint32_t max = *std::max_element(values.begin(), values.end());
+        // Unlike with variables, the decoder does not treat differences made
+        // of all ones as missing values
+        unsigned diffbits = bits_needed(max - min);
+        ob.add_bits(min, associated_field.bit_count);
+        ob.add_bits(diffbits, 6);
+        if (min != all_ones(associated_field.bit_count))
+            for (auto val : values)
+                ob.add_bits(val - min, diffbits);
+
+        encode_vars(info);
+    }
+
+    unsigned define_delayed_replication_factor(Varinfo info) override
+    {
+        const Var& var = get_uniform_var();
+        encode_uniform(info, var);
+        return var.enqi();
+    }
+
+    unsigned define_associated_field_significance(Varinfo info) override
+    {
+        const Var& var = get_uniform_var();
+        encode_uniform(info, var);
+        return var.enq(63);
+    }
+
+    unsigned define_bitmap_delayed_replication_factor(Varinfo info) override
+    {
+        get_vars(current_var);
+        unsigned len = vars[0]->info()->len;
+        encode_uniform(info, Var(info, (int)len));
+        return len;
+    }
+
+    void define_bitmap(unsigned bitmap_size) override
+    {
+        const Var& var = get_uniform_var();
+        if (WR_VAR_F(var.code()) != 2)
+            error_consistency::throwf(
+                "variable at %u is %01d%02d%03d and not a data present bitmap",
+                current_var - 1, WR_VAR_FXY(var.code()));
+
+        if (var.info()->len != bitmap_size)
+            error_consistency::throwf(
+                "bitmap given is %u bits long, but we need to encode %u bits",
+                var.info()->len, bitmap_size);
+
+        // Each bit is encoded as a compressed value with no differences
+        for (unsigned i = 0; i < bitmap_size; ++i)
+        {
+            ob.add_bits(var.enqc()[i] == '+' ? 0 : 1, 1);
+            ob.add_bits(0, 6);
+        }
+
+        bitmaps.define(var, bulletin.subsets[0], current_var);
+    }
+
+    void define_raw_character_data(Varcode code) override
+    {
+        // Mirror the decoder, which does not support this
+        error_unimplemented::throwf(
+            "C05%03d character data cannot be encoded in a compressed message",
+            WR_VAR_Y(code));
+    }
+
+    void define_c03_refval_override(Varcode code) override
+    {
+        // Mirror the decoder, which does not support this
+        error_unimplemented::throwf(
+            "C03%03u reference value override cannot be encoded in a "
+            "compressed message",
+            c03_refval_override_bits);
+    }
+};
+
 struct Encoder
 {
     /* Input message data */
@@ -345,7 +670,7 @@ void Encoder::encode_sec3()
     // Number of data subsets
     out.append_short(static_cast<unsigned short>(in.subsets.size()));
     // Bit 0 = observed data; bit 1 = use compression
-    out.append_byte(128);
+    out.append_byte(in.compression ? 128 | 64 : 128);
 
     // Data descriptors
     for (unsigned i = 0; i < in.datadesc.size(); ++i)
@@ -366,13 +691,22 @@ void Encoder::encode_sec4()
     out.add_bits(0, 24);
     out.append_byte(0);
 
-    // Encode all the subsets
-    for (unsigned i = 0; i < in.subsets.size(); ++i)
+    if (in.compression)
     {
-        // Encode the data of this subset
-        DDSEncoder e(in, i, out);
+        // Encode all the subsets at once
+        CompressedDDSEncoder e(in, out);
         e.run();
     }
+    else
+    {
+        // Encode all the subsets
+        for (unsigned i = 0; i < in.subsets.size(); ++i)
+        {
+            // Encode the data of this subset
+            DDSEncoder e(in, i, out);
+            e.run();
+        }
+    }
 
     // Write all the bits and pad the data section to reach an even length
     out.flush();
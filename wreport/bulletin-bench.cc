@@ -1,5 +1,16 @@
 #include "benchmark.h"
+#include "buffers/bufr.h"
+#include "bufr/input.h"
 #include "bulletin.h"
+#include "columns.h"
+#include "dtable.h"
+#include "index.h"
+#include "internals/varinfo.h"
+#include "internals/vartable.h"
+#include "scanner.h"
+#include "utils/sys.h"
+#include "vartable.h"
+#include "visitor.h"
 #include <cassert>
 #include <cstdlib>
 #include <vector>
@@ -10,6 +21,18 @@ using namespace std;
 
 namespace {
 
+/// Visitor that only counts the values it receives
+struct CountValues : public DecodeVisitor
+{
+    unsigned count = 0;
+
+    void value(unsigned subset, const Var& var) override
+    {
+        if (var.isset())
+            ++count;
+    }
+};
+
 template <typename Bltn> struct TestData
 {
     string fname;
@@ -37,10 +60,12 @@ template <typename Bltn> struct TestData
 
     void decode_header(const std::string& buf)
     {
+        delete head_bulletin;
         head_bulletin = Bltn::decode_header(buf).release();
     }
     void decode(const std::string& buf)
     {
+        delete data_bulletin;
         data_bulletin = Bltn::decode(buf).release();
     }
 };
@@ -77,16 +102,77 @@ struct BulletinBenchmark : Benchmark
 {
     vector<TestData<BufrBulletin>> bufr_data;
     vector<TestData<CrexBulletin>> crex_data;
+    // Indices in bufr_data of messages using compression
+    vector<unsigned> bufr_compressed;
+    // Synthetic compressed data section with many subsets
+    _Varinfo compressed_info;
+    std::string compressed_data;
+    static const unsigned compressed_vars    = 100;
+    static const unsigned compressed_subsets = 1000;
+    // Uncompressed message with many subsets
+    std::string many_subsets;
+    // File with many copies of the BUFR messages in bufr_data
+    sys::Tempfile bufr_file;
+    // Hash of the data descriptor section of the messages selected from
+    // bufr_file by the select_bufr_* benchmarks
+    uint32_t selected_datadesc;
+    Task read_bits;
+    Task write_bits;
+    Task read_bufr;
+    Task scan_bufr;
+    Task stream_bufr;
+    Task index_bufr;
+    Task select_bufr_scan;
+    Task select_bufr_index;
     Task decode_bufr_head;
     Task decode_bufr;
+    Task decode_bufr_arena;
+    Task decode_bufr_recycle;
+    Task decode_bufr_filter;
+    Task decode_bufr_compressed;
+    Task decode_bufr_varcodes;
+    Task decode_bufr_columns;
+    Task decode_bufr_visitor;
+    Task decode_bufr_many_subsets;
+    Task decode_bufr_threads;
+    Task decode_bufr_compressed_threads;
+    Task dispatch_callback;
+    Task dispatch_sink;
+    Task query_btable;
+    Task query_dtable;
+    Task load_btable;
+    Task load_btable_compiled;
     Task decode_crex_head;
     Task decode_crex;
     Task encode_bufr;
     Task encode_crex;
 
     BulletinBenchmark(const std::string& name)
-        : Benchmark(name), decode_bufr_head(this, "decode_bufr_head"),
-          decode_bufr(this, "decode_bufr"),
+        : Benchmark(name), read_bits(this, "read_bits"),
+          write_bits(this, "write_bits"), read_bufr(this, "read_bufr"),
+          scan_bufr(this, "scan_bufr"), stream_bufr(this, "stream_bufr"),
+          index_bufr(this, "index_bufr"),
+          select_bufr_scan(this, "select_bufr_scan"),
+          select_bufr_index(this, "select_bufr_index"),
+          decode_bufr_head(this, "decode_bufr_head"),
+          decode_bufr(this, "decode_bufr", true),
+          decode_bufr_arena(this, "decode_bufr_arena", true),
+          decode_bufr_recycle(this, "decode_bufr_recycle", true),
+          decode_bufr_filter(this, "decode_bufr_filter"),
+          decode_bufr_compressed(this, "decode_bufr_compressed"),
+          decode_bufr_varcodes(this, "decode_bufr_varcodes"),
+          decode_bufr_columns(this, "decode_bufr_columns"),
+          decode_bufr_visitor(this, "decode_bufr_visitor"),
+          decode_bufr_many_subsets(this, "decode_bufr_many_subsets"),
+          decode_bufr_threads(this, "decode_bufr_threads"),
+          decode_bufr_compressed_threads(this,
+                                         "decode_bufr_compressed_threads"),
+          dispatch_callback(this, "dispatch_callback"),
+          dispatch_sink(this, "dispatch_sink"),
+          query_btable(this, "query_btable"),
+          query_dtable(this, "query_dtable"),
+          load_btable(this, "load_btable"),
+          load_btable_compiled(this, "load_btable_compiled"),
           decode_crex_head(this, "decode_crex_head"),
           decode_crex(this, "decode_crex"), encode_bufr(this, "encode_bufr"),
           encode_crex(this, "encode_crex")
@@ -95,7 +181,7 @@ struct BulletinBenchmark : Benchmark
         repetitions = 20;
     }
 
-    void setup_main()
+    void setup_main() override
     {
         Benchmark::setup_main();
         load<BufrBulletin>(
@@ -167,12 +253,167 @@ struct BulletinBenchmark : Benchmark
                             "test-mare2.crex", "test-synop0.crex",
                             "test-synop1.crex", "test-synop2.crex",
                             "test-synop3.crex", "test-temp0.crex"});
+        for (unsigned i = 0; i < bufr_data.size(); ++i)
+            if (BufrBulletin::decode_header(bufr_data[i].data)->compression)
+                bufr_compressed.push_back(i);
+
+        // Reencode the compressed message with the most subsets without
+        // compression
+        for (auto& d : bufr_data)
+            if (d.fname == "ascat1.bufr")
+            {
+                auto msg         = BufrBulletin::decode(d.data);
+                msg->compression = false;
+                many_subsets     = msg->encode();
+            }
+
+        varinfo::set_bufr(compressed_info, WR_VAR(0, 12, 101), "TEMPERATURE",
+                          "K", 16, 0, 2);
+        buffers::BufrOutput out(compressed_data);
+        for (unsigned v = 0; v < compressed_vars; ++v)
+        {
+            out.add_bits(27315, 16);
+            out.add_bits(8, 6);
+            for (unsigned i = 0; i < compressed_subsets; ++i)
+                out.add_bits((i * 7 + v) % 255, 8);
+        }
+        out.flush();
+
+        for (unsigned run = 0; run < 500; ++run)
+            for (const auto& d : bufr_data)
+                bufr_file.write_all_or_throw(d.data.data(), d.data.size());
+
+        for (auto& d : bufr_data)
+            if (d.fname == "obs0-1.22.bufr")
+                selected_datadesc = IndexRecord::hash_datadesc(
+                    BufrBulletin::decode_header(d.data)->datadesc);
+        MessageIndex index(bufr_file.path());
+        index.build();
+        index.write();
     }
 
-    void teardown_main() { Benchmark::teardown_main(); }
+    /// Decode compressed_data into \a bulletin, with any supported \a dest
+    template <typename Dest>
+    void decode_compressed_data(Bulletin& bulletin, Dest& dest)
+    {
+        for (auto& subset : bulletin.subsets)
+            subset.clear();
+        bufr::Input in(compressed_data);
+        for (unsigned v = 0; v < compressed_vars; ++v)
+            in.decode_compressed_number(&compressed_info, compressed_subsets,
+                                        dest);
+    }
+
+    void teardown_main() override
+    {
+        std::filesystem::remove(MessageIndex::index_path(bufr_file.path()));
+        Benchmark::teardown_main();
+    }
 
     void main() override
     {
+        // Bit-level reads of the whole BUFR corpus, using the mix of widths
+        // found in typical B tables
+        read_bits.collect([&]() {
+            static const unsigned widths[] = {1, 6, 7, 8, 10, 12, 15, 16, 24, 32};
+            for (unsigned run = 0; run < 10; ++run)
+                for (auto& d : bufr_data)
+                {
+                    bufr::Input in(d.data);
+                    unsigned w = 0;
+                    while (in.bits_left() > 32)
+                    {
+                        in.get_bits(widths[w]);
+                        w = (w + 1) % (sizeof(widths) / sizeof(widths[0]));
+                    }
+                }
+        });
+        // Bit-level writes of the same amount of data, using the same mix of
+        // widths as read_bits
+        write_bits.collect([&]() {
+            static const unsigned widths[] = {1, 6, 7, 8, 10, 12, 15, 16, 24, 32};
+            for (unsigned run = 0; run < 10; ++run)
+                for (auto& d : bufr_data)
+                {
+                    std::string buf;
+                    buffers::BufrOutput out(buf);
+                    unsigned w  = 0;
+                    size_t bits = 0;
+                    while (bits + 32 < d.data.size() * 8)
+                    {
+                        out.add_bits(bits, widths[w]);
+                        bits += widths[w];
+                        w = (w + 1) % (sizeof(widths) / sizeof(widths[0]));
+                    }
+                    out.flush();
+                }
+        });
+        // Find all the messages in a file, reading them with stdio or
+        // scanning a memory mapping
+        read_bufr.collect([&]() {
+            FILE* in = fopen(bufr_file.path().c_str(), "rb");
+            std::string buf;
+            while (BufrBulletin::read(in, buf))
+                ;
+            fclose(in);
+        });
+        scan_bufr.collect([&]() {
+            FileScanner scanner(bufr_file.path());
+            ScannedMessage msg;
+            while (scanner.next_bufr(msg))
+                ;
+        });
+        // Same as read_bufr, feeding chunks read from the file to a stream
+        // scanner
+        stream_bufr.collect([&]() {
+            sys::File in(bufr_file.path(), O_RDONLY);
+            unsigned count = 0;
+            StreamScanner scanner(StreamScanner::BUFR,
+                                  [&](const ScannedMessage&) noexcept {
+                                      ++count;
+                                  });
+            char buf[65536];
+            while (size_t size = in.read(buf, sizeof(buf)))
+                scanner.feed(buf, size);
+            scanner.finish();
+        });
+        // Index all the messages in a file, decoding their headers
+        index_bufr.collect([&]() {
+            MessageIndex index(bufr_file.path());
+            index.build();
+        });
+        // Decode the messages in a file with a given data descriptor section,
+        // decoding the headers of all messages to select them, or using a
+        // previously written index
+        select_bufr_scan.collect([&]() {
+            FileScanner scanner(bufr_file.path());
+            ScannedMessage msg;
+            while (scanner.next_bufr(msg))
+            {
+                try
+                {
+                    auto head = BufrBulletin::decode_header(msg.data, msg.size);
+                    if (IndexRecord::hash_datadesc(head->datadesc) ==
+                        selected_datadesc)
+                        BufrBulletin::decode(msg.data, msg.size);
+                }
+                catch (error&)
+                {
+                }
+            }
+        });
+        select_bufr_index.collect([&]() {
+            MessageIndex index(bufr_file.path());
+            if (!index.load())
+                throw error_consistency("benchmark index is out of date");
+            index.decode(
+                [&](const IndexRecord& rec) noexcept {
+                    return rec.datadesc_hash == selected_datadesc;
+                },
+                [](const IndexRecord&, std::unique_ptr<BufrBulletin>) noexcept {
+                    return true;
+                });
+        });
         decode_bufr_head.collect([&]() {
             for (auto& d : bufr_data)
                 d.decode_header(d.data);
@@ -181,6 +422,146 @@ struct BulletinBenchmark : Benchmark
             for (auto& d : bufr_data)
                 d.decode(d.data);
         });
+        // Decode all messages into the same bulletin, using an arena
+        auto reused = BufrBulletin::create();
+        reused->arena.reset(new Arena);
+        decode_bufr_arena.collect([&]() {
+            for (auto& d : bufr_data)
+                BufrBulletin::decode(d.data, *reused);
+        });
+        // Same as decode_bufr_arena, also reusing the storage of the subsets
+        auto recycled = BufrBulletin::create();
+        recycled->arena.reset(new Arena);
+        recycled->recycle = true;
+        decode_bufr_recycle.collect([&]() {
+            for (auto& d : bufr_data)
+                BufrBulletin::decode(d.data, *recycled);
+        });
+        // Decode only the messages with land surface data, skipping the data
+        // section of the others
+        decode_bufr_filter.collect([&]() {
+            auto opts = BufrCodecOptions::create();
+            opts->decode_header_filter = [](const BufrBulletin& b) noexcept {
+                return b.data_category == 0;
+            };
+            for (auto& d : bufr_data)
+                BufrBulletin::decode(d.data, *opts);
+        });
+        decode_bufr_compressed.collect([&]() {
+            for (unsigned run = 0; run < 3; ++run)
+                for (auto i : bufr_compressed)
+                    BufrBulletin::decode(bufr_data[i].data);
+        });
+        // Same as decode_bufr_compressed, decoding by columns
+        ColumnarData columns;
+        decode_bufr_columns.collect([&]() {
+            for (unsigned run = 0; run < 3; ++run)
+                for (auto i : bufr_compressed)
+                    BufrBulletin::decode_columns(bufr_data[i].data, columns);
+        });
+        // Same as decode_bufr, sending values to a visitor instead of
+        // storing them
+        CountValues counter;
+        decode_bufr_visitor.collect([&]() {
+            for (auto& d : bufr_data)
+                BufrBulletin::decode(d.data, counter);
+        });
+        // Decode an uncompressed message with many subsets, serially and
+        // using multiple threads
+        decode_bufr_many_subsets.collect([&]() {
+            for (unsigned run = 0; run < 3; ++run)
+                BufrBulletin::decode(many_subsets);
+        });
+        auto threads_opts            = BufrCodecOptions::create();
+        threads_opts->decode_threads = 4;
+        decode_bufr_threads.collect([&]() {
+            for (unsigned run = 0; run < 3; ++run)
+                BufrBulletin::decode(many_subsets, *threads_opts);
+        });
+        // Same as decode_bufr_compressed, using multiple threads
+        decode_bufr_compressed_threads.collect([&]() {
+            for (unsigned run = 0; run < 3; ++run)
+                for (auto i : bufr_compressed)
+                    BufrBulletin::decode(bufr_data[i].data, *threads_opts);
+        });
+        // Decode only station, position, time and temperature
+        auto varcodes_opts = BufrCodecOptions::create();
+        varcodes_opts->decode_varcodes = {
+            WR_VAR(0, 1, 1),  WR_VAR(0, 1, 2),  WR_VAR(0, 4, 1),
+            WR_VAR(0, 4, 2),  WR_VAR(0, 4, 3),  WR_VAR(0, 4, 4),
+            WR_VAR(0, 5, 1),  WR_VAR(0, 6, 1),  WR_VAR(0, 12, 101),
+            WR_VAR(0, 12, 1),
+        };
+        decode_bufr_varcodes.collect([&]() {
+            for (auto& d : bufr_data)
+                BufrBulletin::decode(d.data, *varcodes_opts);
+        });
+        // Per-value dispatch overhead of the compressed decoder, going through
+        // a std::function callback or a sink
+        auto bulletin                         = BufrBulletin::create();
+        bulletin->edition_number              = 4;
+        bulletin->originating_centre          = 98;
+        bulletin->master_table_version_number = 19;
+        bulletin->load_tables();
+        for (unsigned i = 0; i < compressed_subsets; ++i)
+            bulletin->obtain_subset(i);
+        dispatch_callback.collect([&]() {
+            std::function<void(unsigned, Var&&)> dest = [&](unsigned subset,
+                                                            Var&& var) {
+                bulletin->subsets[subset].store_variable(std::move(var));
+            };
+            for (unsigned run = 0; run < 10; ++run)
+                decode_compressed_data(*bulletin, dest);
+        });
+        dispatch_sink.collect([&]() {
+            bufr::DispatchToSubsets dest(*bulletin, compressed_subsets);
+            for (unsigned run = 0; run < 10; ++run)
+                decode_compressed_data(*bulletin, dest);
+        });
+        // Look up all the entries of the B and D tables used by the
+        // dispatch benchmarks
+        std::vector<Varcode> bcodes;
+        bulletin->tables.btable->iterate([&](Varinfo info) {
+            bcodes.push_back(info->code);
+            return true;
+        });
+        std::vector<Varcode> dcodes;
+        for (unsigned x = 0; x < 64; ++x)
+            for (unsigned y = 0; y < 256; ++y)
+                try
+                {
+                    bulletin->tables.dtable->query(WR_VAR(3, x, y));
+                    dcodes.push_back(WR_VAR(3, x, y));
+                }
+                catch (error_notfound&)
+                {
+                }
+        query_btable.collect([&]() {
+            for (unsigned run = 0; run < 1000; ++run)
+                for (auto code : bcodes)
+                    bulletin->tables.btable->query(code);
+        });
+        query_dtable.collect([&]() {
+            for (unsigned run = 0; run < 1000; ++run)
+                for (auto code : dcodes)
+                    bulletin->tables.dtable->query(code);
+        });
+
+        // Load a copy of the B table, so that it can be compiled
+        sys::Tempdir tables_dir;
+        std::filesystem::path btable_path =
+            tables_dir.path() / bulletin->tables.btable->path().filename();
+        sys::write_file(btable_path,
+                        sys::read_file(bulletin->tables.btable->path()));
+        Vartable::compile(btable_path);
+        load_btable.collect([&]() {
+            for (unsigned run = 0; run < 100; ++run)
+                vartable::Bufr table(btable_path, false);
+        });
+        load_btable_compiled.collect([&]() {
+            for (unsigned run = 0; run < 100; ++run)
+                vartable::Bufr table(btable_path);
+        });
         decode_crex_head.collect([&]() {
             for (auto& d : crex_data)
                 d.decode_header(d.data);
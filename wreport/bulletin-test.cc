@@ -7,6 +7,20 @@ using namespace std;
 
 namespace {
 
+/// Run \a decode, returning the error message, or an empty string on success
+template <typename Decode> std::string decode_error(Decode decode)
+{
+    try
+    {
+        decode();
+    }
+    catch (std::exception& e)
+    {
+        return e.what();
+    }
+    return std::string();
+}
+
 class Tests : public TestCase
 {
     using TestCase::TestCase;
@@ -27,6 +41,194 @@ class Tests : public TestCase
                     actual(e.what()).contains("BUFR/CREX tables not loaded"));
             }
         });
+
+        add_method("decode_span_bufr", []() {
+            // Decoding from a buffer gives the same results and errors as
+            // decoding from a string
+            for (const auto& fname : all_test_files("bufr"))
+            {
+                WREPORT_TEST_INFO(info);
+                info() << fname;
+                std::string raw = slurpfile(fname);
+                // Exactly sized, so that nothing follows the message
+                std::vector<uint8_t> buf(raw.begin(), raw.end());
+
+                std::unique_ptr<BufrBulletin> expected;
+                std::string error = decode_error(
+                    [&] { expected = BufrBulletin::decode(raw, "test", 42); });
+                std::unique_ptr<BufrBulletin> decoded;
+                wassert(actual(decode_error([&] {
+                            decoded = BufrBulletin::decode(
+                                buf.data(), buf.size(), "test", 42);
+                        })) == error);
+                if (!error.empty())
+                    continue;
+                wassert(actual(decoded->diff(*expected)) == 0u);
+
+                auto opts = BufrCodecOptions::create();
+                decoded = BufrBulletin::decode(buf.data(), buf.size(), *opts);
+                wassert(actual(decoded->diff(*expected)) == 0u);
+
+                auto existing = BufrBulletin::create();
+                BufrBulletin::decode(buf.data(), buf.size(), *existing);
+                wassert(actual(existing->diff(*expected)) == 0u);
+
+                auto header =
+                    BufrBulletin::decode_header(buf.data(), buf.size());
+                wassert(actual(header->datadesc.size()) ==
+                        expected->datadesc.size());
+            }
+        });
+
+        add_method("decode_span_crex", []() {
+            for (const auto& fname : all_test_files("crex"))
+            {
+                WREPORT_TEST_INFO(info);
+                info() << fname;
+                std::string raw = slurpfile(fname);
+                std::vector<uint8_t> buf(raw.begin(), raw.end());
+
+                std::unique_ptr<CrexBulletin> expected;
+                std::string error = decode_error(
+                    [&] { expected = CrexBulletin::decode(raw, "test", 42); });
+                std::unique_ptr<CrexBulletin> decoded;
+                wassert(actual(decode_error([&] {
+                            decoded = CrexBulletin::decode(
+                                buf.data(), buf.size(), "test", 42);
+                        })) == error);
+                if (!error.empty())
+                    continue;
+                wassert(actual(decoded->diff(*expected)) == 0u);
+
+                auto header =
+                    CrexBulletin::decode_header(buf.data(), buf.size());
+                wassert(actual(header->datadesc.size()) ==
+                        expected->datadesc.size());
+            }
+        });
+
+        add_method("decode_span_errors", []() {
+            // Errors report the file name and offset of truncated messages
+            std::string raw = slurpfile("bufr/obs0-1.22.bufr");
+            std::vector<uint8_t> buf(raw.begin(), raw.begin() + 40);
+            auto e =
+                wassert_throws(error_parse, BufrBulletin::decode(
+                                                buf.data(), buf.size(),
+                                                "test.bufr", 1000));
+            wassert(actual(e.what()).contains("test.bufr:1000+"));
+
+            raw = slurpfile("crex/test-synop0.crex");
+            std::vector<uint8_t> crex(raw.begin(), raw.begin() + 40);
+            auto e1 =
+                wassert_throws(error_parse, CrexBulletin::decode(
+                                                crex.data(), crex.size(),
+                                                "test.crex", 2000));
+            wassert(actual(e1.what()).contains("test.crex:2000+"));
+        });
+
+        add_method("decode_header_filter", []() {
+            std::string raw = slurpfile("bufr/obs0-1.22.bufr");
+            auto expected   = BufrBulletin::decode(raw);
+
+            // The filter sees the decoded header, before the data section
+            auto opts     = BufrCodecOptions::create();
+            unsigned seen = 0;
+            opts->decode_header_filter = [&](const BufrBulletin& b) {
+                ++seen;
+                wassert(actual(b.originating_centre) ==
+                        expected->originating_centre);
+                wassert(actual(b.datadesc.size()) ==
+                        expected->datadesc.size());
+                wassert(actual(b.subsets.size()) == 0u);
+                return b.data_category == expected->data_category;
+            };
+            auto decoded = BufrBulletin::decode(raw, *opts);
+            wassert(actual(seen) == 1u);
+            wassert_true(decoded.get());
+            wassert(actual(decoded->diff(*expected)) == 0u);
+
+            // Rejected messages are not decoded
+            opts->decode_header_filter = [](const BufrBulletin&) noexcept {
+                return false;
+            };
+            wassert_false(BufrBulletin::decode(raw, *opts).get());
+
+            // The filter does not affect header decoding
+            auto header = BufrBulletin::decode_header(raw, *opts);
+            wassert(actual(header->data_category) == expected->data_category);
+        });
+
+        add_method("decode_recycle", []() {
+            // Decoding into a recycling bulletin gives the same results as
+            // decoding into a new one
+            auto recycled     = BufrBulletin::create();
+            recycled->recycle = true;
+            for (int pass = 0; pass < 2; ++pass)
+                for (const auto& fname : all_test_files("bufr"))
+                {
+                    WREPORT_TEST_INFO(info);
+                    info() << fname << " pass " << pass;
+                    std::string raw = slurpfile(fname);
+                    std::unique_ptr<BufrBulletin> expected;
+                    try
+                    {
+                        expected = BufrBulletin::decode(raw);
+                    }
+                    catch (std::exception&)
+                    {
+                        continue;
+                    }
+                    BufrBulletin::decode(
+                        reinterpret_cast<const uint8_t*>(raw.data()),
+                        raw.size(), *recycled);
+                    wassert(actual(recycled->diff(*expected)) == 0u);
+                }
+        });
+
+        add_method("decode_recycle_options", []() {
+            // Decoding options work when decoding into a recycling bulletin
+            auto opts            = BufrCodecOptions::create();
+            opts->decode_threads = 4;
+            opts->decode_header_filter = [](const BufrBulletin& b) noexcept {
+                return b.data_category == 0;
+            };
+            auto recycled     = BufrBulletin::create();
+            recycled->recycle = true;
+            unsigned accepted = 0, rejected = 0;
+            for (int pass = 0; pass < 2; ++pass)
+                for (const auto& fname : all_test_files("bufr"))
+                {
+                    WREPORT_TEST_INFO(info);
+                    info() << fname << " pass " << pass;
+                    std::string raw = slurpfile(fname);
+                    std::unique_ptr<BufrBulletin> expected;
+                    try
+                    {
+                        expected = BufrBulletin::decode(raw);
+                    }
+                    catch (std::exception&)
+                    {
+                        continue;
+                    }
+                    if (wcallchecked(
+                            BufrBulletin::decode(raw, *opts, *recycled)))
+                    {
+                        wassert(actual(expected->data_category) == 0u);
+                        wassert(actual(recycled->diff(*expected)) == 0u);
+                        ++accepted;
+                    }
+                    else
+                    {
+                        wassert(actual(expected->data_category) != 0u);
+                        wassert(actual(recycled->data_category) ==
+                                expected->data_category);
+                        wassert_true(recycled->subsets.empty());
+                        ++rejected;
+                    }
+                }
+            wassert(actual(accepted) > 0u);
+            wassert(actual(rejected) > 0u);
+        });
     }
 } test("bulletin");
 
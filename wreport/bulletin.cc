@@ -49,6 +49,42 @@ bool seek_past_signature(FILE* fd, const char* sig, unsigned sig_len,
     return true;
 }
 
+/// Access the contents of a string as a buffer of bytes
+inline const uint8_t* bytes(const std::string& buf)
+{
+    return reinterpret_cast<const uint8_t*>(buf.data());
+}
+
+/// Options used by the decode functions that do not take any
+const BufrCodecOptions& default_options()
+{
+    static const auto res = BufrCodecOptions::create();
+    return *res;
+}
+
+/**
+ * Decode the header of a BUFR message into \a out, configured with \a opts.
+ *
+ * If the header passes opts.decode_header_filter, call \a decode_data with the
+ * decoder to decode the data section, and return true. Otherwise, return false
+ * without reading the data section.
+ */
+template <typename DecodeData>
+bool decode_bufr(const uint8_t* data, size_t size,
+                 const BufrCodecOptions& opts, const char* fname,
+                 size_t offset, BufrBulletin& out, DecodeData decode_data)
+{
+    out.fname  = fname;
+    out.offset = offset;
+    bufr::Decoder d(data, size, fname, offset, out);
+    d.read_options(opts);
+    d.decode_header();
+    if (opts.decode_header_filter && !opts.decode_header_filter(out))
+        return false;
+    decode_data(d);
+    return true;
+}
+
 } // namespace
 
 /*
@@ -68,15 +104,34 @@ void Bulletin::clear()
     update_sequence_number                     = 0;
     rep_year                                   = 0;
     rep_month = rep_day = rep_hour = rep_minute = rep_second = 0;
+    // Variables may use Varinfos owned by tables, so clear them first
+    if (recycle)
+    {
+        for (auto& subset : subsets)
+        {
+            subset.clear();
+            m_spare_subsets.emplace_back(std::move(subset));
+        }
+    }
+    subsets.clear();
+    if (arena)
+        arena->reset();
     tables.clear();
     datadesc.clear();
-    subsets.clear();
 }
 
 Subset& Bulletin::obtain_subset(unsigned subsection)
 {
     while (subsection >= subsets.size())
-        subsets.emplace_back(tables);
+    {
+        if (m_spare_subsets.empty())
+            subsets.emplace_back(tables);
+        else
+        {
+            subsets.emplace_back(std::move(m_spare_subsets.back()));
+            m_spare_subsets.pop_back();
+        }
+    }
     return subsets[subsection];
 }
 
@@ -382,13 +437,16 @@ BufrBulletin::decode_header(const std::string& buf,
                             const BufrCodecOptions& opts, const char* fname,
                             size_t offset)
 {
-    auto res    = BufrBulletin::create();
-    res->fname  = fname;
-    res->offset = offset;
-    bufr::Decoder d(buf, fname, offset, *res);
-    d.read_options(opts);
-    d.decode_header();
-    return res;
+    return decode_header(bytes(buf), buf.size(), opts, fname, offset);
+}
+
+std::unique_ptr<BufrBulletin>
+BufrBulletin::decode_header(const uint8_t* data, size_t size,
+                            const BufrCodecOptions& opts, const char* fname,
+                            size_t offset)
+{
+    // Options only affect the decoding of the data section
+    return decode_header(data, size, fname, offset);
 }
 
 std::unique_ptr<BufrBulletin> BufrBulletin::decode(const std::string& buf,
@@ -396,13 +454,19 @@ std::unique_ptr<BufrBulletin> BufrBulletin::decode(const std::string& buf,
                                                    const char* fname,
                                                    size_t offset)
 {
-    auto res    = BufrBulletin::create();
-    res->fname  = fname;
-    res->offset = offset;
-    bufr::Decoder d(buf, fname, offset, *res);
-    d.read_options(opts);
-    d.decode_header();
-    d.decode_data();
+    return decode(bytes(buf), buf.size(), opts, fname, offset);
+}
+
+std::unique_ptr<BufrBulletin> BufrBulletin::decode(const uint8_t* data,
+                                                   size_t size,
+                                                   const BufrCodecOptions& opts,
+                                                   const char* fname,
+                                                   size_t offset)
+{
+    auto res = BufrBulletin::create();
+    if (!decode_bufr(data, size, opts, fname, offset, *res,
+                     [](bufr::Decoder& d) { d.decode_data(); }))
+        return nullptr;
     return res;
 }
 
@@ -410,23 +474,95 @@ std::unique_ptr<BufrBulletin>
 BufrBulletin::decode_header(const std::string& buf, const char* fname,
                             size_t offset)
 {
-    auto res    = BufrBulletin::create();
-    res->fname  = fname;
-    res->offset = offset;
-    bufr::Decoder d(buf, fname, offset, *res);
-    d.decode_header();
+    return decode_header(bytes(buf), buf.size(), fname, offset);
+}
+
+std::unique_ptr<BufrBulletin>
+BufrBulletin::decode_header(const uint8_t* data, size_t size,
+                            const char* fname, size_t offset)
+{
+    auto res = BufrBulletin::create();
+    decode_bufr(data, size, default_options(), fname, offset, *res,
+                [](bufr::Decoder&) {});
     return res;
 }
 
 std::unique_ptr<BufrBulletin>
 BufrBulletin::decode(const std::string& buf, const char* fname, size_t offset)
 {
-    auto res    = BufrBulletin::create();
-    res->fname  = fname;
-    res->offset = offset;
-    bufr::Decoder d(buf, fname, offset, *res);
-    d.decode_header();
-    d.decode_data();
+    return decode(bytes(buf), buf.size(), fname, offset);
+}
+
+std::unique_ptr<BufrBulletin> BufrBulletin::decode(const uint8_t* data,
+                                                   size_t size,
+                                                   const char* fname,
+                                                   size_t offset)
+{
+    return decode(data, size, default_options(), fname, offset);
+}
+
+void BufrBulletin::decode(const std::string& buf, BufrBulletin& out,
+                          const char* fname, size_t offset)
+{
+    decode(bytes(buf), buf.size(), out, fname, offset);
+}
+
+void BufrBulletin::decode(const uint8_t* data, size_t size, BufrBulletin& out,
+                          const char* fname, size_t offset)
+{
+    decode(data, size, default_options(), out, fname, offset);
+}
+
+bool BufrBulletin::decode(const std::string& buf, const BufrCodecOptions& opts,
+                          BufrBulletin& out, const char* fname, size_t offset)
+{
+    return decode(bytes(buf), buf.size(), opts, out, fname, offset);
+}
+
+bool BufrBulletin::decode(const uint8_t* data, size_t size,
+                          const BufrCodecOptions& opts, BufrBulletin& out,
+                          const char* fname, size_t offset)
+{
+    out.clear();
+    return decode_bufr(data, size, opts, fname, offset, out,
+                       [](bufr::Decoder& d) { d.decode_data(); });
+}
+
+std::unique_ptr<BufrBulletin>
+BufrBulletin::decode_columns(const std::string& buf, ColumnarData& columns,
+                             const char* fname, size_t offset)
+{
+    return decode_columns(bytes(buf), buf.size(), columns, fname, offset);
+}
+
+std::unique_ptr<BufrBulletin>
+BufrBulletin::decode_columns(const uint8_t* data, size_t size,
+                             ColumnarData& columns, const char* fname,
+                             size_t offset)
+{
+    auto res = BufrBulletin::create();
+    decode_bufr(data, size, default_options(), fname, offset, *res,
+                [&](bufr::Decoder& d) { d.decode_data_columns(columns); });
+    return res;
+}
+
+std::unique_ptr<BufrBulletin> BufrBulletin::decode(const std::string& buf,
+                                                   DecodeVisitor& visitor,
+                                                   const char* fname,
+                                                   size_t offset)
+{
+    return decode(bytes(buf), buf.size(), visitor, fname, offset);
+}
+
+std::unique_ptr<BufrBulletin> BufrBulletin::decode(const uint8_t* data,
+                                                   size_t size,
+                                                   DecodeVisitor& visitor,
+                                                   const char* fname,
+                                                   size_t offset)
+{
+    auto res = BufrBulletin::create();
+    decode_bufr(data, size, default_options(), fname, offset, *res,
+                [&](bufr::Decoder& d) { d.decode_data_visitor(visitor); });
     return res;
 }
 
@@ -434,13 +570,19 @@ std::unique_ptr<BufrBulletin>
 BufrBulletin::decode_verbose(const std::string& buf, FILE* out,
                              const char* fname, size_t offset)
 {
-    auto res    = BufrBulletin::create();
-    res->fname  = fname;
-    res->offset = offset;
-    bufr::Decoder d(buf, fname, offset, *res);
-    d.verbose_output = out;
-    d.decode_header();
-    d.decode_data();
+    return decode_verbose(bytes(buf), buf.size(), out, fname, offset);
+}
+
+std::unique_ptr<BufrBulletin>
+BufrBulletin::decode_verbose(const uint8_t* data, size_t size, FILE* out,
+                             const char* fname, size_t offset)
+{
+    auto res = BufrBulletin::create();
+    decode_bufr(data, size, default_options(), fname, offset, *res,
+                [&](bufr::Decoder& d) {
+                    d.verbose_output = out;
+                    d.decode_data();
+                });
     return res;
 }
 
@@ -485,15 +627,12 @@ unsigned BufrBulletin::diff_details(const Bulletin& bulletin) const
                     msg.master_table_version_number_local);
         ++diffs;
     }
-    /*
-    // TODO: uncomment when we implement encoding BUFR with compression
-    if (compression != m->compression)
+    if (compression != msg.compression)
     {
-    notes::logf("BUFR compression differs (first is %d, second is %d)\n",
-    compression, m->compression);
-    ++diffs;
+        notes::logf("BUFR compression differs (first is %d, second is %d)\n",
+                    compression, msg.compression);
+        ++diffs;
     }
-    */
     if (optional_section.size() != msg.optional_section.size())
     {
         notes::logf(
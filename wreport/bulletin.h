@@ -1,8 +1,11 @@
 #ifndef WREPORT_BULLETIN_H
 #define WREPORT_BULLETIN_H
 
+#include <functional>
 #include <memory>
+#include <set>
 #include <vector>
+#include <wreport/arena.h>
 #include <wreport/fwd.h>
 #include <wreport/opcodes.h>
 #include <wreport/subset.h>
@@ -120,6 +123,27 @@ public:
     /// Parsed data descriptor section
     std::vector<Varcode> datadesc;
 
+    /**
+     * Optional memory arena for the decoded variables.
+     *
+     * If set, decoding allocates long string and binary values and attributes
+     * in the arena, and clear() releases them all at once, keeping the memory
+     * for the next decoding. Reusing the same bulletin to decode a sequence of
+     * messages then saves their allocations.
+     */
+    std::unique_ptr<Arena> arena;
+
+    /**
+     * Reuse the storage of the subsets across decodings.
+     *
+     * If true, clear() keeps the subsets it removes, and obtain_subset()
+     * reuses them before creating new ones. Their variables are destroyed, but
+     * the subsets keep the capacity of their vectors, which saves growing them
+     * again when decoding a sequence of messages of similar shape into the
+     * same bulletin. Variables are created again for each decoding.
+     */
+    bool recycle = false;
+
     /// Decoded variables
     std::vector<Subset> subsets;
 
@@ -193,6 +217,10 @@ public:
 
     /// Diff format-specific details
     virtual unsigned diff_details(const Bulletin& msg) const;
+
+protected:
+    /// Emptied subsets kept by clear() for reuse, if recycle is true
+    std::vector<Subset> m_spare_subsets;
 };
 
 /// Options used to configure BUFR decoding
@@ -210,6 +238,51 @@ public:
      */
     bool decode_adds_undef_attrs = false;
 
+    /**
+     * If not empty, only variables with these codes are added to the decoded
+     * subsets.
+     *
+     * The rest of the data section is skipped without creating variables for
+     * it. Replication factors, bitmaps and associated field significances
+     * are still read to interpret the message, but they are only added to
+     * the subsets if their codes are listed. Attributes are only decoded for
+     * the variables that are added.
+     *
+     * This option is ignored by verbose decoding.
+     */
+    std::set<Varcode> decode_varcodes;
+
+    /**
+     * Maximum number of threads used to decode the data section.
+     *
+     * If greater than 1, the data section is first scanned to find where each
+     * subset starts, for uncompressed messages, or where the values of each
+     * data descriptor start, for compressed messages. Subsets or data
+     * descriptors are then decoded in parallel. The result is the same as
+     * decoding with a single thread. It is worth it only for large messages.
+     *
+     * Domain error options are propagated to the decoding threads, and a
+     * domain error hook may be called from multiple threads at the same time.
+     *
+     * This option is ignored by verbose decoding, when decoding into a
+     * bulletin with an arena, and for compressed messages when
+     * decode_varcodes is set.
+     */
+    unsigned decode_threads = 1;
+
+    /**
+     * If set, it is called with the bulletin as soon as its header has been
+     * decoded, and the data section is decoded only if it returns true.
+     *
+     * When it returns false, BufrBulletin::decode() returns nullptr, or false
+     * when decoding into an existing bulletin, without reading the data
+     * section, which is much faster than decoding messages
+     * only to discard them.
+     *
+     * This option is ignored by BufrBulletin::decode_header().
+     */
+    std::function<bool(const BufrBulletin&)> decode_header_filter;
+
     /**
      * Create a BufrCodecOptions
      *
@@ -326,6 +399,17 @@ public:
     decode_header(const std::string& raw, const char* fname = "(memory)",
                   size_t offset = 0);
 
+    /**
+     * Parse only the header of an encoded BUFR message from a memory buffer,
+     * without copying it
+     *
+     * Same as decode_header(const std::string&, const char*, size_t), reading
+     * the message from the \a size bytes at \a data.
+     */
+    static std::unique_ptr<BufrBulletin>
+    decode_header(const uint8_t* data, size_t size,
+                  const char* fname = "(memory)", size_t offset = 0);
+
     /**
      * Parse only the header of an encoded BUFR message
      *
@@ -344,6 +428,19 @@ public:
     decode_header(const std::string& raw, const BufrCodecOptions& opts,
                   const char* fname = "(memory)", size_t offset = 0);
 
+    /**
+     * Parse only the header of an encoded BUFR message from a memory buffer,
+     * without copying it
+     *
+     * Same as decode_header(const std::string&, const BufrCodecOptions&,
+     * const char*, size_t), reading the message from the \a size bytes at \a
+     * data.
+     */
+    static std::unique_ptr<BufrBulletin>
+    decode_header(const uint8_t* data, size_t size,
+                  const BufrCodecOptions& opts, const char* fname = "(memory)",
+                  size_t offset = 0);
+
     /**
      * Parse an encoded BUFR message
      *
@@ -378,6 +475,17 @@ public:
     decode_verbose(const std::string& raw, FILE* out,
                    const char* fname = "(memory)", size_t offset = 0);
 
+    /**
+     * Parse an encoded BUFR message from a memory buffer, without copying it,
+     * printing decoding information
+     *
+     * Same as decode_verbose(const std::string&, FILE*, const char*, size_t),
+     * reading the message from the \a size bytes at \a data.
+     */
+    static std::unique_ptr<BufrBulletin>
+    decode_verbose(const uint8_t* data, size_t size, FILE* out,
+                   const char* fname = "(memory)", size_t offset = 0);
+
     /**
      * Parse an encoded BUFR message
      *
@@ -390,13 +498,178 @@ public:
      * @param offset
      *   The offset inside the file of the start of the bulletin, used for
      *   error messages
-     * @returns The new bulletin with the decoded message
+     * @returns The new bulletin with the decoded message, or nullptr if it
+     * was rejected by BufrCodecOptions::decode_header_filter
      */
     static std::unique_ptr<BufrBulletin> decode(const std::string& raw,
                                                 const BufrCodecOptions& opts,
                                                 const char* fname = "(memory)",
                                                 size_t offset     = 0);
 
+    /**
+     * Parse an encoded BUFR message from a memory buffer, without copying it
+     *
+     * Same as decode(const std::string&, const BufrCodecOptions&, const
+     * char*, size_t), reading the message from the \a size bytes at \a data.
+     */
+    static std::unique_ptr<BufrBulletin> decode(const uint8_t* data,
+                                                size_t size,
+                                                const BufrCodecOptions& opts,
+                                                const char* fname = "(memory)",
+                                                size_t offset     = 0);
+
+    /**
+     * Parse an encoded BUFR message into an existing bulletin
+     *
+     * The bulletin is cleared before decoding, and if it has an arena, the
+     * decoded variables are allocated in it.
+     *
+     * @param buf
+     *   The buffer to decode
+     * @param out
+     *   The bulletin that will hold the decoded message
+     * @param fname
+     *   The file name to use for error messages
+     * @param offset
+     *   The offset inside the file of the start of the bulletin, used for
+     *   error messages
+     */
+    static void decode(const std::string& raw, BufrBulletin& out,
+                       const char* fname = "(memory)", size_t offset = 0);
+
+    /**
+     * Parse an encoded BUFR message from a memory buffer, without copying it,
+     * into an existing bulletin
+     *
+     * Same as decode(const std::string&, BufrBulletin&, const char*, size_t),
+     * reading the message from the \a size bytes at \a data.
+     */
+    static void decode(const uint8_t* data, size_t size, BufrBulletin& out,
+                       const char* fname = "(memory)", size_t offset = 0);
+
+    /**
+     * Parse an encoded BUFR message into an existing bulletin, using the
+     * given decoding options
+     *
+     * The bulletin is cleared before decoding, and if it has an arena, the
+     * decoded variables are allocated in it.
+     *
+     * @param buf
+     *   The buffer to decode
+     * @param opts
+     *   The decoding options
+     * @param out
+     *   The bulletin that will hold the decoded message
+     * @param fname
+     *   The file name to use for error messages
+     * @param offset
+     *   The offset inside the file of the start of the bulletin, used for
+     *   error messages
+     * @returns false if the message was rejected by
+     * BufrCodecOptions::decode_header_filter, in which case \a out only
+     * contains its header
+     */
+    static bool decode(const std::string& raw, const BufrCodecOptions& opts,
+                       BufrBulletin& out, const char* fname = "(memory)",
+                       size_t offset = 0);
+
+    /**
+     * Parse an encoded BUFR message from a memory buffer, without copying it,
+     * into an existing bulletin, using the given decoding options
+     *
+     * Same as decode(const std::string&, const BufrCodecOptions&,
+     * BufrBulletin&, const char*, size_t), reading the message from the \a
+     * size bytes at \a data.
+     */
+    static bool decode(const uint8_t* data, size_t size,
+                       const BufrCodecOptions& opts, BufrBulletin& out,
+                       const char* fname = "(memory)", size_t offset = 0);
+
+    /**
+     * Parse an encoded BUFR message from a memory buffer, without copying it
+     *
+     * @param data
+     *   The buffer to decode
+     * @param size
+     *   The size of the buffer
+     * @param fname
+     *   The file name to use for error messages
+     * @param offset
+     *   The offset inside the file of the start of the bulletin, used for
+     *   error messages
+     * @returns The new bulletin with the decoded message
+     */
+    static std::unique_ptr<BufrBulletin> decode(const uint8_t* data,
+                                                size_t size,
+                                                const char* fname = "(memory)",
+                                                size_t offset     = 0);
+
+    /**
+     * Parse a compressed BUFR message, decoding its data section by columns
+     *
+     * The data section is decoded into \a columns, with one Column per
+     * variable, without creating subsets.
+     *
+     * Raises error_unimplemented if the message is not compressed.
+     *
+     * @param buf
+     *   The buffer to decode
+     * @param columns
+     *   Where the contents of the data section are stored
+     * @param fname
+     *   The file name to use for error messages
+     * @param offset
+     *   The offset inside the file of the start of the bulletin, used for
+     *   error messages
+     * @returns The new bulletin with the decoded message header, and no
+     * subsets
+     */
+    static std::unique_ptr<BufrBulletin>
+    decode_columns(const std::string& raw, ColumnarData& columns,
+                   const char* fname = "(memory)", size_t offset = 0);
+
+    /**
+     * Parse a compressed BUFR message from a memory buffer, without copying
+     * it, decoding its data section by columns
+     *
+     * Same as decode_columns(const std::string&, ColumnarData&, const char*,
+     * size_t), reading the message from the \a size bytes at \a data.
+     */
+    static std::unique_ptr<BufrBulletin>
+    decode_columns(const uint8_t* data, size_t size, ColumnarData& columns,
+                   const char* fname = "(memory)", size_t offset = 0);
+
+    /**
+     * Parse an encoded BUFR message, sending the contents of its data section
+     * to \a visitor instead of storing them in subsets
+     *
+     * @param buf
+     *   The buffer to decode
+     * @param visitor
+     *   The visitor that receives the decoded values
+     * @param fname
+     *   The file name to use for error messages
+     * @param offset
+     *   The offset inside the file of the start of the bulletin, used for
+     *   error messages
+     * @returns The new bulletin with the decoded message header, and no
+     * subsets
+     */
+    static std::unique_ptr<BufrBulletin>
+    decode(const std::string& raw, DecodeVisitor& visitor,
+           const char* fname = "(memory)", size_t offset = 0);
+
+    /**
+     * Parse an encoded BUFR message from a memory buffer, without copying it,
+     * sending the contents of its data section to \a visitor
+     *
+     * Same as decode(const std::string&, DecodeVisitor&, const char*,
+     * size_t), reading the message from the \a size bytes at \a data.
+     */
+    static std::unique_ptr<BufrBulletin>
+    decode(const uint8_t* data, size_t size, DecodeVisitor& visitor,
+           const char* fname = "(memory)", size_t offset = 0);
+
 protected:
     BufrBulletin();
 };
@@ -500,6 +773,17 @@ public:
     decode_header(const std::string& raw, const char* fname = "(memory)",
                   size_t offset = 0);
 
+    /**
+     * Parse only the header of an encoded CREX message from a memory buffer,
+     * without copying it
+     *
+     * Same as decode_header(const std::string&, const char*, size_t), reading
+     * the message from the \a size bytes at \a data.
+     */
+    static std::unique_ptr<CrexBulletin>
+    decode_header(const uint8_t* data, size_t size,
+                  const char* fname = "(memory)", size_t offset = 0);
+
     /**
      * Parse an encoded BUFR message
      *
@@ -516,6 +800,17 @@ public:
                                                 const char* fname = "(memory)",
                                                 size_t offset     = 0);
 
+    /**
+     * Parse an encoded CREX message from a memory buffer, without copying it
+     *
+     * Same as decode(const std::string&, const char*, size_t), reading the
+     * message from the \a size bytes at \a data.
+     */
+    static std::unique_ptr<CrexBulletin> decode(const uint8_t* data,
+                                                size_t size,
+                                                const char* fname = "(memory)",
+                                                size_t offset     = 0);
+
     /**
      * Parse an encoded BUFR message, printing decoding information
      *
@@ -534,6 +829,17 @@ public:
     decode_verbose(const std::string& raw, FILE* out,
                    const char* fname = "(memory)", size_t offset = 0);
 
+    /**
+     * Parse an encoded CREX message from a memory buffer, without copying it,
+     * printing decoding information
+     *
+     * Same as decode_verbose(const std::string&, FILE*, const char*, size_t),
+     * reading the message from the \a size bytes at \a data.
+     */
+    static std::unique_ptr<CrexBulletin>
+    decode_verbose(const uint8_t* data, size_t size, FILE* out,
+                   const char* fname = "(memory)", size_t offset = 0);
+
 protected:
     CrexBulletin();
 };
@@ -20,7 +20,7 @@ AssociatedField::AssociatedField(const Vartable& btable)
 }
 AssociatedField::~AssociatedField() {}
 
-std::unique_ptr<Var> AssociatedField::make_attribute(unsigned value) const
+std::optional<Var> AssociatedField::attribute(unsigned value) const
 {
     bool missing = value == all_ones(bit_count);
     switch (significance)
@@ -28,19 +28,15 @@ std::unique_ptr<Var> AssociatedField::make_attribute(unsigned value) const
         case 1:
             // Add attribute B33002=value
             if (missing)
-                return std::unique_ptr<Var>(
-                    new Var(btable.query(WR_VAR(0, 33, 2))));
+                return Var(btable.query(WR_VAR(0, 33, 2)));
             else
-                return std::unique_ptr<Var>(
-                    new Var(btable.query(WR_VAR(0, 33, 2)), (int)value));
+                return Var(btable.query(WR_VAR(0, 33, 2)), (int)value);
         case 2:
             // Add attribute B33003=value
             if (missing)
-                return std::unique_ptr<Var>(
-                    new Var(btable.query(WR_VAR(0, 33, 3))));
+                return Var(btable.query(WR_VAR(0, 33, 3)));
             else
-                return std::unique_ptr<Var>(
-                    new Var(btable.query(WR_VAR(0, 33, 3)), (int)value));
+                return Var(btable.query(WR_VAR(0, 33, 3)), (int)value);
         case 3:
         case 4:
         case 5:
@@ -48,48 +44,41 @@ std::unique_ptr<Var> AssociatedField::make_attribute(unsigned value) const
             notes::logf(
                 "Ignoring B31021=%u, which is documented as 'reserved'\n",
                 significance);
-            return unique_ptr<Var>();
+            return std::nullopt;
         case 6:
             // Add attribute B33050=value
             if (missing)
             {
                 if (skip_missing)
-                    return std::unique_ptr<Var>();
+                    return std::nullopt;
                 else
-                    return std::unique_ptr<Var>(
-                        new Var(btable.query(WR_VAR(0, 33, 50))));
+                    return Var(btable.query(WR_VAR(0, 33, 50)));
             }
             else
-                return std::unique_ptr<Var>(
-                    new Var(btable.query(WR_VAR(0, 33, 50)), (int)value));
+                return Var(btable.query(WR_VAR(0, 33, 50)), (int)value);
         case 7:
             // Add attribute B33040=value
             if (missing)
-                return std::unique_ptr<Var>(
-                    new Var(btable.query(WR_VAR(0, 33, 40))));
+                return Var(btable.query(WR_VAR(0, 33, 40)));
             else
-                return std::unique_ptr<Var>(
-                    new Var(btable.query(WR_VAR(0, 33, 40)), (int)value));
+                return Var(btable.query(WR_VAR(0, 33, 40)), (int)value);
         case 8:
             // Add attribute B33002=value
             if (missing)
             {
                 if (skip_missing)
-                    return unique_ptr<Var>();
+                    return std::nullopt;
                 else
-                    return std::unique_ptr<Var>(
-                        new Var(btable.query(WR_VAR(0, 33, 2))));
+                    return Var(btable.query(WR_VAR(0, 33, 2)));
             }
             else
-                return std::unique_ptr<Var>(
-                    new Var(btable.query(WR_VAR(0, 33, 2)), (int)value));
+                return Var(btable.query(WR_VAR(0, 33, 2)), (int)value);
         case 21:
             // Add attribute B33041=value
             if (!skip_missing || !missing)
-                return std::unique_ptr<Var>(
-                    new Var(btable.query(WR_VAR(0, 33, 41)), 0));
+                return Var(btable.query(WR_VAR(0, 33, 41)), 0);
             else
-                return std::unique_ptr<Var>();
+                return std::nullopt;
         case 63:
             /*
              * Ignore quality information if B31021 is missing.
@@ -105,7 +94,7 @@ std::unique_ptr<Var> AssociatedField::make_attribute(unsigned value) const
              *   associated field bits by the "cancel" operator: 2
              *   04 000.
              */
-            return std::unique_ptr<Var>();
+            return std::nullopt;
         default:
             if (significance >= 9 and significance <= 20)
                 // Reserved: ignored
@@ -120,10 +109,18 @@ std::unique_ptr<Var> AssociatedField::make_attribute(unsigned value) const
                 error_unimplemented::throwf(
                     "C04 modifiers with B31021=%u are not supported",
                     significance);
-            return std::unique_ptr<Var>();
+            return std::nullopt;
     }
 }
 
+std::unique_ptr<Var> AssociatedField::make_attribute(unsigned value) const
+{
+    std::optional<Var> res = attribute(value);
+    if (!res)
+        return std::unique_ptr<Var>();
+    return std::unique_ptr<Var>(new Var(std::move(*res)));
+}
+
 const Var* AssociatedField::get_attribute(const Var& var) const
 {
     /*
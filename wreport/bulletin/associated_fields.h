@@ -2,6 +2,7 @@
 #define WREPORT_BULLETIN_ASSOCIATED_FIELDS_H
 
 #include <memory>
+#include <optional>
 
 namespace wreport {
 class Var;
@@ -42,6 +43,14 @@ struct AssociatedField
      */
     std::unique_ptr<Var> make_attribute(unsigned value) const;
 
+    /**
+     * Same as make_attribute(), but returning the attribute by value, so that
+     * it can be stored without allocating it first.
+     *
+     * An empty return value means "no field to associate".
+     */
+    std::optional<Var> attribute(unsigned value) const;
+
     /**
      * Get the attribute of var corresponding to this associated field
      * significance.
@@ -5,6 +5,14 @@
 namespace wreport {
 namespace bulletin {
 
+namespace {
+
+template <typename CodeAt>
+void compute_refs(const Var& bitmap, unsigned anchor, CodeAt code_at,
+                  std::vector<unsigned>& refs);
+
+} // namespace
+
 Bitmap::Bitmap(const Var& bitmap, const Subset& subset)
     : Bitmap(bitmap, subset, subset.size())
 {
@@ -30,6 +38,33 @@ Bitmap::Bitmap(const Var& bitmap, const Subset& subset, unsigned anchor)
     //  FIXME: we do not seem to currently do that and all seems fine; do we
     //  actually have samples where this matters?
 
+    compute_refs(
+        bitmap, anchor, [&](unsigned pos) { return subset[pos].code(); },
+        refs);
+    iter = refs.rbegin();
+}
+
+Bitmap::Bitmap(const Var& bitmap, const std::vector<Varinfo>& layout)
+    : bitmap(bitmap)
+{
+    compute_refs(
+        bitmap, layout.size(), [&](unsigned pos) { return layout[pos]->code; },
+        refs);
+    iter = refs.rbegin();
+}
+
+namespace {
+
+/**
+ * Fill \a refs with the indices of the variables for which \a bitmap reports
+ * that data is present, going backwards from \a anchor.
+ *
+ * code_at(i) returns the code of the variable at index i.
+ */
+template <typename CodeAt>
+void compute_refs(const Var& bitmap, unsigned anchor, CodeAt code_at,
+                  std::vector<unsigned>& refs)
+{
     unsigned b_cur = bitmap.info()->len;
     unsigned s_cur = anchor;
     if (b_cur == 0)
@@ -42,7 +77,7 @@ Bitmap::Bitmap(const Var& bitmap, const Subset& subset, unsigned anchor)
     {
         --b_cur;
         --s_cur;
-        while (WR_VAR_F(subset[s_cur].code()) != 0)
+        while (WR_VAR_F(code_at(s_cur)) != 0)
         {
             if (s_cur == 0)
                 throw error_consistency("bitmap refers to variables before the "
@@ -59,10 +94,10 @@ Bitmap::Bitmap(const Var& bitmap, const Subset& subset, unsigned anchor)
             throw error_consistency(
                 "bitmap refers to variables before the start of the subset");
     }
-
-    iter = refs.rbegin();
 }
 
+} // namespace
+
 Bitmap::~Bitmap() {}
 
 bool Bitmap::eob() const { return iter == refs.rend(); }
@@ -108,6 +143,12 @@ void Bitmaps::define(const Var& bitmap, const Subset& subset,
     current = new Bitmap(bitmap, subset, anchor_point);
 }
 
+void Bitmaps::define(const Var& bitmap, const std::vector<Varinfo>& layout)
+{
+    delete current;
+    current = new Bitmap(bitmap, layout);
+}
+
 void Bitmaps::reuse_last()
 {
     // Only throw an error when the bitmap is actually used
@@ -43,6 +43,14 @@ struct Bitmap
      */
     Bitmap(const Var& bitmap, const Subset& subset, unsigned anchor);
     Bitmap(const Var& bitmap, const Subset& subset);
+
+    /**
+     * Create a new bitmap referring to a sequence of variables described by
+     * \a layout, anchored at its end.
+     *
+     * This is used when the decoded variables are not all stored in a subset.
+     */
+    Bitmap(const Var& bitmap, const std::vector<Varinfo>& layout);
     Bitmap(const Bitmap&) = delete;
     ~Bitmap();
     Bitmap& operator=(const Bitmap&) = delete;
@@ -81,6 +89,7 @@ struct Bitmaps
 
     void define(const Var& bitmap, const Subset& subset);
     void define(const Var& bitmap, const Subset& subset, unsigned anchor_point);
+    void define(const Var& bitmap, const std::vector<Varinfo>& layout);
 
     void reuse_last();
 
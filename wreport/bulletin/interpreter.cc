@@ -1,10 +1,12 @@
 #include "interpreter.h"
+#include "plan.h"
 #include "wreport/dtable.h"
 #include "wreport/error.h"
 #include "wreport/notes.h"
 #include "wreport/tables.h"
 #include "wreport/var.h"
 #include "wreport/vartable.h"
+#include <algorithm>
 
 // #define TRACE_INTERPRETER
 
@@ -23,18 +25,72 @@ namespace wreport {
 namespace bulletin {
 
 Interpreter::Interpreter(const Tables& tables, const Opcodes& opcodes)
-    : tables(tables), associated_field(*tables.btable)
+    : Interpreter(tables, opcodes, Plan::get(tables, opcodes))
 {
+}
+
+Interpreter::Interpreter(const Tables& tables, const Opcodes& opcodes,
+                         const Plan* plan)
+    : tables(tables), associated_field(*tables.btable), plan(plan),
+      plan_root(opcodes.begin)
+{
+    // Size the stacks for the usual nesting depth, to avoid reallocating
+    // them while interpreting
+    std::vector<Opcodes> stack;
+    stack.reserve(16);
+    opcode_stack = std::stack<Opcodes, std::vector<Opcodes>>(std::move(stack));
+    plan_frames.reserve(16);
     opcode_stack.push(opcodes);
 }
 
 Interpreter::~Interpreter() {}
 
+const PlanStep* Interpreter::plan_step(Varcode code) const
+{
+    if (plan_frames.empty())
+        return nullptr;
+    const PlanFrame& frame = plan_frames.back();
+    if (!frame.sequence || frame.begin[frame.pos] != code)
+        return nullptr;
+    return &frame.sequence->steps[frame.pos];
+}
+
 void Interpreter::run()
 {
     Opcodes opcodes = opcode_stack.top();
+
+    // Find the part of the plan that corresponds to opcodes
+    const PlanSequence* sequence = nullptr;
+    if (plan && plan_frames.empty())
+    {
+        if (opcodes.begin == plan_root &&
+            opcodes.size() == plan->root().ops.size())
+            sequence = &plan->root();
+    }
+    else if (plan && plan_frames.back().sequence)
+    {
+        // We are running the expansion of the opcode being interpreted
+        const PlanFrame& parent = plan_frames.back();
+        const PlanSequence* child =
+            parent.sequence->steps[parent.pos].child;
+        if (child && child->ops.size() == opcodes.size() &&
+            (child->ops.begin == opcodes.begin ||
+             std::equal(opcodes.begin, opcodes.end, child->ops.begin)))
+            sequence = child;
+    }
+
+    plan_frames.push_back(PlanFrame{sequence, opcodes.begin, 0});
+    struct PopFrame
+    {
+        std::vector<PlanFrame>& frames;
+        ~PopFrame() { frames.pop_back(); }
+    } pop_frame{plan_frames};
+
     while (!opcodes.empty())
     {
+        if (sequence)
+            plan_frames.back().pos = static_cast<unsigned>(
+                opcodes.begin - plan_frames.back().begin);
         Varcode cur = opcodes.pop_left();
         switch (WR_VAR_F(cur))
         {
@@ -70,7 +126,11 @@ void Interpreter::run()
                 c_modifier(cur, opcodes);
                 break;
             case 3: {
-                opcode_stack.push(tables.dtable->query(cur));
+                const PlanStep* step = plan_step(cur);
+                if (step && step->child)
+                    opcode_stack.push(step->child->ops);
+                else
+                    opcode_stack.push(tables.dtable->query(cur));
                 run_d_expansion(cur);
                 opcode_stack.pop();
                 break;
@@ -84,6 +144,14 @@ void Interpreter::run()
 
 Varinfo Interpreter::get_varinfo(Varcode code)
 {
+    if (const PlanStep* step = plan_step(code))
+        if (step->info && step->c_scale_change == c_scale_change &&
+            step->c_width_change == c_width_change &&
+            step->c_scale_ref_width_increase == c_scale_ref_width_increase &&
+            step->c_string_len_override == c_string_len_override &&
+            c03_refval_overrides.empty())
+            return step->info;
+
     Varinfo peek = tables.btable->query(code);
 
     if (!c_scale_change && !c_width_change && !c_string_len_override &&
@@ -475,8 +543,11 @@ void Interpreter::r_replication(Varcode code, Varcode delayed_code,
      * factor among the input variables */
     if (count == 0)
     {
-        Varinfo info = tables.btable->query(delayed_code);
-        count        = define_delayed_replication_factor(info);
+        const PlanStep* step = plan_step(code);
+        Varinfo info         = step && step->info
+                                 ? step->info
+                                 : tables.btable->query(delayed_code);
+        count                = define_delayed_replication_factor(info);
     }
     IFTRACE
     {
@@ -518,8 +589,11 @@ void Interpreter::r_bitmap(Varcode code, Varcode delayed_code,
     unsigned count = WR_VAR_Y(code);
     if (!count)
     {
-        Varinfo rep_info = tables.btable->query(delayed_code);
-        count            = define_bitmap_delayed_replication_factor(rep_info);
+        const PlanStep* step = plan_step(code);
+        Varinfo rep_info     = step && step->info
+                                 ? step->info
+                                 : tables.btable->query(delayed_code);
+        count = define_bitmap_delayed_replication_factor(rep_info);
     }
 
     define_bitmap(count);
@@ -3,6 +3,7 @@
 
 #include <memory>
 #include <stack>
+#include <vector>
 #include <wreport/bulletin/associated_fields.h>
 #include <wreport/bulletin/bitmaps.h>
 #include <wreport/opcodes.h>
@@ -14,6 +15,9 @@ struct DTable;
 struct Var;
 
 namespace bulletin {
+class Plan;
+struct PlanSequence;
+struct PlanStep;
 
 /**
  * Interpreter for data descriptor sections.
@@ -25,7 +29,7 @@ namespace bulletin {
 struct Interpreter
 {
     const Tables& tables;
-    std::stack<Opcodes> opcode_stack;
+    std::stack<Opcodes, std::vector<Opcodes>> opcode_stack;
 
     /// Bitmap iteration
     Bitmaps bitmaps;
@@ -56,13 +60,46 @@ struct Interpreter
     unsigned c03_refval_override_bits = 0;
 
 protected:
+    /// Position in a sequence of a compiled plan, while it is being run
+    struct PlanFrame
+    {
+        /// Sequence being run, or nullptr if the plan does not cover it
+        const PlanSequence* sequence;
+        /// Start of the opcodes being run
+        const Varcode* begin;
+        /// Index of the opcode being interpreted
+        unsigned pos;
+    };
+
+    /// Compiled plan for the data descriptor section, or nullptr
+    const Plan* plan = nullptr;
+    /// Start of the data descriptor section
+    const Varcode* plan_root;
+    /// Plan positions of the nested invocations of run()
+    std::vector<PlanFrame> plan_frames;
+
+    /**
+     * Return the precompiled information for the opcode being interpreted, if
+     * it is \a code and it is covered by the plan.
+     */
+    const PlanStep* plan_step(Varcode code) const;
+
     /**
      * Return a Varinfo for the given Varcode, applying all relevant C
      * modifications that are currently active.
      */
     Varinfo get_varinfo(Varcode code);
 
+    /// Create an interpreter using the given plan, which can be nullptr
+    Interpreter(const Tables& tables, const Opcodes& opcodes, const Plan* plan);
+
 public:
+    /**
+     * Create an interpreter for \a opcodes.
+     *
+     * If possible, this uses a compiled Plan to avoid looking up the same
+     * things in \a tables every time.
+     */
     Interpreter(const Tables& tables, const Opcodes& opcodes);
     virtual ~Interpreter();
 
@@ -0,0 +1,129 @@
+#include "config.h"
+#include "interpreter.h"
+#include "plan.h"
+#include "wreport/dtable.h"
+#include "wreport/tests.h"
+#include "wreport/vartable.h"
+
+using namespace wreport;
+using namespace wreport::tests;
+using namespace std;
+
+namespace {
+
+/// Record the Varinfo of all variables, with a fixed replication count
+struct InfoRecorder : public bulletin::Interpreter
+{
+    unsigned rep_count;
+    std::vector<Varinfo> infos;
+
+    InfoRecorder(const Tables& tables, const Opcodes& opcodes,
+                 unsigned rep_count, bool use_plan)
+        : bulletin::Interpreter(tables, opcodes,
+                                use_plan ? bulletin::Plan::get(tables, opcodes)
+                                         : nullptr),
+          rep_count(rep_count)
+    {
+    }
+
+    bool has_plan() const { return plan != nullptr; }
+
+    void define_variable(Varinfo info) override { infos.push_back(info); }
+    unsigned define_delayed_replication_factor(Varinfo info) override
+    {
+        infos.push_back(info);
+        return rep_count;
+    }
+};
+
+void load_tables(Tables& tables)
+{
+    auto testdatadir = path_from_env("WREPORT_TABLES", TABLE_DIR);
+    tables.btable =
+        Vartable::load_bufr(testdatadir / "B0000000000000014000.txt");
+    tables.dtable = DTable::load_bufr(testdatadir / "D0000000000000014000.txt");
+}
+
+class Tests : public TestCase
+{
+    using TestCase::TestCase;
+
+    void register_tests() override
+    {
+        add_method("compile", []() {
+            Tables tables;
+            std::vector<Varcode> datadesc{WR_VAR(3, 0, 10), WR_VAR(0, 12, 101)};
+            wassert_true(bulletin::Plan::get(tables, datadesc) == nullptr);
+
+            load_tables(tables);
+            const bulletin::Plan* plan = bulletin::Plan::get(tables, datadesc);
+            wassert_true(plan != nullptr);
+            // Plans are cached
+            wassert_true(bulletin::Plan::get(tables, datadesc) == plan);
+
+            const auto& root = plan->root();
+            wassert(actual(root.steps.size()) == 2u);
+            wassert_true(root.steps[0].info == nullptr);
+            wassert_true(root.steps[0].child != nullptr);
+            wassert(actual(root.steps[0].child->steps.size()) == 4u);
+            wassert_true(root.steps[1].info ==
+                         tables.btable->query(WR_VAR(0, 12, 101)));
+            wassert_true(root.steps[1].child == nullptr);
+
+            // Data descriptor sections that cannot be compiled have no plan
+            std::vector<Varcode> invalid{WR_VAR(3, 63, 255)};
+            wassert_true(bulletin::Plan::get(tables, invalid) == nullptr);
+        });
+
+        add_method("run", []() {
+            // Interpreting with a plan gives the same results as without
+            Tables tables;
+            load_tables(tables);
+            std::vector<Varcode> datadesc{WR_VAR(3, 0, 10), WR_VAR(0, 12, 101)};
+            for (unsigned count : {0u, 1u, 3u})
+            {
+                WREPORT_TEST_INFO(info);
+                info() << count << " repetitions";
+                InfoRecorder planned(tables, datadesc, count, true);
+                wassert_true(planned.has_plan());
+                planned.run();
+                InfoRecorder unplanned(tables, datadesc, count, false);
+                unplanned.run();
+                // 3 variables from D03003, the replication factor, the
+                // replicated B00030, and B12101
+                wassert(actual(planned.infos.size()) == 5 + count);
+                wassert_true(planned.infos == unplanned.infos);
+            }
+        });
+
+        add_method("modifiers", []() {
+            // A replicated group changes the data width: the Varinfo in the
+            // plan can only be used if the group is repeated
+            Tables tables;
+            load_tables(tables);
+            std::vector<Varcode> datadesc{WR_VAR(1, 1, 0), WR_VAR(0, 31, 1),
+                                          WR_VAR(2, 1, 130),
+                                          WR_VAR(0, 12, 101)};
+            Varinfo orig = tables.btable->query(WR_VAR(0, 12, 101));
+            for (unsigned count : {0u, 1u, 2u})
+            {
+                WREPORT_TEST_INFO(info);
+                info() << count << " repetitions";
+                InfoRecorder planned(tables, datadesc, count, true);
+                wassert_true(planned.has_plan());
+                planned.run();
+                InfoRecorder unplanned(tables, datadesc, count, false);
+                unplanned.run();
+                wassert(actual(planned.infos.size()) == 2u);
+                wassert_true(planned.infos == unplanned.infos);
+                if (count)
+                    wassert(actual(planned.infos[1]->bit_len) ==
+                            orig->bit_len + 2);
+                else
+                    wassert_true(planned.infos[1] == orig);
+            }
+        });
+    }
+} test("bulletin_plan");
+
+} // namespace
@@ -0,0 +1,248 @@
+#include "plan.h"
+#include "interpreter.h"
+#include "wreport/dtable.h"
+#include "wreport/error.h"
+#include "wreport/vartable.h"
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <shared_mutex>
+
+namespace wreport {
+namespace bulletin {
+
+/**
+ * Interpreter that goes through each opcode once, recording what it resolves
+ * to in a Plan.
+ *
+ * It uses the Interpreter implementation of C modifiers, so that the Varinfo
+ * it computes are the same that Interpreter would compute.
+ */
+struct Plan::Compiler : public Interpreter
+{
+    Plan& plan;
+
+    Compiler(const Tables& tables, Plan& plan)
+        : Interpreter(tables, plan.datadesc, nullptr), plan(plan)
+    {
+    }
+
+    /// Add a new sequence to the plan, and compile it
+    const PlanSequence* compile_child(const Opcodes& ops)
+    {
+        PlanSequence& res = plan.sequences.emplace_back(ops);
+        compile(res);
+        return &res;
+    }
+
+    /// Compute the Varinfo for a B opcode, with the current C modifiers
+    void compile_b(Varcode code, PlanStep& step)
+    {
+        step.info                       = get_varinfo(code);
+        step.c_scale_change             = c_scale_change;
+        step.c_width_change             = c_width_change;
+        step.c_scale_ref_width_increase = c_scale_ref_width_increase;
+        step.c_string_len_override      = c_string_len_override;
+    }
+
+    /// Fill in the steps of \a seq, mirroring what Interpreter::run() does
+    void compile(PlanSequence& seq)
+    {
+        Opcodes opcodes = seq.ops;
+        while (!opcodes.empty())
+        {
+            PlanStep& step = seq.steps[opcodes.begin - seq.ops.begin];
+            Varcode cur    = opcodes.pop_left();
+            switch (WR_VAR_F(cur))
+            {
+                case 0:
+                    // While C03 is active, B opcodes define reference values
+                    // instead of variables
+                    if (!c03_refval_override_bits)
+                        compile_b(cur, step);
+                    break;
+                case 1: {
+                    Varcode delayed_replication_code = 0;
+                    if (WR_VAR_Y(cur) == 0 && !opcodes.empty())
+                    {
+                        Varcode next_code = opcodes[0];
+                        if (WR_VAR_F(next_code) == 0 &&
+                            WR_VAR_X(next_code) == 31)
+                            delayed_replication_code = opcodes.pop_left();
+                    }
+                    if (WR_VAR_Y(cur) == 0 && !delayed_replication_code)
+                        delayed_replication_code = WR_VAR(0, 31, 12);
+                    if (delayed_replication_code)
+                        step.info =
+                            tables.btable->query(delayed_replication_code);
+                    // Compile the group as if it were repeated once
+                    step.child = compile_child(opcodes.pop_left(WR_VAR_X(cur)));
+                    break;
+                }
+                case 2: c_modifier(cur, opcodes); break;
+                case 3:
+                    step.child = compile_child(tables.dtable->query(cur));
+                    break;
+                default:
+                    error_consistency::throwf(
+                        "cannot handle opcode %01d%02d%03d", WR_VAR_FXY(cur));
+            }
+        }
+    }
+
+    void c_modifier(Varcode code, Opcodes& next) override
+    {
+        switch (WR_VAR_X(code))
+        {
+            case 1:
+            case 2:
+            case 3:
+            case 4:
+            case 5:
+            case 6:
+            case 7:
+            case 8: Interpreter::c_modifier(code, next); break;
+            // Other modifiers, like bitmaps, do not change how variables
+            // are decoded
+            default: break;
+        }
+    }
+
+    unsigned define_associated_field_significance(Varinfo info) override
+    {
+        return 63;
+    }
+    void define_variable(Varinfo info) override {}
+    void define_variable_with_associated_field(Varinfo info) override {}
+    void define_raw_character_data(Varcode code) override {}
+};
+
+Plan::Plan(const Tables& tables, const Opcodes& opcodes)
+    : datadesc(opcodes.begin, opcodes.end)
+{
+    PlanSequence& root = sequences.emplace_back(Opcodes(datadesc));
+    Compiler compiler(tables, *this);
+    compiler.compile(root);
+}
+
+namespace {
+
+/// Tables and data descriptor section used to look up a plan
+struct PlanKey
+{
+    const Vartable* btable;
+    const DTable* dtable;
+    Opcodes opcodes;
+};
+
+/// Cache of compiled plans
+struct PlanCache
+{
+    /// Owned copy of the data descriptor section of a PlanKey
+    struct Key
+    {
+        const Vartable* btable;
+        const DTable* dtable;
+        std::vector<Varcode> datadesc;
+    };
+
+    struct Compare
+    {
+        typedef void is_transparent;
+
+        static bool less(const Vartable* b1, const DTable* d1,
+                         const Varcode* begin1, const Varcode* end1,
+                         const Vartable* b2, const DTable* d2,
+                         const Varcode* begin2, const Varcode* end2)
+        {
+            if (b1 != b2)
+                return std::less<const Vartable*>()(b1, b2);
+            if (d1 != d2)
+                return std::less<const DTable*>()(d1, d2);
+            return std::lexicographical_compare(begin1, end1, begin2, end2);
+        }
+
+        bool operator()(const Key& a, const Key& b) const
+        {
+            return less(a.btable, a.dtable, a.datadesc.data(),
+                        a.datadesc.data() + a.datadesc.size(), b.btable,
+                        b.dtable, b.datadesc.data(),
+                        b.datadesc.data() + b.datadesc.size());
+        }
+        bool operator()(const Key& a, const PlanKey& b) const
+        {
+            return less(a.btable, a.dtable, a.datadesc.data(),
+                        a.datadesc.data() + a.datadesc.size(), b.btable,
+                        b.dtable, b.opcodes.begin, b.opcodes.end);
+        }
+        bool operator()(const PlanKey& a, const Key& b) const
+        {
+            return less(a.btable, a.dtable, a.opcodes.begin, a.opcodes.end,
+                        b.btable, b.dtable, b.datadesc.data(),
+                        b.datadesc.data() + b.datadesc.size());
+        }
+    };
+
+    /**
+     * Maximum number of plans to cache.
+     *
+     * Input usually uses a limited number of templates: this is a safeguard
+     * against unbounded memory use with very varied input.
+     */
+    static const size_t max_size = 1024;
+
+    /**
+     * Lookups happen every time an Interpreter is created, possibly from
+     * several decoding threads, and only take a shared lock.
+     */
+    std::shared_mutex mutex;
+    std::map<Key, std::unique_ptr<Plan>, Compare> plans;
+};
+
+} // namespace
+
+const Plan* Plan::get(const Tables& tables, const Opcodes& opcodes)
+{
+    if (!tables.loaded())
+        return nullptr;
+
+    // Like the tables it refers to, the cache is never deallocated
+    static auto* cache = new PlanCache;
+
+    PlanKey key{tables.btable, tables.dtable, opcodes};
+    {
+        std::shared_lock<std::shared_mutex> lock(cache->mutex);
+        auto i = cache->plans.find(key);
+        if (i != cache->plans.end())
+            return i->second.get();
+    }
+
+    std::unique_lock<std::shared_mutex> lock(cache->mutex);
+    // Another thread may have compiled the plan while we were not locked
+    auto i = cache->plans.find(key);
+    if (i != cache->plans.end())
+        return i->second.get();
+
+    if (cache->plans.size() >= PlanCache::max_size)
+        return nullptr;
+
+    std::unique_ptr<Plan> plan;
+    try
+    {
+        plan.reset(new Plan(tables, opcodes));
+    }
+    catch (wreport::error&)
+    {
+        // Leave it to the interpreter to report the error when it gets to it,
+        // and remember not to try compiling this again
+    }
+    const Plan* res = plan.get();
+    cache->plans.emplace(
+        PlanCache::Key{tables.btable, tables.dtable,
+                       std::vector<Varcode>(opcodes.begin, opcodes.end)},
+        std::move(plan));
+    return res;
+}
+
+} // namespace bulletin
+} // namespace wreport
@@ -0,0 +1,102 @@
+#ifndef WREPORT_BULLETIN_PLAN_H
+#define WREPORT_BULLETIN_PLAN_H
+
+#include <deque>
+#include <vector>
+#include <wreport/opcodes.h>
+#include <wreport/tables.h>
+#include <wreport/varinfo.h>
+
+namespace wreport {
+namespace bulletin {
+
+struct PlanSequence;
+
+/// Information precomputed for an opcode in a PlanSequence
+struct PlanStep
+{
+    /**
+     * Varinfo of a B opcode, or of the delayed replication factor of an R
+     * opcode. It is nullptr if it cannot be precomputed.
+     */
+    Varinfo info                   = nullptr;
+    /// Sequence that a D or R opcode expands to, or nullptr
+    const PlanSequence* child      = nullptr;
+    /// Scale change that was active when info was computed
+    int c_scale_change             = 0;
+    /// Width change that was active when info was computed
+    int c_width_change             = 0;
+    /// Scale, reference value and width increase active when info was computed
+    int c_scale_ref_width_increase = 0;
+    /// String length override that was active when info was computed
+    int c_string_len_override      = 0;
+};
+
+/// Sequence of opcodes, with precomputed information for each of them
+struct PlanSequence
+{
+    /// Opcodes in this sequence
+    Opcodes ops;
+    /// Precomputed information for each opcode in ops
+    std::vector<PlanStep> steps;
+
+    explicit PlanSequence(const Opcodes& ops) : ops(ops), steps(ops.size()) {}
+};
+
+/**
+ * Data descriptor section compiled for faster interpretation.
+ *
+ * A plan mirrors the tree of opcode sequences that Interpreter::run() goes
+ * through: the data descriptor section, the expansion of each D opcode and
+ * each replicated group. For each opcode it stores the Varinfo resolved with
+ * the C modifiers active at that point, and the sequence it expands to, so
+ * that interpreting a message does not need to look anything up in the B and
+ * D tables.
+ *
+ * Replicated groups are compiled as if they were repeated once: when the
+ * data makes the C modifiers differ from those used to compile the plan, as
+ * when a group that changes them is repeated zero times, the Varinfo is
+ * computed again as usual.
+ */
+class Plan
+{
+protected:
+    struct Compiler;
+
+    /// Copy of the data descriptor section
+    std::vector<Varcode> datadesc;
+    /// All the sequences in the plan, the first one is datadesc
+    std::deque<PlanSequence> sequences;
+
+public:
+    /**
+     * Compile a plan for the given data descriptor section.
+     *
+     * Raises an exception if the data descriptor section cannot be
+     * interpreted with \a tables.
+     */
+    Plan(const Tables& tables, const Opcodes& opcodes);
+    Plan(const Plan&)            = delete;
+    Plan& operator=(const Plan&) = delete;
+
+    /// Sequence corresponding to the whole data descriptor section
+    const PlanSequence& root() const { return sequences.front(); }
+
+    /**
+     * Return the plan for the given tables and data descriptor section,
+     * compiling it if needed.
+     *
+     * Plans are cached, and can be used concurrently by multiple threads.
+     * Since they refer to table entries, this only works for tables that
+     * are never deallocated, as those returned by Vartable::load_bufr() and
+     * DTable::load_bufr(). It returns nullptr if the tables are not loaded,
+     * if the data descriptor section cannot be compiled, or if the cache is
+     * full.
+     */
+    static const Plan* get(const Tables& tables, const Opcodes& opcodes);
+};
+
+} // namespace bulletin
+} // namespace wreport
+
+#endif
@@ -0,0 +1,154 @@
+#include "bufr/decoder.h"
+#include "buffers/bufr.h"
+#include "bulletin.h"
+#include "columns.h"
+#include "internals/varinfo.h"
+#include "options.h"
+#include "tests.h"
+#include "vartable.h"
+
+using namespace wreport;
+using namespace wreport::tests;
+using namespace std;
+
+namespace {
+
+class Tests : public TestCase
+{
+    using TestCase::TestCase;
+
+    void register_tests() override
+    {
+        add_method("column", []() {
+            auto table = Vartable::get_bufr("B0000000000000014000");
+            Column col(table->query(WR_VAR(0, 12, 101)));
+            col.resize(3);
+            wassert(actual(col.size()) == 3u);
+            wassert(actual(col.doubles.size()) == 3u);
+            wassert_true(col.ints.empty());
+            wassert_true(col.is_missing(0));
+
+            col.set(1, Var(col.info, 273.15));
+            wassert_false(col.is_missing(1));
+            wassert(actual(col.doubles[1]) == 273.15);
+            wassert(actual(col.var(1).enqd()) == 273.15);
+            wassert_false(col.var(0).isset());
+
+            Column& attr =
+                col.obtain_attribute(table->query(WR_VAR(0, 33, 7)), 3);
+            wassert(actual(attr.size()) == 3u);
+            wassert(actual(attr.ints.size()) == 3u);
+            attr.set_all(Var(attr.info, 50));
+            wassert(actual(attr.ints[2]) == 50);
+            wassert_true(col.attribute(WR_VAR(0, 33, 7)) == &attr);
+            wassert_true(col.attribute(WR_VAR(0, 33, 8)) == nullptr);
+        });
+
+        add_method("decode", []() {
+            // Columnar decoding gives the same values as decoding into
+            // subsets
+            unsigned tested = 0;
+            for (const auto& fname : all_test_files("bufr"))
+            {
+                std::string raw = slurpfile(fname);
+                std::unique_ptr<BufrBulletin> msg;
+                try
+                {
+                    msg = BufrBulletin::decode(raw, fname.c_str());
+                }
+                catch (std::exception&)
+                {
+                    continue;
+                }
+                if (!msg->compression)
+                    continue;
+
+                WREPORT_TEST_INFO(info);
+                info() << fname;
+
+                ColumnarData data;
+                auto head = wcallchecked(
+                    BufrBulletin::decode_columns(raw, data, fname.c_str()));
+                wassert_true(head->subsets.empty());
+                wassert(actual(head->datadesc.size()) ==
+                        msg->datadesc.size());
+                wassert(actual(data.subset_count) == msg->subsets.size());
+                wassert(actual(data.columns.size()) ==
+                        msg->subsets[0].size());
+
+                for (unsigned c = 0; c < data.columns.size(); ++c)
+                {
+                    const Column& column = data.columns[c];
+                    wassert(actual(column.size()) == data.subset_count);
+                    for (unsigned s = 0; s < data.subset_count; ++s)
+                    {
+                        const Var& var = msg->subsets[s][c];
+                        wassert(actual_varcode(column.info->code) ==
+                                var.code());
+                        wassert_true(column.var(s).value_equals(var));
+                        for (const Var* a = var.next_attr(); a;
+                             a = a->next_attr())
+                        {
+                            const Column* attr = column.attribute(a->code());
+                            wassert_true(attr != nullptr);
+                            wassert_true(attr->var(s).value_equals(*a));
+                        }
+                        for (const auto& attr : column.attributes)
+                            if (!var.enqa(attr.info->code))
+                                wassert_true(attr.is_missing(s));
+                    }
+                }
+                ++tested;
+            }
+            wassert(actual(tested) > 0u);
+        });
+
+        add_method("domain_errors", []() {
+            // Compressed values outside the range of the variable are handled
+            // as when decoding into subsets, and missing values are skipped
+            _Varinfo info;
+            varinfo::set_bufr(info, WR_VAR(0, 1, 1), "WMO BLOCK NUMBER",
+                              "NUMERIC", 7);
+            // Base value, 4 difference bits, and differences giving a value
+            // at the top of the range, a missing value, and a value out of
+            // range
+            std::string buf;
+            buffers::BufrOutput out(buf);
+            out.add_bits(120, 7);
+            out.add_bits(4, 6);
+            for (unsigned diff : {0, 6, 15, 9})
+                out.add_bits(diff, 4);
+            out.flush();
+
+            auto decode = [&](ColumnarData& data) {
+                data.subset_count = 4;
+                bufr::Input in(buf);
+                bufr::ColumnarDecoderTarget target(in, data);
+                target.decode_and_add_b_value(&info);
+            };
+
+            ColumnarData data;
+            wassert_throws(error_domain, decode(data));
+
+            options::LocalOverride silent(options::var_silent_domain_errors,
+                                          true);
+            data.clear();
+            decode(data);
+            const Column& column = data.columns[0];
+            wassert(actual(column.ints[0]) == 120);
+            wassert(actual(column.ints[1]) == 126);
+            wassert_true(column.is_missing(2));
+            wassert_true(column.is_missing(3));
+        });
+
+        add_method("uncompressed", []() {
+            // Only compressed messages can be decoded by columns
+            std::string raw = slurpfile("bufr/obs0-1.22.bufr");
+            ColumnarData data;
+            wassert_throws(error_unimplemented,
+                           BufrBulletin::decode_columns(raw, data));
+        });
+    }
+} test("columns");
+
+} // namespace
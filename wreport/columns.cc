@@ -0,0 +1,78 @@
+#include "columns.h"
+
+namespace wreport {
+
+const Column* Column::attribute(Varcode code) const
+{
+    for (const auto& a : attributes)
+        if (a.info->code == code)
+            return &a;
+    return nullptr;
+}
+
+Column& Column::obtain_attribute(Varinfo info, unsigned size)
+{
+    for (auto& a : attributes)
+        if (a.info->code == info->code)
+            return a;
+    attributes.emplace_back(info);
+    attributes.back().resize(size);
+    return attributes.back();
+}
+
+void Column::resize(unsigned size)
+{
+    missing.resize(size, 1);
+    switch (info->type)
+    {
+        case Vartype::Integer: ints.resize(size); break;
+        case Vartype::Decimal: doubles.resize(size); break;
+        case Vartype::String:
+        case Vartype::Binary:  strings.resize(size); break;
+    }
+}
+
+void Column::set(unsigned subset, const Var& var)
+{
+    if (!var.isset())
+    {
+        missing[subset] = 1;
+        return;
+    }
+    missing[subset] = 0;
+    switch (info->type)
+    {
+        case Vartype::Integer: ints[subset] = var.enqi(); break;
+        case Vartype::Decimal: doubles[subset] = var.enqd(); break;
+        case Vartype::String:
+        case Vartype::Binary:  strings[subset] = var.enqs(); break;
+    }
+}
+
+void Column::set_all(const Var& var)
+{
+    for (unsigned i = 0; i < size(); ++i)
+        set(i, var);
+}
+
+Var Column::var(unsigned subset) const
+{
+    if (missing[subset])
+        return Var(info);
+    switch (info->type)
+    {
+        case Vartype::Integer: return Var(info, (int)ints[subset]);
+        case Vartype::Decimal: return Var(info, doubles[subset]);
+        case Vartype::String:
+        case Vartype::Binary:  return Var(info, strings[subset]);
+    }
+    return Var(info);
+}
+
+void ColumnarData::clear()
+{
+    subset_count = 0;
+    columns.clear();
+}
+
+} // namespace wreport
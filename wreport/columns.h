@@ -0,0 +1,101 @@
+#ifndef WREPORT_COLUMNS_H
+#define WREPORT_COLUMNS_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <wreport/var.h>
+
+namespace wreport {
+
+/**
+ * Values of one variable of a compressed data section, across all subsets.
+ *
+ * Values are stored in one array, according to the type of info: ints for
+ * Vartype::Integer, doubles for Vartype::Decimal, and strings for
+ * Vartype::String and Vartype::Binary. The other arrays are empty.
+ */
+struct Column
+{
+    /// Description of the values in the column
+    Varinfo info = nullptr;
+
+    /// Values of integer variables, one per subset
+    std::vector<int32_t> ints;
+
+    /// Values of decimal variables, one per subset
+    std::vector<double> doubles;
+
+    /// Values of string and binary variables, one per subset
+    std::vector<std::string> strings;
+
+    /**
+     * Missing value flags, one per subset: nonzero if the value is missing.
+     *
+     * The value in the value array for a missing value is undefined.
+     */
+    std::vector<uint8_t> missing;
+
+    /**
+     * Attributes of the variable, as columns of the same size.
+     *
+     * Subsets where the variable has no attribute have a missing value in the
+     * attribute column.
+     */
+    std::vector<Column> attributes;
+
+    Column() = default;
+    explicit Column(Varinfo info) : info(info) {}
+
+    /// Number of values in the column
+    unsigned size() const { return missing.size(); }
+
+    /// Check if the value for the given subset is missing
+    bool is_missing(unsigned subset) const { return missing[subset]; }
+
+    /// Return the attribute column with the given code, or nullptr if missing
+    const Column* attribute(Varcode code) const;
+
+    /// Return the attribute column with the given info, creating it if needed
+    Column& obtain_attribute(Varinfo info, unsigned size);
+
+    /// Resize the column to \a size missing values
+    void resize(unsigned size);
+
+    /// Set the value for \a subset from a variable
+    void set(unsigned subset, const Var& var);
+
+    /// Set the value of all subsets from a variable
+    void set_all(const Var& var);
+
+    /**
+     * Build a variable with the value for \a subset, without attributes.
+     *
+     * This is useful to format or convert single values, but it defeats the
+     * purpose of a columnar decoding if done for all the values.
+     */
+    Var var(unsigned subset) const;
+};
+
+/**
+ * Data section of a compressed BUFR message decoded by columns.
+ *
+ * In a compressed message all subsets have the same structure: here each
+ * variable in the structure has one Column with its values for all subsets,
+ * instead of one Var per subset as in a Bulletin.
+ */
+struct ColumnarData
+{
+    /// Number of subsets
+    unsigned subset_count = 0;
+
+    /// Decoded variables, in data section order
+    std::vector<Column> columns;
+
+    /// Remove all the contents
+    void clear();
+};
+
+} // namespace wreport
+
+#endif
@@ -25,9 +25,9 @@ struct ConvBenchmark : Benchmark
         repetitions = 500;
     }
 
-    void setup_main() { Benchmark::setup_main(); }
+    void setup_main() override { Benchmark::setup_main(); }
 
-    void teardown_main() { Benchmark::teardown_main(); }
+    void teardown_main() override { Benchmark::teardown_main(); }
 
     void main() override
     {
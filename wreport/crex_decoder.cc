@@ -2,6 +2,7 @@
 #include "bulletin.h"
 #include "bulletin/interpreter.h"
 #include "config.h"
+#include <cctype>
 #include <cstring>
 
 // #define TRACE_DECODER
@@ -23,6 +24,23 @@ namespace wreport {
 namespace bulletin {
 namespace {
 
+/**
+ * Parse a decimal integer between \a begin and \a end, like strtol but
+ * without reading past \a end, since the input is not null terminated
+ */
+int parse_int(const char* begin, const char* end)
+{
+    while (begin < end && isspace(*begin))
+        ++begin;
+    bool negative = false;
+    if (begin < end && (*begin == '-' || *begin == '+'))
+        negative = *begin++ == '-';
+    long res = 0;
+    for (; begin < end && isdigit(*begin); ++begin)
+        res = res * 10 + (*begin - '0');
+    return static_cast<int>(negative ? -res : res);
+}
+
 void decode_header(buffers::CrexInput& in, CrexBulletin& out)
 {
     /* Read crex section 0 (Indicator section) */
@@ -87,11 +105,11 @@ void decode_header(buffers::CrexInput& in, CrexBulletin& out)
     }
 
     /* data descriptors followed by (E?)\+\+ */
-    in.check_eof("data descriptor section");
-
     out.has_check_digit = false;
     while (1)
     {
+        // The input is not null terminated: check before each read
+        in.check_eof("data descriptor section");
         if (*in.cur == 'B' || *in.cur == 'R' || *in.cur == 'C' ||
             *in.cur == 'D')
         {
@@ -108,13 +126,17 @@ void decode_header(buffers::CrexInput& in, CrexBulletin& out)
         }
         else if (*in.cur == '+')
         {
-            in.check_available_data(1, "end of data descriptor section");
+            in.check_available_data(2, "end of data descriptor section");
             if (*(in.cur + 1) != '+')
                 in.parse_error(
                     "data descriptor section ends with only one '+'");
             in.skip_data_and_spaces(2);
             break;
         }
+        else
+            in.parse_error("unexpected character '%c' in data descriptor "
+                           "section",
+                           *in.cur);
     }
     IFTRACE
     {
@@ -164,7 +186,7 @@ struct CrexParser : public bulletin::Interpreter
             }
             else
             {
-                int val = static_cast<int>(strtol(d_start, 0, 10));
+                int val = parse_int(d_start, d_end);
                 var.seti(val);
                 res = val;
             }
@@ -224,8 +246,12 @@ void decode_data(buffers::CrexInput& in, CrexBulletin& out)
                             "CREX optional section 3 or end of CREX message");
     if (strncmp(in.cur, "SUPP", 4) == 0)
     {
-        for (in.cur += 4; strncmp(in.cur, "++", 2) != 0; ++in.cur)
+        for (in.cur += 4;; ++in.cur)
+        {
             in.check_available_data(2, "end of CREX optional section 3");
+            if (memcmp(in.cur, "++", 2) == 0)
+                break;
+        }
         in.skip_spaces();
     }
 
@@ -243,22 +269,41 @@ void decode_data(buffers::CrexInput& in, CrexBulletin& out)
 std::unique_ptr<CrexBulletin>
 CrexBulletin::decode_header(const std::string& buf, const char* fname,
                             size_t offset)
+{
+    return decode_header(reinterpret_cast<const uint8_t*>(buf.data()),
+                         buf.size(), fname, offset);
+}
+
+std::unique_ptr<CrexBulletin>
+CrexBulletin::decode_header(const uint8_t* data, size_t size,
+                            const char* fname, size_t offset)
 {
     auto res    = CrexBulletin::create();
     res->fname  = fname;
     res->offset = offset;
-    buffers::CrexInput in(buf, fname, offset);
+    buffers::CrexInput in(reinterpret_cast<const char*>(data), size, fname,
+                          offset);
     bulletin::decode_header(in, *res);
     return res;
 }
 
 std::unique_ptr<CrexBulletin>
 CrexBulletin::decode(const std::string& buf, const char* fname, size_t offset)
+{
+    return decode(reinterpret_cast<const uint8_t*>(buf.data()), buf.size(),
+                  fname, offset);
+}
+
+std::unique_ptr<CrexBulletin> CrexBulletin::decode(const uint8_t* data,
+                                                   size_t size,
+                                                   const char* fname,
+                                                   size_t offset)
 {
     auto res    = CrexBulletin::create();
     res->fname  = fname;
     res->offset = offset;
-    buffers::CrexInput in(buf, fname, offset);
+    buffers::CrexInput in(reinterpret_cast<const char*>(data), size, fname,
+                          offset);
     bulletin::decode_header(in, *res);
     bulletin::decode_data(in, *res);
     return res;
@@ -268,13 +313,15 @@ std::unique_ptr<CrexBulletin>
 CrexBulletin::decode_verbose(const std::string& buf, FILE* out,
                              const char* fname, size_t offset)
 {
-    auto res    = CrexBulletin::create();
-    res->fname  = fname;
-    res->offset = offset;
-    buffers::CrexInput in(buf, fname, offset);
-    bulletin::decode_header(in, *res);
-    bulletin::decode_data(in, *res);
-    return res;
+    return decode_verbose(reinterpret_cast<const uint8_t*>(buf.data()),
+                          buf.size(), out, fname, offset);
+}
+
+std::unique_ptr<CrexBulletin>
+CrexBulletin::decode_verbose(const uint8_t* data, size_t size, FILE* out,
+                             const char* fname, size_t offset)
+{
+    return decode(data, size, fname, offset);
 }
 
 } // namespace wreport
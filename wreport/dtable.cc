@@ -1,11 +1,14 @@
 #include "dtable.h"
 #include "config.h"
 #include "error.h"
+#include "internals/snapshot_cache.h"
+#include "internals/tablecache.h"
 #include "internals/tabledir.h"
+#include "internals/varcode_index.h"
+#include <cstddef>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
-#include <map>
 
 using namespace std;
 
@@ -23,6 +26,8 @@ struct Entry
 {
     /// Varcode to be expanded
     Varcode code;
+    /// Unused, zeroed so that compiled tables have no uninitialized bytes
+    uint16_t pad = 0;
     /// Position in the main table where the expansion begins
     unsigned begin;
     /// Position in the main table one past where the expansion ends
@@ -34,6 +39,20 @@ struct Entry
     }
 };
 
+/// Layout of the records stored in compiled D tables
+constexpr uint64_t compiled_layout = tablecache::layout_fingerprint({
+    sizeof(Entry),
+    offsetof(Entry, code),
+    sizeof(Entry::code),
+    offsetof(Entry, pad),
+    sizeof(Entry::pad),
+    offsetof(Entry, begin),
+    sizeof(Entry::begin),
+    offsetof(Entry, end),
+    sizeof(Entry::end),
+    sizeof(Varcode),
+});
+
 struct fd_closer
 {
     FILE* fd;
@@ -47,17 +66,54 @@ struct DTableBase : public DTable
 
     /**
      * One single table with the concatenation of all the expansion
-     * varcodes
+     * varcodes, as parsed from the text version of the table
      */
     std::vector<Varcode> varcodes;
 
     /**
-     * Expansion entries with pointers inside \a varcodes
+     * Expansion entries with pointers inside \a varcodes, as parsed from the
+     * text version of the table
      */
     std::vector<Entry> entries;
 
-    DTableBase(const std::string& pathname) : m_pathname(pathname)
+    /// Compiled version of the table, when it is used instead of the text one
+    tablecache::Compiled m_compiled;
+
+    /// Expansion entries in use, parsed or memory mapped
+    const Entry* m_entries = nullptr;
+
+    /// Expansion varcodes in use, parsed or memory mapped
+    const Varcode* m_varcodes = nullptr;
+
+    /// Position of each entry in \a m_entries, indexed by varcode
+    VarcodeIndex index;
+
+    /**
+     * Load a D table.
+     *
+     * If \a use_compiled is true, use the compiled version of the table if it
+     * is available and up to date.
+     */
+    explicit DTableBase(const std::string& pathname, bool use_compiled = true)
+        : m_pathname(pathname)
     {
+        const uint32_t record_sizes[tablecache::section_count] = {
+            sizeof(Entry), sizeof(Varcode)};
+        if (use_compiled &&
+            m_compiled.open(m_pathname, tablecache::Kind::D, record_sizes,
+                            compiled_layout))
+        {
+            if (valid_compiled())
+            {
+                set_contents(m_compiled.records<Entry>(0), m_compiled.count(0),
+                             m_compiled.records<Varcode>(1));
+                return;
+            }
+            // Expansions would point outside the mapped varcodes: parse the
+            // text version instead
+            m_compiled.close();
+        }
+
         FILE* in = fopen(pathname.c_str(), "rt");
         if (in == NULL)
             error_system::throwf("opening D table file %s", pathname.c_str());
@@ -97,8 +153,7 @@ struct DTableBase : public DTable
                         "less than one entry advertised in the expansion");
 
                 if (!varcodes.empty())
-                    entries.push_back(Entry(
-                        dcode, begin, static_cast<unsigned>(varcodes.size())));
+                    add_entry(dcode, begin);
                 begin = static_cast<unsigned>(varcodes.size());
                 dcode = varcode_parse(line + 1);
 
@@ -137,8 +192,7 @@ struct DTableBase : public DTable
             throw error_parse(pathname.c_str(), line_no,
                               "no entries found in the file");
         else
-            entries.push_back(
-                Entry(dcode, begin, static_cast<unsigned>(varcodes.size())));
+            add_entry(dcode, begin);
 
         // Check that the last entry is complete
         unsigned last_count = static_cast<unsigned>(varcodes.size()) - begin;
@@ -147,36 +201,57 @@ struct DTableBase : public DTable
                                 "advertised number of expansion items (%u) "
                                 "does not match the number of items found (%u)",
                                 nentries_check, last_count);
+
+        set_contents(entries.data(), static_cast<unsigned>(entries.size()),
+                     varcodes.data());
     }
 
     ~DTableBase() {}
 
+    /// Check that all expansions of the compiled table are inside its varcodes
+    bool valid_compiled() const
+    {
+        const Entry* entries = m_compiled.records<Entry>(0);
+        unsigned count       = m_compiled.count(0);
+        unsigned size        = m_compiled.count(1);
+        for (unsigned i = 0; i < count; ++i)
+            if (entries[i].begin > entries[i].end || entries[i].end > size)
+                return false;
+        return true;
+    }
+
+    /// Append the entry for \a code, expanding to varcodes from \a begin on
+    void add_entry(Varcode code, unsigned begin)
+    {
+        entries.push_back(
+            Entry(code, begin, static_cast<unsigned>(varcodes.size())));
+    }
+
+    /// Use \a count entries starting at \a entries as the table contents
+    void set_contents(const Entry* entries, unsigned count,
+                      const Varcode* varcodes)
+    {
+        m_entries  = entries;
+        m_varcodes = varcodes;
+        for (unsigned i = 0; i < count; ++i)
+            index.add(entries[i].code, i);
+    }
+
     std::string pathname() const override { return m_pathname; }
 
     std::filesystem::path path() const override { return m_pathname; }
 
     Opcodes query(Varcode var) const override
     {
-        int begin, end;
-
-        // Binary search the entry
-        begin = -1, end = static_cast<int>(entries.size());
-        while (end - begin > 1)
-        {
-            int cur = (end + begin) / 2;
-            if (entries[cur].code > var)
-                end = cur;
-            else
-                begin = cur;
-        }
-        if (begin == -1 || entries[begin].code != var)
+        unsigned pos = index.find(var);
+        if (pos == VarcodeIndex::missing)
             error_notfound::throwf(
                 "missing D table expansion for variable %d%02d%03d in file %s",
                 WR_VAR_F(var), WR_VAR_X(var), WR_VAR_Y(var),
                 m_pathname.c_str());
         else
-            return Opcodes(varcodes.data() + entries[begin].begin,
-                           varcodes.data() + entries[begin].end);
+            return Opcodes(m_varcodes + m_entries[pos].begin,
+                           m_varcodes + m_entries[pos].end);
     }
 };
 
@@ -184,32 +259,33 @@ struct DTableBase : public DTable
 
 const DTable* DTable::load_bufr(const std::string& pathname)
 {
-    static std::map<string, DTable*>* tables = 0;
-    if (!tables)
-        tables = new std::map<string, DTable*>;
+    // Allocated and never freed, as tables are used until program exit
+    static auto* tables = new SnapshotCache<string, const DTable*>;
 
-    // Return it from cache if we have it
-    auto i = tables->find(pathname);
-    if (i != tables->end())
-        return i->second;
-
-    // Else, instantiate it
-    return (*tables)[pathname] = new DTableBase(pathname);
+    return tables->get(pathname, [&] { return new DTableBase(pathname); });
 }
 
 const DTable* DTable::load_crex(const std::string& pathname)
 {
-    static std::map<string, DTable*>* tables = 0;
-    if (!tables)
-        tables = new std::map<string, DTable*>;
+    // Allocated and never freed, as tables are used until program exit
+    static auto* tables = new SnapshotCache<string, const DTable*>;
+
+    return tables->get(pathname, [&] { return new DTableBase(pathname); });
+}
+
+void DTable::compile(const std::filesystem::path& pathname)
+{
+    tablecache::Writer writer(pathname, tablecache::Kind::D, compiled_layout);
 
-    // Return it from cache if we have it
-    auto i = tables->find(pathname);
-    if (i != tables->end())
-        return i->second;
+    DTableBase table(pathname, false);
+    writer.add_section(0, table.entries.data(),
+                       static_cast<uint32_t>(table.entries.size()),
+                       sizeof(Entry));
+    writer.add_section(1, table.varcodes.data(),
+                       static_cast<uint32_t>(table.varcodes.size()),
+                       sizeof(Varcode));
 
-    // Else, instantiate it
-    return (*tables)[pathname] = new DTableBase(pathname);
+    writer.write();
 }
 
 } // namespace wreport
@@ -49,6 +49,15 @@ public:
      * further calls to load_crex() will return the cached version.
      */
     static const DTable* load_crex(const std::string& pathname);
+
+    /**
+     * Write a compiled version of the D table at \a pathname.
+     *
+     * load_bufr() and load_crex() memory map the compiled version and use it
+     * in place instead of parsing the text table, as long as the text table
+     * does not change.
+     */
+    static void compile(const std::filesystem::path& pathname);
 };
 
 } // namespace wreport
@@ -14,6 +14,8 @@ typedef uint16_t Varcode;
 class Bulletin;
 class BufrBulletin;
 class CrexBulletin;
+struct ColumnarData;
+class DecodeVisitor;
 
 class BufrTableID;
 class CrexTableID;
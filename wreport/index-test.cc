@@ -0,0 +1,171 @@
+#include "index.h"
+#include "scanner.h"
+#include "tests.h"
+#include "utils/sys.h"
+#include <cstring>
+
+using namespace wreport;
+using namespace wreport::tests;
+
+namespace {
+
+/// Copy a test data file to \a dir, returning the pathname of the copy
+std::filesystem::path copy_datafile(const sys::Tempdir& dir, const char* name)
+{
+    std::filesystem::path res =
+        dir.path() / std::filesystem::path(name).filename();
+    sys::write_file(res, slurpfile(name));
+    return res;
+}
+
+class Tests : public TestCase
+{
+    using TestCase::TestCase;
+
+    void register_tests() override;
+} test("index");
+
+void Tests::register_tests()
+{
+    add_method("build", []() {
+        sys::Tempdir dir;
+        auto path = copy_datafile(dir, "bufr/synop3new.bufr");
+
+        MessageIndex index(path);
+        index.build();
+
+        // Records match the headers of the messages found scanning the file
+        FileScanner scanner(path);
+        ScannedMessage msg;
+        size_t count = 0;
+        while (scanner.next_bufr(msg))
+        {
+            wassert(actual(count) < index.records().size());
+            const IndexRecord& rec = index.records()[count++];
+            wassert(actual(rec.offset) == msg.offset);
+            wassert(actual(rec.length) == msg.size);
+            wassert(actual(rec.header_decoded) == 1);
+
+            auto bulletin = BufrBulletin::decode(msg.data, msg.size);
+            wassert(actual(rec.subset_count) == bulletin->subsets.size());
+            wassert(actual(rec.edition_number) == bulletin->edition_number);
+            wassert(actual(rec.originating_centre) ==
+                    bulletin->originating_centre);
+            wassert(actual(rec.data_category) == bulletin->data_category);
+            wassert(actual(rec.data_subcategory) ==
+                    bulletin->data_subcategory);
+            wassert(actual(rec.rep_year) == bulletin->rep_year);
+            wassert(actual(rec.rep_minute) == bulletin->rep_minute);
+            wassert(actual(rec.datadesc_hash) ==
+                    IndexRecord::hash_datadesc(bulletin->datadesc));
+        }
+        wassert(actual(count) == index.records().size());
+        wassert(actual(count) > 1u);
+
+        // The index can be written and loaded back
+        MessageIndex loaded(path);
+        wassert_false(loaded.load());
+        index.write();
+        wassert_true(loaded.load());
+        wassert(actual(loaded.records().size()) == index.records().size());
+        wassert(actual(memcmp(loaded.records().data(), index.records().data(),
+                              count * sizeof(IndexRecord))) == 0);
+    });
+
+    add_method("select", []() {
+        sys::Tempdir dir;
+        auto path = copy_datafile(dir, "bufr/synop3new.bufr");
+        MessageIndex index(path);
+        wassert_false(index.load_or_build());
+        wassert_true(index.load_or_build());
+
+        uint32_t hash = index.records()[1].datadesc_hash;
+        auto filter   = [&](const IndexRecord& rec) noexcept {
+            return rec.datadesc_hash == hash;
+        };
+        auto selected = index.select(filter);
+        wassert(actual(selected.size()) > 0u);
+        wassert(actual(selected.size()) < index.records().size());
+
+        // Only the selected messages are decoded
+        std::vector<uint64_t> offsets;
+        wassert_true(index.decode(
+            filter, [&](const IndexRecord& rec,
+                        std::unique_ptr<BufrBulletin> bulletin) {
+                wassert(actual((uint64_t)bulletin->offset) == rec.offset);
+                wassert(actual(IndexRecord::hash_datadesc(
+                            bulletin->datadesc)) == hash);
+                offsets.push_back(rec.offset);
+                return true;
+            }));
+        wassert(actual(offsets.size()) == selected.size());
+        for (size_t i = 0; i < offsets.size(); ++i)
+            wassert(actual(offsets[i]) == selected[i].offset);
+
+        // Decoding can be stopped
+        unsigned decoded = 0;
+        wassert_false(index.decode(
+            filter,
+            [&](const IndexRecord&, std::unique_ptr<BufrBulletin>) noexcept {
+                ++decoded;
+                return false;
+            }));
+        wassert(actual(decoded) == 1u);
+    });
+
+    add_method("outdated", []() {
+        sys::Tempdir dir;
+        auto path = copy_datafile(dir, "bufr/synop3new.bufr");
+        MessageIndex index(path);
+        index.build();
+        index.write();
+        size_t count = index.records().size();
+
+        // Append a message to the file
+        std::string data = sys::read_file(path);
+        FileScanner scanner(path);
+        ScannedMessage msg;
+        wassert_true(scanner.next_bufr(msg));
+        data.append(reinterpret_cast<const char*>(msg.data), msg.size);
+        sys::write_file(path, data);
+
+        // The index is not used anymore, and gets rebuilt
+        MessageIndex loaded(path);
+        wassert_false(loaded.load());
+        wassert_false(loaded.load_or_build());
+        wassert(actual(loaded.records().size()) == count + 1);
+        wassert_true(loaded.load());
+    });
+
+    add_method("undecodable", []() {
+        // Messages whose header cannot be decoded are still indexed
+        sys::Tempdir dir;
+        auto path = copy_datafile(dir, "bufr/synop3new.bufr");
+        std::string data = sys::read_file(path);
+        FileScanner scanner(path);
+        ScannedMessage msg;
+        wassert_true(scanner.next_bufr(msg));
+        // Corrupt the edition number
+        data[msg.offset + 7] = 9;
+        sys::write_file(path, data);
+
+        MessageIndex index(path);
+        index.build();
+        wassert(actual(index.records()[0].header_decoded) == 0);
+        wassert(actual(index.records()[0].offset) == msg.offset);
+        wassert(actual(index.records()[0].length) == msg.size);
+        wassert(actual(index.records()[1].header_decoded) == 1);
+    });
+
+    add_method("hash_datadesc", []() {
+        uint32_t a = IndexRecord::hash_datadesc({WR_VAR(3, 7, 80)});
+        uint32_t b = IndexRecord::hash_datadesc({WR_VAR(3, 7, 81)});
+        uint32_t c =
+            IndexRecord::hash_datadesc({WR_VAR(3, 7, 80), WR_VAR(0, 1, 1)});
+        wassert(actual(a) != b);
+        wassert(actual(a) != c);
+        wassert(actual(a) == IndexRecord::hash_datadesc({WR_VAR(3, 7, 80)}));
+    });
+}
+
+} // namespace
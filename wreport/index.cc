@@ -0,0 +1,245 @@
+#include "index.h"
+#include "bufr/decoder.h"
+#include "error.h"
+#include "scanner.h"
+#include "utils/sys.h"
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <system_error>
+
+namespace wreport {
+
+namespace {
+
+/// "WRIX", read with the native byte order
+const uint32_t magic = 0x57524958;
+
+/// Version of the file format, to change when the layout changes
+const uint32_t version = 1;
+
+/// Header of an index file, followed by the index records
+struct Header
+{
+    /// Marker for index files, also used to detect the byte order
+    uint32_t magic;
+    /// Version of the file format
+    uint32_t version;
+    /// Size of each record
+    uint32_t record_size;
+    /// Number of records
+    uint32_t count;
+    /// Size of the indexed file
+    uint64_t source_size;
+    /// Modification time of the indexed file, in nanoseconds
+    int64_t source_mtime;
+};
+
+static_assert(sizeof(Header) % 8 == 0, "index records must stay aligned");
+static_assert(sizeof(IndexRecord) == 40, "unexpected index record layout");
+
+int64_t mtime_ns(const struct stat& st)
+{
+    return static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 +
+           st.st_mtim.tv_nsec;
+}
+
+/// Fill an index record with the header of a decoded message
+void fill_record(IndexRecord& rec, const BufrBulletin& bulletin,
+                 size_t subset_count)
+{
+    rec.datadesc_hash          = IndexRecord::hash_datadesc(bulletin.datadesc);
+    rec.subset_count           = subset_count;
+    rec.originating_centre     = bulletin.originating_centre;
+    rec.originating_subcentre  = bulletin.originating_subcentre;
+    rec.rep_year               = bulletin.rep_year;
+    rec.edition_number         = bulletin.edition_number;
+    rec.data_category          = bulletin.data_category;
+    rec.data_subcategory       = bulletin.data_subcategory;
+    rec.data_subcategory_local = bulletin.data_subcategory_local;
+    rec.rep_month              = bulletin.rep_month;
+    rec.rep_day                = bulletin.rep_day;
+    rec.rep_hour               = bulletin.rep_hour;
+    rec.rep_minute             = bulletin.rep_minute;
+    rec.rep_second             = bulletin.rep_second;
+    rec.header_decoded         = 1;
+}
+
+} // namespace
+
+uint32_t IndexRecord::hash_datadesc(const std::vector<Varcode>& datadesc)
+{
+    // 32 bit FNV-1a over the big endian varcodes
+    uint32_t res = 2166136261u;
+    for (Varcode code : datadesc)
+    {
+        res = (res ^ (code >> 8)) * 16777619u;
+        res = (res ^ (code & 0xff)) * 16777619u;
+    }
+    return res;
+}
+
+MessageIndex::MessageIndex(const std::filesystem::path& path) : m_path(path)
+{
+}
+
+std::filesystem::path
+MessageIndex::index_path(const std::filesystem::path& path)
+{
+    std::filesystem::path res(path);
+    res += ".idx";
+    return res;
+}
+
+void MessageIndex::build()
+{
+    struct stat st;
+    sys::stat(m_path, st);
+    m_source_size  = st.st_size;
+    m_source_mtime = mtime_ns(st);
+    m_records.clear();
+
+    FileScanner scanner(m_path);
+    auto bulletin = BufrBulletin::create();
+    while (true)
+    {
+        ScannedMessage msg;
+        try
+        {
+            if (!scanner.next_bufr(msg))
+                break;
+        }
+        catch (error_consistency&)
+        {
+            // The scanner resumes after the truncated message
+            continue;
+        }
+
+        IndexRecord rec{};
+        try
+        {
+            bulletin->clear();
+            bufr::Decoder d(msg.data, msg.size, m_path.c_str(), msg.offset,
+                            *bulletin);
+            d.decode_header();
+            fill_record(rec, *bulletin, d.expected_subsets);
+        }
+        catch (error&)
+        {
+            // Only the position of the message is indexed
+            rec = IndexRecord{};
+        }
+        rec.offset = msg.offset;
+        rec.length = msg.size;
+        m_records.push_back(rec);
+    }
+}
+
+bool MessageIndex::load()
+{
+    m_records.clear();
+    try
+    {
+        sys::File in(index_path(m_path));
+        if (!in.open_ifexists(O_RDONLY))
+            return false;
+
+        struct stat st;
+        in.fstat(st);
+        if (static_cast<size_t>(st.st_size) < sizeof(Header))
+            return false;
+
+        struct stat src;
+        sys::stat(m_path, src);
+
+        Header head;
+        in.read_all_or_throw(&head, sizeof(head));
+        if (head.magic != magic || head.version != version ||
+            head.record_size != sizeof(IndexRecord))
+            return false;
+        if (head.source_size != static_cast<uint64_t>(src.st_size) ||
+            head.source_mtime != mtime_ns(src))
+            return false;
+        if (static_cast<uint64_t>(st.st_size) !=
+            sizeof(Header) + static_cast<uint64_t>(head.count) *
+                                 sizeof(IndexRecord))
+            return false;
+
+        m_records.resize(head.count);
+        in.read_all_or_throw(m_records.data(),
+                             m_records.size() * sizeof(IndexRecord));
+        m_source_size  = head.source_size;
+        m_source_mtime = head.source_mtime;
+        return true;
+    }
+    catch (std::system_error&)
+    {
+        m_records.clear();
+        return false;
+    }
+}
+
+void MessageIndex::write() const
+{
+    Header head{};
+    head.magic        = magic;
+    head.version      = version;
+    head.record_size  = sizeof(IndexRecord);
+    head.count        = m_records.size();
+    head.source_size  = m_source_size;
+    head.source_mtime = m_source_mtime;
+
+    std::string buf(reinterpret_cast<const char*>(&head), sizeof(head));
+    buf.append(reinterpret_cast<const char*>(m_records.data()),
+               m_records.size() * sizeof(IndexRecord));
+    sys::write_file_atomically(index_path(m_path), buf, 0666);
+}
+
+bool MessageIndex::load_or_build()
+{
+    if (load())
+        return true;
+    build();
+    write();
+    return false;
+}
+
+std::vector<IndexRecord> MessageIndex::select(Filter filter) const
+{
+    std::vector<IndexRecord> res;
+    for (const auto& rec : m_records)
+        if (filter(rec))
+            res.push_back(rec);
+    return res;
+}
+
+bool MessageIndex::decode(Filter filter, Dest dest,
+                          const BufrCodecOptions* opts) const
+{
+    FileScanner scanner(m_path);
+    for (const auto& rec : m_records)
+    {
+        if (!filter(rec))
+            continue;
+        if (rec.offset + rec.length > scanner.size())
+            error_consistency::throwf(
+                "%s: message at offset %llu is past the end of the file: the "
+                "index is out of date",
+                m_path.c_str(), static_cast<unsigned long long>(rec.offset));
+        const uint8_t* data = scanner.data() + rec.offset;
+        std::unique_ptr<BufrBulletin> bulletin;
+        if (opts)
+            bulletin = BufrBulletin::decode(data, rec.length, *opts,
+                                            m_path.c_str(), rec.offset);
+        else
+            bulletin = BufrBulletin::decode(data, rec.length, m_path.c_str(),
+                                            rec.offset);
+        // The message may have been rejected by the header filter in opts
+        if (!bulletin)
+            continue;
+        if (!dest(rec, std::move(bulletin)))
+            return false;
+    }
+    return true;
+}
+
+} // namespace wreport
@@ -0,0 +1,162 @@
+#ifndef WREPORT_INDEX_H
+#define WREPORT_INDEX_H
+
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include <wreport/bulletin.h>
+
+/**
+ * Persistent indices of the BUFR messages in a file.
+ *
+ * An index is stored next to the file it describes, with an added .idx
+ * extension, and contains a fixed size record for each message, with its
+ * position in the file and the information in its header. It is built by
+ * decoding only the headers of the messages, and it allows to select messages
+ * and to decode only the selected ones, without scanning the file again.
+ *
+ * The index records size and modification time of the file it was built
+ * from, and it is not used if they do not match anymore.
+ */
+namespace wreport {
+
+/// Information about a BUFR message stored in an index
+struct IndexRecord
+{
+    /// Offset of the message from the start of the file
+    uint64_t offset;
+    /// Length of the message in bytes
+    uint32_t length;
+    /// Hash of the data descriptor section, computed by hash_datadesc()
+    uint32_t datadesc_hash;
+    /// Number of subsets
+    uint16_t subset_count;
+    /// Originating centre
+    uint16_t originating_centre;
+    /// Originating subcentre
+    uint16_t originating_subcentre;
+    /// Reference time: year
+    uint16_t rep_year;
+    /// BUFR edition number
+    uint8_t edition_number;
+    /// Data category
+    uint8_t data_category;
+    /// International data subcategory
+    uint8_t data_subcategory;
+    /// Local data subcategory
+    uint8_t data_subcategory_local;
+    /// Reference time: month
+    uint8_t rep_month;
+    /// Reference time: day
+    uint8_t rep_day;
+    /// Reference time: hour
+    uint8_t rep_hour;
+    /// Reference time: minute
+    uint8_t rep_minute;
+    /// Reference time: second
+    uint8_t rep_second;
+    /**
+     * True if the header was decoded: if false, only offset and length are
+     * set, and decoding the message will fail
+     */
+    uint8_t header_decoded;
+    uint8_t pad[6];
+
+    /// Hash a data descriptor section, for quick comparison of message layouts
+    static uint32_t hash_datadesc(const std::vector<Varcode>& datadesc);
+};
+
+/// Index of the BUFR messages in a file
+class MessageIndex
+{
+protected:
+    /// Pathname of the indexed file
+    std::filesystem::path m_path;
+    /// Index records, in the order the messages appear in the file
+    std::vector<IndexRecord> m_records;
+    /// Size of the indexed file when the index was built or loaded
+    uint64_t m_source_size = 0;
+    /// Modification time of the indexed file when the index was built or
+    /// loaded, in nanoseconds
+    int64_t m_source_mtime = 0;
+
+public:
+    /// Function used to select index records
+    typedef std::function<bool(const IndexRecord&)> Filter;
+
+    /**
+     * Function receiving selected messages, and returning false to stop
+     * reading
+     */
+    typedef std::function<bool(const IndexRecord&,
+                               std::unique_ptr<BufrBulletin>)>
+        Dest;
+
+    /// Create an empty index for the file \a path
+    explicit MessageIndex(const std::filesystem::path& path);
+
+    /// Pathname of the indexed file
+    const std::filesystem::path& path() const { return m_path; }
+
+    /// Pathname of the index of \a path
+    static std::filesystem::path index_path(const std::filesystem::path& path);
+
+    /// Index records, in the order the messages appear in the file
+    const std::vector<IndexRecord>& records() const { return m_records; }
+
+    /**
+     * Build the index scanning the file and decoding the headers of all its
+     * messages.
+     *
+     * Messages whose header cannot be decoded are indexed with
+     * IndexRecord::header_decoded set to false. Truncated messages are
+     * skipped.
+     *
+     * Size and modification time of the file are read before scanning it, so
+     * that the index will be considered out of date if the file changes
+     * while it is being indexed.
+     */
+    void build();
+
+    /**
+     * Load the index from index_path().
+     *
+     * Returns false if there is no index that can be used: it is missing,
+     * unreadable, out of date, or written by an incompatible version of
+     * wreport.
+     */
+    bool load();
+
+    /// Atomically write the index to index_path()
+    void write() const;
+
+    /**
+     * Load the index if it is up to date, else build it and write it.
+     *
+     * Returns true if the index was loaded, false if it was built.
+     */
+    bool load_or_build();
+
+    /// Return the records matching \a filter
+    std::vector<IndexRecord> select(Filter filter) const;
+
+    /**
+     * Decode the messages whose records match \a filter, and send them to
+     * \a dest.
+     *
+     * The indexed file is memory mapped, and only the selected messages are
+     * read and decoded. Messages rejected by the decode_header_filter of
+     * \a opts are not sent to \a dest.
+     *
+     * Returns false if \a dest stopped the reading, else true.
+     */
+    bool decode(Filter filter, Dest dest,
+                const BufrCodecOptions* opts = nullptr) const;
+};
+
+} // namespace wreport
+
+#endif
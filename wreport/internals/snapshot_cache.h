@@ -0,0 +1,94 @@
+#ifndef WREPORT_INTERNALS_SNAPSHOT_CACHE_H
+#define WREPORT_INTERNALS_SNAPSHOT_CACHE_H
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace wreport {
+
+/**
+ * Read-mostly cache that can be used concurrently by multiple threads.
+ *
+ * Lookups read an immutable snapshot of the cache contents without locking.
+ * Insertions are serialised by a mutex: they copy the current snapshot, add
+ * the new entry, and atomically publish the copy as the new snapshot.
+ *
+ * Since readers may still be using them, replaced snapshots are kept until the
+ * cache is destroyed. This is meant for small caches of things like loaded
+ * tables, that are filled once at startup and then only read.
+ */
+template <typename Key, typename Value> class SnapshotCache
+{
+protected:
+    typedef std::map<Key, Value> Map;
+
+    /// Current snapshot, or nullptr if the cache is empty
+    std::atomic<const Map*> snapshot{nullptr};
+
+    /// All snapshots published so far, the last one is the current one
+    std::vector<std::unique_ptr<const Map>> snapshots;
+
+    /// Serialise insertions
+    std::mutex mutex;
+
+    static const Value* lookup(const Map* map, const Key& key)
+    {
+        if (!map)
+            return nullptr;
+        auto i = map->find(key);
+        if (i == map->end())
+            return nullptr;
+        return &i->second;
+    }
+
+public:
+    SnapshotCache()                                = default;
+    SnapshotCache(const SnapshotCache&)            = delete;
+    SnapshotCache& operator=(const SnapshotCache&) = delete;
+
+    /**
+     * Look up a value without locking.
+     *
+     * Returns nullptr if \a key is not in the cache. The returned pointer
+     * remains valid for the lifetime of the cache.
+     */
+    const Value* find(const Key& key) const
+    {
+        return lookup(snapshot.load(std::memory_order_acquire), key);
+    }
+
+    /**
+     * Look up a value, calling \a create to compute it if it is not in the
+     * cache yet.
+     *
+     * \a create is called with the insertion lock held, so that it is called
+     * only once per key even if several threads ask for the same missing key
+     * at the same time. If it throws, nothing is added to the cache.
+     */
+    template <typename Create> Value get(const Key& key, Create create)
+    {
+        if (const Value* res = find(key))
+            return *res;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        const Map* cur = snapshot.load(std::memory_order_relaxed);
+        // Another thread may have added it while we were waiting for the lock
+        if (const Value* res = lookup(cur, key))
+            return *res;
+
+        Value value = create();
+        std::unique_ptr<Map> next(cur ? new Map(*cur) : new Map);
+        next->emplace(key, value);
+        const Map* published = next.get();
+        snapshots.emplace_back(std::move(next));
+        snapshot.store(published, std::memory_order_release);
+        return value;
+    }
+};
+
+} // namespace wreport
+
+#endif
@@ -0,0 +1,195 @@
+#include "tablecache.h"
+#include "tabledir.h"
+#include "vartable.h"
+#include "wreport/dtable.h"
+#include "wreport/tests.h"
+#include <cstddef>
+#include <cstring>
+
+using namespace wreport;
+using namespace wreport::tests;
+
+namespace {
+
+/// Copy a table to \a dir, returning the pathname of the copy
+std::filesystem::path copy_table(const sys::Tempdir& dir,
+                                 const std::filesystem::path& source)
+{
+    std::filesystem::path res = dir.path() / source.filename();
+    sys::write_file(res, sys::read_file(source));
+    return res;
+}
+
+/// Find the pathnames of the B and D tables with the given name
+const tabledir::Table& find_table(const char* name)
+{
+    auto res = tabledir::Tabledirs::get().find(name);
+    if (!res)
+        throw error_notfound(name);
+    return *res;
+}
+
+/// Check that all D table expansions in \a loaded are the same as in \a parsed
+void compare_dtables(const DTable* parsed, const DTable* loaded)
+{
+    unsigned checked = 0;
+    for (unsigned x = 0; x < 64; ++x)
+        for (unsigned y = 0; y < 256; ++y)
+        {
+            Varcode code = WR_VAR(3, x, y);
+            Opcodes expected(nullptr, nullptr);
+            try
+            {
+                expected = parsed->query(code);
+            }
+            catch (error_notfound&)
+            {
+                wassert_throws(error_notfound, loaded->query(code));
+                continue;
+            }
+            Opcodes got = loaded->query(code);
+            wassert(actual(got.size()) == expected.size());
+            for (unsigned i = 0; i < got.size(); ++i)
+                wassert(actual(got[i]) == expected[i]);
+            ++checked;
+        }
+    wassert(actual(checked) > 0u);
+}
+
+class Tests : public TestCase
+{
+    using TestCase::TestCase;
+
+    void register_tests() override;
+} test("internals_tablecache");
+
+void Tests::register_tests()
+{
+    add_method("btable", []() {
+        sys::Tempdir dir;
+        const auto& table = find_table("B0000000000000014000");
+        auto path         = copy_table(dir, table.btable_pathname);
+        auto compiled_path = tablecache::compiled_path(path);
+        wassert_false(std::filesystem::exists(compiled_path));
+        Vartable::compile(path);
+        wassert_true(std::filesystem::exists(compiled_path));
+
+        // The compiled table has the same contents as the text one
+        vartable::Bufr parsed(path, false);
+        vartable::Bufr compiled(path);
+        wassert(actual(compiled.size) == parsed.size);
+        wassert(actual(memcmp(compiled.entries, parsed.entries,
+                              parsed.size * sizeof(_Varinfo))) == 0);
+
+        vartable::Crex crex_parsed(path, false);
+        vartable::Crex crex_compiled(path);
+        wassert(actual(crex_compiled.size) == crex_parsed.size);
+        wassert(actual(memcmp(crex_compiled.entries, crex_parsed.entries,
+                              crex_parsed.size * sizeof(_Varinfo))) == 0);
+
+        // Lookups and alterations work on the memory mapped entries
+        Varinfo info = compiled.query(WR_VAR(0, 1, 6));
+        wassert_true(info == compiled.query(WR_VAR(0, 1, 6)));
+        Varinfo alt = compiled.query_altered(WR_VAR(0, 1, 6), 0, 128, 0);
+        wassert(actual(alt->bit_len) == 128u);
+        wassert(actual(info->bit_len) != 128u);
+
+        // Entries are read from the compiled version
+        std::string data = sys::read_file(compiled_path);
+        const auto* head =
+            reinterpret_cast<const tablecache::Header*>(data.data());
+        memcpy(&data[head->sections[0].offset + offsetof(_Varinfo, desc)],
+               "PATCHED", 8);
+        sys::write_file(compiled_path, data);
+        vartable::Bufr patched(path);
+        wassert(actual(patched.entries[0].desc) == "PATCHED");
+    });
+
+    add_method("btable_no_crex", []() {
+        sys::Tempdir dir;
+        std::filesystem::path path = dir.path() / "test-bufr-table.txt";
+        sys::write_file(path,
+                        sys::read_file(datafile("test-bufr-table.txt")));
+        Vartable::compile(path);
+
+        vartable::Bufr compiled(path);
+        wassert(actual(compiled.size) > 0u);
+        auto e = wassert_throws(error_consistency, vartable::Crex crex(path));
+        wassert(actual(e.what()).contains("does not contain any CREX"));
+    });
+
+    add_method("btable_outdated", []() {
+        sys::Tempdir dir;
+        const auto& table = find_table("B0000000000000014000");
+        auto path         = copy_table(dir, table.btable_pathname);
+        Vartable::compile(path);
+
+        // Drop the last line of the text table
+        std::string text = sys::read_file(path);
+        text.resize(text.rfind('\n', text.size() - 2) + 1);
+        sys::write_file(path, text);
+
+        // The compiled version is not used anymore
+        vartable::Bufr parsed(path, false);
+        vartable::Bufr loaded(path);
+        wassert(actual(loaded.size) == parsed.size);
+        wassert(actual(memcmp(loaded.entries, parsed.entries,
+                              parsed.size * sizeof(_Varinfo))) == 0);
+
+        // Recompiling makes it current again
+        Vartable::compile(path);
+        tablecache::Compiled compiled;
+        const uint32_t record_sizes[tablecache::section_count] = {
+            sizeof(_Varinfo), sizeof(_Varinfo)};
+        wassert_true(compiled.open(path, tablecache::Kind::B, record_sizes,
+                                   vartable::compiled_layout));
+        wassert(actual(compiled.count(0)) == parsed.size);
+
+        // Compiled tables of the wrong kind or layout are not used
+        wassert_false(compiled.open(path, tablecache::Kind::D, record_sizes,
+                                    vartable::compiled_layout));
+        const uint32_t wrong_sizes[tablecache::section_count] = {
+            sizeof(_Varinfo) + 8, sizeof(_Varinfo)};
+        wassert_false(compiled.open(path, tablecache::Kind::B, wrong_sizes,
+                                    vartable::compiled_layout));
+        wassert_false(compiled.open(path, tablecache::Kind::B, record_sizes,
+                                    vartable::compiled_layout + 1));
+    });
+
+    add_method("dtable", []() {
+        sys::Tempdir dir;
+        const auto& table = find_table("B0000000000000014000");
+        auto path         = copy_table(dir, table.dtable_pathname);
+        DTable::compile(path);
+        wassert_true(std::filesystem::exists(tablecache::compiled_path(path)));
+
+        wassert(compare_dtables(DTable::load_bufr(table.dtable_pathname),
+                                DTable::load_bufr(path.native())));
+    });
+
+    add_method("dtable_invalid", []() {
+        sys::Tempdir dir;
+        const auto& table = find_table("B0000000000000014000");
+        auto path         = copy_table(dir, table.dtable_pathname);
+        DTable::compile(path);
+
+        // Make the last entry expand past the end of the varcodes. The end
+        // position is the last field of each entry
+        auto compiled_path = tablecache::compiled_path(path);
+        std::string data   = sys::read_file(compiled_path);
+        const auto* head =
+            reinterpret_cast<const tablecache::Header*>(data.data());
+        const auto& entries = head->sections[0];
+        uint32_t end        = head->sections[1].count + 1;
+        memcpy(&data[entries.offset + entries.count * entries.record_size -
+                     sizeof(end)],
+               &end, sizeof(end));
+        sys::write_file(compiled_path, data);
+
+        // The text version is used instead
+        wassert(compare_dtables(DTable::load_bufr(table.dtable_pathname),
+                                DTable::load_bufr(path.native())));
+    });
+}
+
+} // namespace
@@ -0,0 +1,125 @@
+#include "tablecache.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <system_error>
+
+namespace wreport::tablecache {
+
+namespace {
+
+/// "WRTC", read with the native byte order
+const uint32_t magic = 0x57525443;
+
+/// Version of the file format, to change when the layout of the header changes
+const uint32_t version = 2;
+
+int64_t mtime_ns(const struct stat& st)
+{
+    return static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 +
+           st.st_mtim.tv_nsec;
+}
+
+} // namespace
+
+std::filesystem::path compiled_path(const std::filesystem::path& source)
+{
+    std::filesystem::path res(source);
+    res.replace_extension(".bin");
+    return res;
+}
+
+bool Compiled::open(const std::filesystem::path& source, Kind kind,
+                    const uint32_t (&record_sizes)[section_count],
+                    uint64_t layout)
+{
+    // Any problem with the compiled version means falling back to the text
+    // version, which will report errors if needed
+    try
+    {
+        sys::File in(compiled_path(source));
+        if (!in.open_ifexists(O_RDONLY))
+            return false;
+
+        struct stat st;
+        in.fstat(st);
+        uint64_t size = st.st_size;
+        if (size < sizeof(Header))
+            return false;
+
+        struct stat src;
+        sys::stat(source, src);
+
+        sys::MMap map       = in.mmap(size, PROT_READ, MAP_PRIVATE);
+        const Header* head = map;
+        if (head->magic != magic || head->version != version ||
+            head->kind != kind || head->layout != layout)
+            return false;
+        if (head->source_size != static_cast<uint64_t>(src.st_size) ||
+            head->source_mtime != mtime_ns(src))
+            return false;
+        for (unsigned i = 0; i < section_count; ++i)
+        {
+            const Header::Section& section = head->sections[i];
+            if (section.record_size != record_sizes[i] ||
+                section.offset % 8 != 0 ||
+                section.offset +
+                        static_cast<uint64_t>(section.count) *
+                            section.record_size >
+                    size)
+                return false;
+        }
+
+        m_map.reset(new sys::MMap(std::move(map)));
+        return true;
+    }
+    catch (std::system_error&)
+    {
+        return false;
+    }
+}
+
+void Compiled::close() { m_map.reset(); }
+
+unsigned Compiled::count(unsigned section) const
+{
+    const Header* head = *m_map;
+    return head->sections[section].count;
+}
+
+Writer::Writer(const std::filesystem::path& source, Kind kind,
+               uint64_t layout)
+    : m_source(source), m_header()
+{
+    struct stat st;
+    sys::stat(source, st);
+    m_header.magic        = magic;
+    m_header.version      = version;
+    m_header.kind         = kind;
+    m_header.source_size  = st.st_size;
+    m_header.source_mtime = mtime_ns(st);
+    m_header.layout       = layout;
+}
+
+void Writer::add_section(unsigned section, const void* records, uint32_t count,
+                         uint32_t record_size)
+{
+    // Sections are aligned to 8 bytes, and so is the size of the header
+    m_data.resize((m_data.size() + 7) / 8 * 8, 0);
+    Header::Section& s = m_header.sections[section];
+    s.offset           = sizeof(Header) + m_data.size();
+    s.count            = count;
+    s.record_size      = record_size;
+    if (count)
+        m_data.append(static_cast<const char*>(records),
+                      static_cast<size_t>(count) * record_size);
+}
+
+void Writer::write()
+{
+    std::string buf(reinterpret_cast<const char*>(&m_header), sizeof(Header));
+    buf += m_data;
+    sys::write_file_atomically(compiled_path(m_source), buf, 0666);
+}
+
+} // namespace wreport::tablecache
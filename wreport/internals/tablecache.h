@@ -0,0 +1,159 @@
+#ifndef WREPORT_INTERNALS_TABLECACHE_H
+#define WREPORT_INTERNALS_TABLECACHE_H
+
+#include <cstdint>
+#include <filesystem>
+#include <initializer_list>
+#include <memory>
+#include <string>
+#include <wreport/utils/sys.h>
+
+/**
+ * Compiled binary versions of B and D tables.
+ *
+ * A compiled table is stored next to its text version, with a .bin extension,
+ * and contains the parsed table records in the same layout they have in
+ * memory, so that they can be memory mapped and used in place.
+ *
+ * The file records size and modification time of the text version it was
+ * compiled from, and it is ignored if they do not match anymore. It also
+ * records the size of each record type and a fingerprint of their layout, and
+ * it is ignored if it was compiled by an incompatible version of wreport.
+ */
+namespace wreport::tablecache {
+
+/// Kind of table stored in a compiled table file
+enum class Kind : uint32_t {
+    /// B table, with BUFR entries in section 0 and CREX entries in section 1
+    B = 'B',
+    /// D table, with entries in section 0 and their expansions in section 1
+    D = 'D',
+};
+
+/// Number of sections in a compiled table file
+static const unsigned section_count = 2;
+
+/**
+ * Compute a fingerprint of the layout of the records stored in a compiled
+ * table.
+ *
+ * \a values are the size of the records, and the offset and size of each of
+ * their fields.
+ */
+constexpr uint64_t layout_fingerprint(std::initializer_list<uint64_t> values)
+{
+    // FNV-1a over the values
+    uint64_t res = 0xcbf29ce484222325;
+    for (uint64_t value : values)
+    {
+        res ^= value;
+        res *= 0x100000001b3;
+    }
+    return res;
+}
+
+/// Header of a compiled table file
+struct Header
+{
+    /// Marker for compiled tables, also used to detect the byte order
+    uint32_t magic;
+    /// Version of the file format
+    uint32_t version;
+    /// Kind of table
+    Kind kind;
+    uint32_t pad;
+    /// Size of the text version of the table
+    uint64_t source_size;
+    /// Modification time of the text version of the table, in nanoseconds
+    int64_t source_mtime;
+    /// Fingerprint of the layout of the records
+    uint64_t layout;
+
+    /// Position of an array of records in the file
+    struct Section
+    {
+        /// Offset from the beginning of the file, aligned to 8 bytes
+        uint64_t offset;
+        /// Number of records
+        uint32_t count;
+        /// Size of each record
+        uint32_t record_size;
+    } sections[section_count];
+};
+
+/// Pathname of the compiled version of the text table \a source
+std::filesystem::path compiled_path(const std::filesystem::path& source);
+
+/// Memory mapped compiled table
+class Compiled
+{
+protected:
+    std::unique_ptr<sys::MMap> m_map;
+
+public:
+    Compiled() = default;
+    Compiled(const Compiled&)            = delete;
+    Compiled& operator=(const Compiled&) = delete;
+
+    /**
+     * Map the compiled version of \a source.
+     *
+     * \a record_sizes is the size of the records expected in each section,
+     * and \a layout the layout_fingerprint() of the records.
+     *
+     * Returns false if there is no compiled version that can be used: it is
+     * missing, unreadable, out of date, or compiled for a different kind of
+     * table or record layout.
+     */
+    bool open(const std::filesystem::path& source, Kind kind,
+              const uint32_t (&record_sizes)[section_count], uint64_t layout);
+
+    /// Unmap the table, if it was opened
+    void close();
+
+    /// Number of records in a section of a table that has been opened
+    unsigned count(unsigned section) const;
+
+    /// Records in a section of a table that has been opened
+    template <typename T> const T* records(unsigned section) const
+    {
+        const uint8_t* base = *m_map;
+        return reinterpret_cast<const T*>(
+            base + reinterpret_cast<const Header*>(base)
+                       ->sections[section]
+                       .offset);
+    }
+};
+
+/// Write the compiled version of a table
+class Writer
+{
+protected:
+    std::filesystem::path m_source;
+    Header m_header;
+    /// Contents of the file after the header
+    std::string m_data;
+
+public:
+    /**
+     * Start compiling \a source.
+     *
+     * Size and modification time of \a source are read here, so that the
+     * compiled version will be considered out of date if \a source changes
+     * while it is being parsed.
+     *
+     * \a layout is the layout_fingerprint() of the records.
+     */
+    Writer(const std::filesystem::path& source, Kind kind, uint64_t layout);
+
+    /// Set the records of a section
+    void add_section(unsigned section, const void* records, uint32_t count,
+                     uint32_t record_size);
+
+    /// Atomically write the compiled table to compiled_path()
+    void write();
+};
+
+} // namespace wreport::tablecache
+
+#endif
@@ -1,6 +1,7 @@
 #include "tabledir.h"
 #include "config.h"
 #include "error.h"
+#include "snapshot_cache.h"
 #include "wreport/dtable.h"
 #include "wreport/notes.h"
 #include "wreport/options.h"
@@ -10,7 +11,6 @@
 #include <cstddef>
 #include <cstdio>
 #include <cstring>
-#include <map>
 
 using namespace std;
 
@@ -295,8 +295,8 @@ struct CrexQuery : public Query
 struct Index
 {
     std::vector<Dir> dirs;
-    std::map<BufrTableID, const Table*> bufr_cache;
-    std::map<CrexTableID, const Table*> crex_cache;
+    SnapshotCache<BufrTableID, const Table*> bufr_cache;
+    SnapshotCache<CrexTableID, const Table*> crex_cache;
 
     explicit Index(const vector<string>& dirs)
     {
@@ -308,9 +308,8 @@ struct Index
     const tabledir::Table* find_bufr(const BufrTableID& id)
     {
         // First look it up in cache
-        const auto i = bufr_cache.find(id);
-        if (i != bufr_cache.end())
-            return i->second;
+        if (const auto* cached = bufr_cache.find(id))
+            return *cached;
 
         // If it is the first time this combination is requested, look for the
         // best match
@@ -320,7 +319,7 @@ struct Index
 
         if (auto result = query.result())
         {
-            bufr_cache[id] = result;
+            bufr_cache.get(id, [&] { return result; });
             notes::logf("Matched table %s for ce %hu sc %hu mt %hhu mtv %hhu "
                         "mtlv %hhu\n",
                         result->btable_id.c_str(), id.originating_centre,
@@ -345,9 +344,8 @@ struct Index
     const tabledir::Table* find_crex(const CrexTableID& id)
     {
         // First look it up in cache
-        const auto i = crex_cache.find(id);
-        if (i != crex_cache.end())
-            return i->second;
+        if (const auto* cached = crex_cache.find(id))
+            return *cached;
 
         // If it is the first time this combination is requested, look for the
         // best match
@@ -357,7 +355,7 @@ struct Index
 
         if (auto result = query.result())
         {
-            crex_cache[id] = result;
+            crex_cache.get(id, [&] { return result; });
             notes::logf("Matched table %s for mt %hhu mtv %hhu mtlv %hhu\n",
                         result->btable_id.c_str(), id.master_table_number,
                         id.master_table_version_number,
@@ -403,9 +401,24 @@ struct Index
  * Tabledirs
  */
 
-Tabledirs::Tabledirs() : index(0) {}
+Tabledirs::Tabledirs() : index(nullptr) {}
 
-Tabledirs::~Tabledirs() { delete index; }
+Tabledirs::~Tabledirs() { delete index.load(); }
+
+Index& Tabledirs::get_index()
+{
+    if (Index* res = index.load(std::memory_order_acquire))
+        return *res;
+
+    std::lock_guard<std::mutex> lock(index_mutex);
+    Index* res = index.load(std::memory_order_relaxed);
+    if (!res)
+    {
+        res = new tabledir::Index(dirs);
+        index.store(res, std::memory_order_release);
+    }
+    return *res;
+}
 
 void Tabledirs::add_default_directories()
 {
@@ -432,17 +445,14 @@ void Tabledirs::add_directory(const std::string& dir)
     dirs.push_back(clean_dir);
 
     // Force a rebuild of the index
-    delete index;
-    index = 0;
+    delete index.exchange(nullptr);
 }
 
 const tabledir::Table* Tabledirs::find_bufr(const BufrTableID& id)
 {
-    if (!index)
-        index = new tabledir::Index(dirs);
     if (options::var_master_table_version_override ==
         options::MasterTableVersionOverride::NONE)
-        return index->find_bufr(id);
+        return get_index().find_bufr(id);
     BufrTableID overridden(id);
     if (options::var_master_table_version_override ==
         options::MasterTableVersionOverride::NEWEST)
@@ -451,14 +461,14 @@ const tabledir::Table* Tabledirs::find_bufr(const BufrTableID& id)
     else
         overridden.master_table_version_number =
             options::var_master_table_version_override;
-    return index->find_bufr(overridden);
+    return get_index().find_bufr(overridden);
 }
 
 const tabledir::Table* Tabledirs::find_crex(const CrexTableID& id)
 {
     if (options::var_master_table_version_override ==
         options::MasterTableVersionOverride::NONE)
-        return index->find_crex(id);
+        return get_index().find_crex(id);
     CrexTableID overridden(id);
     if (options::var_master_table_version_override ==
         options::MasterTableVersionOverride::NEWEST)
@@ -467,45 +477,37 @@ const tabledir::Table* Tabledirs::find_crex(const CrexTableID& id)
     else
         overridden.master_table_version_number =
             options::var_master_table_version_override;
-    return index->find_crex(overridden);
+    return get_index().find_crex(overridden);
 }
 
 const tabledir::Table* Tabledirs::find(const std::string& basename)
 {
-    if (!index)
-        index = new tabledir::Index(dirs);
-    return index->find(basename);
+    return get_index().find(basename);
 }
 
 void Tabledirs::print(FILE* out)
 {
-    if (!index)
-        index = new tabledir::Index(dirs);
-    index->print(out);
+    get_index().print(out);
 }
 
 void Tabledirs::explain_find_bufr(const BufrTableID& id, FILE* out)
 {
-    if (!index)
-        index = new tabledir::Index(dirs);
-    index->explain_find_bufr(id, out);
+    get_index().explain_find_bufr(id, out);
 }
 
 void Tabledirs::explain_find_crex(const CrexTableID& id, FILE* out)
 {
-    if (!index)
-        index = new tabledir::Index(dirs);
-    index->explain_find_crex(id, out);
+    get_index().explain_find_crex(id, out);
 }
 
 Tabledirs& Tabledirs::get()
 {
-    static Tabledirs* default_tabledir = 0;
-    if (!default_tabledir)
-    {
-        default_tabledir = new Tabledirs();
-        default_tabledir->add_default_directories();
-    }
+    // Allocated and never freed, as it is used until program exit
+    static Tabledirs* default_tabledir = [] {
+        auto res = new Tabledirs();
+        res->add_default_directories();
+        return res;
+    }();
     return *default_tabledir;
 }
 
@@ -1,7 +1,9 @@
 #ifndef WREPORT_TABLEDIR_H
 #define WREPORT_TABLEDIR_H
 
+#include <atomic>
 #include <filesystem>
+#include <mutex>
 #include <string>
 #include <vector>
 #include <wreport/tableinfo.h>
@@ -72,11 +74,23 @@ struct Dir
     void refresh();
 };
 
+/**
+ * Collection of table directories.
+ *
+ * Lookups can be run concurrently from multiple threads, but the list of
+ * directories must not be changed while lookups are running.
+ */
 class Tabledirs
 {
 protected:
     std::vector<std::string> dirs;
-    Index* index;
+    /// Index of dirs, built on first use
+    std::atomic<Index*> index;
+    /// Serialise building the index
+    std::mutex index_mutex;
+
+    /// Get the index, building it if needed
+    Index& get_index();
 
 public:
     Tabledirs();
@@ -0,0 +1,58 @@
+#ifndef WREPORT_INTERNALS_VARCODE_INDEX_H
+#define WREPORT_INTERNALS_VARCODE_INDEX_H
+
+#include <cstdint>
+#include <vector>
+#include <wreport/varinfo.h>
+
+namespace wreport {
+
+/**
+ * Direct index from a Varcode to the position of an entry in a table.
+ *
+ * A Varcode has 16 bits: F and X in the 8 high bits, and Y in the 8 low bits.
+ * Lookups take one array access by F and X, to find a block of 256 positions,
+ * and one by Y inside the block. Blocks are only allocated for the F and X
+ * values present in the table, and tables usually have a few tens of them.
+ */
+class VarcodeIndex
+{
+protected:
+    /// Number of the block of each F and X value, plus one, or 0 if missing
+    std::vector<uint16_t> m_fx;
+
+    /// Blocks of 256 positions indexed by Y, plus one, or 0 if missing
+    std::vector<uint32_t> m_blocks;
+
+public:
+    /// Value returned by find() for varcodes that are not in the index
+    static constexpr unsigned missing = (unsigned)-1;
+
+    VarcodeIndex() : m_fx(256, 0) {}
+
+    /// Record that the entry for \a code is at position \a pos
+    void add(Varcode code, unsigned pos)
+    {
+        uint16_t& block = m_fx[code >> 8];
+        if (!block)
+        {
+            m_blocks.resize(m_blocks.size() + 256, 0);
+            block = m_blocks.size() / 256;
+        }
+        m_blocks[(block - 1) * 256 + (code & 0xff)] = pos + 1;
+    }
+
+    /// Return the position of the entry for \a code, or missing
+    unsigned find(Varcode code) const
+    {
+        unsigned block = m_fx[code >> 8];
+        if (!block)
+            return missing;
+        // Positions are stored plus one, so that 0 wraps around to missing
+        return m_blocks[(block - 1) * 256 + (code & 0xff)] - 1;
+    }
+};
+
+} // namespace wreport
+
+#endif
@@ -1,6 +1,9 @@
 #include "vartable.h"
 #include "wreport/tests.h"
+#include <atomic>
+#include <thread>
 
+using namespace wreport;
 using namespace wreport::tests;
 
 namespace {
@@ -11,6 +14,110 @@ class Tests : public TestCase
     void register_tests() override;
 } test("internals_vartable");
 
-void Tests::register_tests() {}
+void Tests::register_tests()
+{
+    add_method("query_index", []() {
+        // Every entry is found through the index, and nothing else is
+        vartable::Bufr table(datafile("test-bufr-table.txt"));
+        for (unsigned i = 0; i < table.size; ++i)
+            wassert_true(table.query_entry(table.entries[i].code) ==
+                         &table.entries[i]);
+
+        unsigned found = 0;
+        for (unsigned code = 0; code < 0x10000; ++code)
+            if (table.contains(code))
+                ++found;
+        wassert(actual(found) == table.size);
+
+        wassert_false(table.contains(WR_VAR(0, 63, 255)));
+        wassert_false(table.contains(WR_VAR(3, 1, 6)));
+        wassert_true(table.query_entry(WR_VAR(0, 0, 0)) == nullptr);
+    });
+
+    add_method("query_altered", []() {
+        vartable::Bufr table(datafile("test-bufr-table.txt"));
+        Varinfo orig = table.query(WR_VAR(0, 1, 6));
+
+        // Asking for the unaltered values returns the original entry
+        wassert_true(table.query_altered(WR_VAR(0, 1, 6), orig->scale,
+                                         orig->bit_len,
+                                         orig->bit_ref) == orig);
+
+        Varinfo alt1 = table.query_altered(WR_VAR(0, 1, 6), 0, 128, 0);
+        Varinfo alt2 = table.query_altered(WR_VAR(0, 1, 6), 0, 256, 0);
+        wassert(actual(alt1->bit_len) == 128u);
+        wassert(actual(alt2->bit_len) == 256u);
+        wassert_true(table.query_altered(WR_VAR(0, 1, 6), 0, 128, 0) == alt1);
+        wassert_true(table.query_altered(WR_VAR(0, 1, 6), 0, 256, 0) == alt2);
+        wassert_true(table.query(WR_VAR(0, 1, 6)) == orig);
+
+        // Alterations are listed by iterate
+        unsigned count = 0;
+        table.iterate([&](Varinfo info) noexcept {
+            if (info->code == WR_VAR(0, 1, 6))
+                ++count;
+            return true;
+        });
+        wassert(actual(count) == 3u);
+    });
+
+    add_method("query_altered_concurrent", []() {
+        // Create the same alterations from many threads at the same time
+        vartable::Bufr table(datafile("test-bufr-table.txt"));
+        const unsigned thread_count = 8;
+        const unsigned alt_count    = 64;
+        std::vector<std::vector<Varinfo>> results(thread_count);
+        std::vector<std::string> errors(thread_count);
+        std::atomic<bool> start(false);
+
+        std::vector<std::thread> threads;
+        for (unsigned t = 0; t < thread_count; ++t)
+            threads.emplace_back([&, t] {
+                while (!start.load())
+                    std::this_thread::yield();
+                try
+                {
+                    results[t].resize(alt_count);
+                    // Each thread goes through the alterations in a
+                    // different order
+                    for (unsigned i = 0; i < alt_count; ++i)
+                    {
+                        unsigned a    = (i * 7 + t * 13) % alt_count;
+                        results[t][a] = table.query_altered(
+                            WR_VAR(0, 1, 1), a % 4, 8 + a / 4, 0);
+                    }
+                }
+                catch (std::exception& e)
+                {
+                    errors[t] = e.what();
+                }
+            });
+        start.store(true);
+        for (auto& t : threads)
+            t.join();
+
+        for (unsigned t = 0; t < thread_count; ++t)
+        {
+            WREPORT_TEST_INFO(info);
+            info() << "thread " << t;
+            wassert(actual(errors[t]) == "");
+            for (unsigned a = 0; a < alt_count; ++a)
+            {
+                wassert_true(results[t][a] == results[0][a]);
+                wassert(actual(results[t][a]->scale) == (int)(a % 4));
+                wassert(actual(results[t][a]->bit_len) == 8 + a / 4);
+            }
+        }
+
+        // Each alteration has been added only once
+        unsigned count = 0;
+        table.iterate([&](Varinfo info) noexcept {
+            if (info->code == WR_VAR(0, 1, 1))
+                ++count;
+            return true;
+        });
+        wassert(actual(count) == alt_count + 1);
+    });
+}
 
 } // namespace
@@ -60,72 +60,90 @@ static void read_space_padded(char* dest, const char* src, size_t len)
 
 namespace wreport::vartable {
 
-Entry::Entry(const Entry& other, int new_scale, unsigned new_bit_len,
-             int new_bit_ref)
-    : varinfo(other.varinfo), alterations(other.alterations)
+Alteration::Alteration(const _Varinfo& orig, int new_scale,
+                       unsigned new_bit_len, int new_bit_ref)
+    : varinfo(orig)
 {
-#if 0
-        fprintf(stderr, "Before alteration(w:%d,s:%d): bl %d len %d scale %d\n",
-                WR_ALT_WIDTH(change), WR_ALT_SCALE(change),
-                i->bit_len, i->len, i->scale);
-#endif
-
     // Apply the alterations
     varinfo::set_bufr(varinfo, varinfo.code, varinfo.desc, varinfo.unit,
                       new_bit_len, new_bit_ref, new_scale);
-
-#if 0
-        fprintf(stderr, "After alteration(w:%d,s:%d): bl %d len %d scale %d\n",
-                WR_ALT_WIDTH(change), WR_ALT_SCALE(change),
-                i->bit_len, i->len, i->scale);
-#endif
 }
 
-const Entry* Entry::get_alteration(int new_scale, unsigned new_bit_len,
+const Alteration* Alteration::find(int new_scale, unsigned new_bit_len,
                                    int new_bit_ref) const
 {
-    if (varinfo.scale == new_scale && varinfo.bit_len == new_bit_len &&
-        varinfo.bit_ref == new_bit_ref)
-        return this;
-    if (alterations == nullptr)
-        return nullptr;
-    return alterations->get_alteration(new_scale, new_bit_len, new_bit_ref);
+    const Alteration* e = this;
+    while (e)
+    {
+        if (e->varinfo.scale == new_scale &&
+            e->varinfo.bit_len == new_bit_len &&
+            e->varinfo.bit_ref == new_bit_ref)
+            return e;
+        e = e->next.load(std::memory_order_acquire);
+    }
+    return nullptr;
 }
 
 Base::Base(const std::filesystem::path& pathname) : m_pathname(pathname) {}
 
+Base::~Base()
+{
+    // Alterations are owned by the table
+    for (unsigned i = 0; i < size; ++i)
+    {
+        Alteration* e = alterations[i].load();
+        while (e)
+        {
+            Alteration* next = e->next.load();
+            delete e;
+            e = next;
+        }
+    }
+}
+
+void Base::set_entries(const _Varinfo* entries, unsigned count)
+{
+    this->entries = entries;
+    size          = count;
+    alterations   = std::make_unique<std::atomic<Alteration*>[]>(count);
+    for (unsigned i = 0; i < count; ++i)
+        index.add(entries[i].code, i);
+}
+
+bool Base::load_compiled(unsigned section)
+{
+    const uint32_t record_sizes[tablecache::section_count] = {
+        sizeof(_Varinfo), sizeof(_Varinfo)};
+    if (!m_compiled.open(m_pathname, tablecache::Kind::B, record_sizes,
+                         compiled_layout))
+        return false;
+    set_entries(m_compiled.records<_Varinfo>(section),
+                m_compiled.count(section));
+    return true;
+}
+
 _Varinfo* Base::obtain(unsigned line_no, Varcode code)
 {
     // Ensure that we are creating an ordered table
-    if (!entries.empty() && entries.back().varinfo.code >= code)
+    if (!m_parsed.empty() && m_parsed.back().code >= code)
         throw error_parse(m_pathname.c_str(), line_no,
                           "input file is not sorted");
 
-    // Append a new entry;
-    entries.emplace_back(Entry());
-    _Varinfo* entry = &entries.back().varinfo;
+    // Append a new entry, zero-initialized so that compiled tables have no
+    // uninitialized padding
+    m_parsed.emplace_back(_Varinfo());
+    _Varinfo* entry = &m_parsed.back();
     entry->code     = code;
     return entry;
 }
 
-const Entry* Base::query_entry(Varcode code) const
+const _Varinfo* Base::query_entry(Varcode code) const
 {
-    int begin, end;
-
-    // Binary search
-    begin = -1, end = static_cast<int>(entries.size());
-    while (end - begin > 1)
-    {
-        int cur = (end + begin) / 2;
-        if (entries[cur].varinfo.code > code)
-            end = cur;
-        else
-            begin = cur;
-    }
-    if (begin == -1 || entries[begin].varinfo.code != code)
+    unsigned pos = index.find(code);
+    if (pos == VarcodeIndex::missing)
         return nullptr;
     else
-        return &entries[begin];
+        return &entries[pos];
 }
 
 Varinfo Base::query(Varcode code) const
@@ -136,7 +154,7 @@ Varinfo Base::query(Varcode code) const
                                WR_VAR_F(code), WR_VAR_X(code), WR_VAR_Y(code),
                                m_pathname.c_str());
     else
-        return &(e->varinfo);
+        return e;
 }
 
 bool Base::contains(Varcode code) const { return query_entry(code) != nullptr; }
@@ -145,18 +163,24 @@ Varinfo Base::query_altered(Varcode code, int new_scale, unsigned new_bit_len,
                             int new_bit_ref) const
 {
     // Get the normal variable
-    const Entry* start = query_entry(code);
-    if (!start)
+    unsigned pos = index.find(code);
+    if (pos == VarcodeIndex::missing)
         error_notfound::throwf("variable %d%02d%03d not found in table %s",
                                WR_VAR_FXY(code), m_pathname.c_str());
+    const _Varinfo& start = entries[pos];
+    if (start.scale == new_scale && start.bit_len == new_bit_len &&
+        start.bit_ref == new_bit_ref)
+        return &start;
 
     // Look for an existing alteration
-    const Entry* alt =
-        start->get_alteration(new_scale, new_bit_len, new_bit_ref);
-    if (alt)
-        return &(alt->varinfo);
-
-    switch (start->varinfo.type)
+    std::atomic<Alteration*>& chain = alterations[pos];
+    Alteration* head                = chain.load(std::memory_order_acquire);
+    if (head)
+        if (const Alteration* alt =
+                head->find(new_scale, new_bit_len, new_bit_ref))
+            return &(alt->varinfo);
+
+    switch (start.type)
     {
         case Vartype::Integer:
         case Vartype::Decimal:
@@ -176,27 +200,50 @@ Varinfo Base::query_altered(Varcode code, int new_scale, unsigned new_bit_len,
     }
 
     // Not found: we need to create it, duplicating the original varinfo
-    std::unique_ptr<Entry> newvi(
-        new Entry(*start, new_scale, new_bit_len, new_bit_ref));
+    std::unique_ptr<Alteration> newvi(
+        new Alteration(start, new_scale, new_bit_len, new_bit_ref));
 
-    // Add the new alteration as the first alteration in the list after the
-    // original value
-    start->alterations = newvi.release();
+    // Add the new alteration as the first of the chain. Other threads may be
+    // doing the same at the same time
+    while (true)
+    {
+        newvi->next.store(head, std::memory_order_relaxed);
+        if (chain.compare_exchange_weak(head, newvi.get(),
+                                        std::memory_order_release,
+                                        std::memory_order_acquire))
+            break;
+
+        // The chain has changed: if another thread has just added the same
+        // alteration, use that one
+        if (head)
+            if (const Alteration* found =
+                    head->find(new_scale, new_bit_len, new_bit_ref))
+                return &(found->varinfo);
+    }
 
-    return &(start->alterations->varinfo);
+    return &(newvi.release()->varinfo);
 }
 
 bool Base::iterate(std::function<bool(Varinfo)> dest) const
 {
-    for (const auto& entry : entries)
-        for (const Entry* e = &entry; e; e = e->alterations)
+    for (unsigned i = 0; i < size; ++i)
+    {
+        if (!dest(&entries[i]))
+            return false;
+        for (const Alteration* e = alterations[i].load(); e;
+             e = e->next.load())
             if (!dest(&(e->varinfo)))
                 return false;
+    }
     return true;
 }
 
-Bufr::Bufr(const std::filesystem::path& pathname) : Base(pathname)
+Bufr::Bufr(const std::filesystem::path& pathname, bool use_compiled)
+    : Base(pathname)
 {
+    if (use_compiled && load_compiled(0))
+        return;
+
     FILE* in = fopen(pathname.c_str(), "rt");
     if (!in)
         error_system::throwf("cannot open BUFR table file %s",
@@ -236,10 +283,24 @@ Bufr::Bufr(const std::filesystem::path& pathname) : Base(pathname)
                           // scale
                           static_cast<int>(getnumber(line + 98)));
     }
+
+    set_entries(m_parsed.data(), static_cast<unsigned>(m_parsed.size()));
 }
 
-Crex::Crex(const std::filesystem::path& pathname) : Base(pathname)
+Crex::Crex(const std::filesystem::path& pathname, bool use_compiled)
+    : Base(pathname)
 {
+    if (use_compiled && load_compiled(1))
+    {
+        // Compiled tables have an empty CREX section if the text version has
+        // no CREX information
+        if (!size)
+            error_consistency::throwf(
+                "%s: table does not contain any CREX information",
+                pathname.c_str());
+        return;
+    }
+
     FILE* in = fopen(pathname.c_str(), "rt");
     if (!in)
         error_system::throwf("cannot open CREX table file %s",
@@ -282,6 +343,8 @@ Crex::Crex(const std::filesystem::path& pathname) : Base(pathname)
         error_consistency::throwf(
             "%s: table does not contain any CREX information",
             pathname.c_str());
+
+    set_entries(m_parsed.data(), static_cast<unsigned>(m_parsed.size()));
 }
 
 } // namespace wreport::vartable
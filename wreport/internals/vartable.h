@@ -1,51 +1,59 @@
 #ifndef WREPORT_INTERNALS_VARTABLE_H
 #define WREPORT_INTERNALS_VARTABLE_H
 
+#include <atomic>
+#include <cstddef>
 #include <filesystem>
+#include <memory>
 #include <string>
+#include <vector>
 #include <wreport/fwd.h>
+#include <wreport/internals/tablecache.h>
+#include <wreport/internals/varcode_index.h>
 #include <wreport/varinfo.h>
 #include <wreport/vartable.h>
 
 namespace wreport::vartable {
 
-struct Entry
+/// Layout of the _Varinfo records stored in compiled B tables
+constexpr uint64_t compiled_layout = tablecache::layout_fingerprint({
+    sizeof(_Varinfo),
+    offsetof(_Varinfo, code), sizeof(_Varinfo::code),
+    offsetof(_Varinfo, type), sizeof(_Varinfo::type),
+    offsetof(_Varinfo, desc), sizeof(_Varinfo::desc),
+    offsetof(_Varinfo, unit), sizeof(_Varinfo::unit),
+    offsetof(_Varinfo, scale), sizeof(_Varinfo::scale),
+    offsetof(_Varinfo, len), sizeof(_Varinfo::len),
+    offsetof(_Varinfo, bit_ref), sizeof(_Varinfo::bit_ref),
+    offsetof(_Varinfo, bit_len), sizeof(_Varinfo::bit_len),
+    offsetof(_Varinfo, imin), sizeof(_Varinfo::imin),
+    offsetof(_Varinfo, imax), sizeof(_Varinfo::imax),
+    offsetof(_Varinfo, dmin), sizeof(_Varinfo::dmin),
+    offsetof(_Varinfo, dmax), sizeof(_Varinfo::dmax),
+});
+
+/// Altered version of a B table entry
+struct Alteration
 {
-    /**
-     * Master Varinfo structure for this entry.
-     *
-     * A point to this will be given out and shared by all the code that needs
-     * to refer to informations about this variable.
-     */
+    /// Varinfo with the alterations applied
     _Varinfo varinfo;
 
-    /**
-     * Altered versions of this Varinfo.
-     *
-     * BUFR messages can trasmit variables encoded with variations of standard
-     * BUFR/CREX B table entries, by overriding reference codes or bit lengths.
-     *
-     * Altered versions of a Varinfo are stored in this chain. The first
-     * element of the chain is always the original Varinfo defined in the B
-     * table.
-     */
-    mutable Entry* alterations = nullptr;
-
-    Entry() = default;
+    /// Next alteration of the same entry, or nullptr
+    std::atomic<Alteration*> next{nullptr};
 
     /**
-     * Build an altered entry created for BUFR table C modifiers
+     * Build an alteration of \a orig created for BUFR table C modifiers
      */
-    Entry(const Entry& other, int new_scale, unsigned new_bit_len,
-          int new_bit_ref);
+    Alteration(const _Varinfo& orig, int new_scale, unsigned new_bit_len,
+               int new_bit_ref);
 
     /**
-     * Search for this alteration in the alteration chain.
+     * Search for this alteration in the alteration chain starting here.
      *
      * Returns nullptr if it was not found
      */
-    const Entry* get_alteration(int new_scale, unsigned new_bit_len,
-                                int new_bit_ref) const;
+    const Alteration* find(int new_scale, unsigned new_bit_len,
+                           int new_bit_ref) const;
 };
 
 /// Base Vartable implementation
@@ -55,28 +63,69 @@ protected:
     /// Pathname to the file from which this vartable has been loaded
     std::filesystem::path m_pathname;
 
-public:
     /**
-     * Entries in this Vartable.
-     *
-     * The entries are sorted by varcode, so that we can look them up by binary
-     * search.
+     * Entries parsed from the text version of the table.
      *
      * Since we are handing out pointers to _Varinfo structures inside the
      * vector, those pointers will be invalidated if a vector reallocation gets
      * triggered. This means that once the table has been loaded, it size cannot
      * be changed anymore.
      */
-    std::vector<Entry> entries;
+    std::vector<_Varinfo> m_parsed;
+
+    /// Compiled version of the table, when it is used instead of the text one
+    tablecache::Compiled m_compiled;
+
+    /// Use \a count entries starting at \a entries as the table contents
+    void set_entries(const _Varinfo* entries, unsigned count);
+
+    /**
+     * Use section \a section of the compiled version of the table, if it is
+     * available and up to date.
+     *
+     * Returns false if the text version needs to be parsed instead.
+     */
+    bool load_compiled(unsigned section);
+
+public:
+    /**
+     * Entries in this Vartable, sorted by varcode and indexed by \a index.
+     *
+     * They point either to the parsed text version of the table, or to its
+     * memory mapped compiled version.
+     */
+    const _Varinfo* entries = nullptr;
+
+    /// Number of entries in \a entries
+    unsigned size = 0;
+
+    /**
+     * Altered versions of each entry.
+     *
+     * BUFR messages can trasmit variables encoded with variations of standard
+     * BUFR/CREX B table entries, by overriding reference codes or bit lengths.
+     *
+     * Each element is the head of the chain of altered versions of the entry
+     * at the same position in \a entries.
+     *
+     * New alterations are atomically prepended to the chain, and are never
+     * removed or modified after they have been published, so that the chain
+     * can be walked and extended concurrently by multiple threads.
+     */
+    std::unique_ptr<std::atomic<Alteration*>[]> alterations;
+
+    /// Position of each entry in \a entries, indexed by varcode
+    VarcodeIndex index;
 
     explicit Base(const std::filesystem::path& pathname);
+    ~Base() override;
 
     std::string pathname() const override { return m_pathname; }
 
     std::filesystem::path path() const override { return m_pathname; }
 
     _Varinfo* obtain(unsigned line_no, Varcode code);
-    const Entry* query_entry(Varcode code) const;
+    const _Varinfo* query_entry(Varcode code) const;
     Varinfo query(Varcode code) const override;
     bool contains(Varcode code) const override;
     Varinfo query_altered(Varcode code, int new_scale, unsigned new_bit_len,
@@ -86,14 +135,26 @@ public:
 
 struct Bufr : public Base
 {
-    /// Create and load a BUFR B table
-    explicit Bufr(const std::filesystem::path& pathname);
+    /**
+     * Create and load a BUFR B table.
+     *
+     * If \a use_compiled is true, use the compiled version of the table if it
+     * is available and up to date.
+     */
+    explicit Bufr(const std::filesystem::path& pathname,
+                  bool use_compiled = true);
 };
 
 struct Crex : public Base
 {
-    /// Create and load a CREX B table
-    explicit Crex(const std::filesystem::path& pathname);
+    /**
+     * Create and load a CREX B table.
+     *
+     * If \a use_compiled is true, use the compiled version of the table if it
+     * is available and up to date.
+     */
+    explicit Crex(const std::filesystem::path& pathname,
+                  bool use_compiled = true);
 };
 
 } // namespace wreport::vartable
@@ -17,8 +17,6 @@ struct null_streambuf : public std::streambuf
 };
 
 thread_local ostream* target = 0;
-null_streambuf* null_sb      = 0;
-ostream* null_stream         = 0;
 
 void set_target(std::ostream& out) { target = &out; }
 
@@ -32,13 +30,11 @@ std::ostream& log() throw()
     if (target)
         return *target;
 
-    // If there is no target, return an ostream that discards all data
-    if (!null_sb)
-    {
-        null_sb     = new null_streambuf;
-        null_stream = new ostream(null_sb);
-    }
-    return *null_stream;
+    // If there is no target, return an ostream that discards all data. It is
+    // per-thread, since the stream state is modified by writing to it
+    thread_local null_streambuf null_sb;
+    thread_local ostream null_stream(&null_sb);
+    return null_stream;
 }
 
 void logf(const char* fmt, ...)
@@ -0,0 +1,265 @@
+#include "bulletin.h"
+#include "scanner.h"
+#include "tests.h"
+#include <cstdio>
+
+using namespace wreport;
+using namespace wreport::tests;
+using namespace std;
+
+namespace {
+
+/// Read all messages in a file with Bulletin::read
+template <typename Bltn>
+void read_all(const std::filesystem::path& pathname,
+              std::vector<off_t>& offsets, std::vector<std::string>& messages,
+              std::string& error)
+{
+    FILE* in = fopen(pathname.c_str(), "rb");
+    if (!in)
+        throw error_system("cannot open " + pathname.string());
+    std::string buf;
+    off_t offset;
+    try
+    {
+        while (Bltn::read(in, buf, pathname.c_str(), &offset))
+        {
+            offsets.push_back(offset);
+            messages.push_back(buf);
+        }
+    }
+    catch (std::exception& e)
+    {
+        error = e.what();
+    }
+    fclose(in);
+}
+
+/// Compare FileScanner results with those of Bulletin::read
+template <typename Bltn>
+void compare_with_read(const std::filesystem::path& pathname,
+                       bool (FileScanner::*next)(ScannedMessage&))
+{
+    std::vector<off_t> offsets;
+    std::vector<std::string> messages;
+    std::string error;
+    read_all<Bltn>(pathname, offsets, messages, error);
+
+    FileScanner scanner(pathname);
+    ScannedMessage msg;
+    for (size_t i = 0; i < messages.size(); ++i)
+    {
+        wassert_true((scanner.*next)(msg));
+        wassert(actual(msg.offset) == (size_t)offsets[i]);
+        wassert(actual(std::string((const char*)msg.data, msg.size)) ==
+                messages[i]);
+    }
+    if (error.empty())
+        wassert_false((scanner.*next)(msg));
+    else
+    {
+        // The scanner fails where read fails
+        bool failed = false;
+        try
+        {
+            (scanner.*next)(msg);
+        }
+        catch (wreport::error&)
+        {
+            failed = true;
+        }
+        wassert_true(failed);
+    }
+}
+
+/**
+ * Compare StreamScanner results with those of FileScanner, feeding the file in
+ * chunks of different sizes
+ */
+void compare_stream_with_scanner(const std::filesystem::path& pathname,
+                                 StreamScanner::Format format)
+{
+    FileScanner scanner(pathname);
+    std::vector<ScannedMessage> expected;
+    ScannedMessage msg;
+    try
+    {
+        while (format == StreamScanner::BUFR ? scanner.next_bufr(msg)
+                                             : scanner.next_crex(msg))
+            expected.push_back(msg);
+    }
+    catch (wreport::error&)
+    {
+        // Streams cannot resynchronise in the same way after errors
+        return;
+    }
+
+    for (size_t chunk_size : {(size_t)1, (size_t)3, (size_t)7, (size_t)4096,
+                              scanner.size()})
+    {
+        WREPORT_TEST_INFO(info);
+        info() << "chunk size " << chunk_size;
+
+        std::vector<size_t> offsets;
+        std::vector<std::string> messages;
+        StreamScanner stream(format, [&](const ScannedMessage& msg) {
+            offsets.push_back(msg.offset);
+            messages.emplace_back((const char*)msg.data, msg.size);
+        });
+        for (size_t pos = 0; pos < scanner.size(); pos += chunk_size)
+            stream.feed(scanner.data() + pos,
+                        std::min(chunk_size, scanner.size() - pos));
+        wassert(stream.finish());
+
+        wassert(actual(messages.size()) == expected.size());
+        for (size_t i = 0; i < expected.size(); ++i)
+        {
+            wassert(actual(offsets[i]) == expected[i].offset);
+            wassert(actual(messages[i]) ==
+                    std::string((const char*)expected[i].data,
+                                expected[i].size));
+        }
+    }
+}
+
+class Tests : public TestCase
+{
+    using TestCase::TestCase;
+
+    void register_tests() override
+    {
+        add_method("bufr", []() {
+            for (const auto& fname : all_test_files("bufr"))
+            {
+                WREPORT_TEST_INFO(info);
+                info() << fname;
+                wassert(compare_with_read<BufrBulletin>(
+                    datafile(fname), &FileScanner::next_bufr));
+            }
+        });
+
+        add_method("crex", []() {
+            for (const auto& fname : all_test_files("crex"))
+            {
+                WREPORT_TEST_INFO(info);
+                info() << fname;
+                wassert(compare_with_read<CrexBulletin>(
+                    datafile(fname), &FileScanner::next_crex));
+            }
+        });
+
+        add_method("scan_bufr", []() {
+            std::string msg     = slurpfile("bufr/obs0-1.22.bufr");
+            std::string buf     = "garbage" + msg + "BUFR" + msg +
+                              std::string("BUFR\0\0", 6);
+            const uint8_t* data = (const uint8_t*)buf.data();
+
+            size_t pos = 0;
+            ScannedMessage scanned;
+            wassert_true(
+                FileScanner::scan_bufr(data, buf.size(), pos, scanned));
+            wassert(actual(scanned.offset) == 7u);
+            wassert(actual(scanned.size) == msg.size());
+            wassert_true(scanned.data == data + 7);
+            wassert(actual(pos) == 7 + msg.size());
+
+            // The stray "BUFR" is followed by an invalid length: scanning
+            // resumes after its signature
+            wassert_throws(error_consistency,
+                           FileScanner::scan_bufr(data, buf.size(), pos,
+                                                  scanned));
+            wassert(actual(pos) == 7 + msg.size() + 4);
+            wassert_true(
+                FileScanner::scan_bufr(data, buf.size(), pos, scanned));
+            wassert(actual(scanned.offset) == 7 + msg.size() + 4);
+
+            // Truncated message at the end
+            wassert_throws(error_consistency,
+                           FileScanner::scan_bufr(data, buf.size(), pos,
+                                                  scanned));
+            wassert_false(
+                FileScanner::scan_bufr(data, buf.size(), pos, scanned));
+            wassert(actual(pos) == buf.size());
+
+            // Decoding from the scanned buffer gives the same results as
+            // decoding from a string
+            auto decoded  = BufrBulletin::decode(scanned.data, scanned.size);
+            auto expected = BufrBulletin::decode(msg);
+            wassert(actual(decoded->diff(*expected)) == 0u);
+        });
+
+        add_method("stream_bufr", []() {
+            for (const auto& fname : all_test_files("bufr"))
+            {
+                WREPORT_TEST_INFO(info);
+                info() << fname;
+                wassert(compare_stream_with_scanner(datafile(fname),
+                                                    StreamScanner::BUFR));
+            }
+        });
+
+        add_method("stream_crex", []() {
+            for (const auto& fname : all_test_files("crex"))
+            {
+                WREPORT_TEST_INFO(info);
+                info() << fname;
+                wassert(compare_stream_with_scanner(datafile(fname),
+                                                    StreamScanner::CREX));
+            }
+        });
+
+        add_method("stream", []() {
+            std::string msg = slurpfile("bufr/obs0-1.22.bufr");
+            std::string buf =
+                "garbage" + msg + std::string("BUFR\0\0\3", 7) + msg;
+
+            std::vector<ScannedMessage> found;
+            std::vector<std::string> contents;
+            StreamScanner stream(StreamScanner::BUFR,
+                                 [&](const ScannedMessage& scanned) {
+                                     found.push_back(scanned);
+                                     contents.emplace_back(
+                                         (const char*)scanned.data,
+                                         scanned.size);
+                                 });
+
+            // The first message is passed without copying it
+            stream.feed(buf.data(), 7 + msg.size() + 10);
+            wassert(actual(found.size()) == 1u);
+            wassert(actual(found[0].offset) == 7u);
+            wassert_true(found[0].data == (const uint8_t*)buf.data() + 7);
+            // The start of the next signature is matched, but not buffered
+            wassert(actual(stream.buffered()) == 0u);
+
+            // The second message, after a signature with an invalid length,
+            // is split across chunks
+            stream.feed(buf.data() + 7 + msg.size() + 10, 10);
+            wassert(actual(stream.buffered()) == 13u);
+            stream.feed(buf.data() + 7 + msg.size() + 20,
+                        buf.size() - 7 - msg.size() - 20);
+            wassert(actual(found.size()) == 2u);
+            wassert(actual(found[1].offset) == 7 + msg.size() + 7);
+            wassert(actual(contents[1]) == msg);
+            wassert(actual(stream.buffered()) == 0u);
+            wassert(actual(stream.tell()) == buf.size());
+
+            // Truncated message at the end of the stream
+            stream.feed(msg.data(), 20);
+            wassert(actual(stream.buffered()) == 20u);
+            wassert_throws(error_consistency, stream.finish());
+            wassert(actual(stream.buffered()) == 0u);
+            wassert(actual(stream.tell()) == 0u);
+        });
+
+        add_method("empty", []() {
+            sys::Tempfile tf;
+            FileScanner scanner(tf.path());
+            wassert(actual(scanner.size()) == 0u);
+            ScannedMessage msg;
+            wassert_false(scanner.next_bufr(msg));
+            wassert_false(scanner.next_crex(msg));
+        });
+    }
+} test("scanner");
+
+} // namespace
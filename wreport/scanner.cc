@@ -0,0 +1,395 @@
+#include "scanner.h"
+#include "error.h"
+#include <algorithm>
+#include <cstring>
+#include <sys/mman.h>
+
+namespace wreport {
+
+namespace {
+
+/**
+ * Find \a sig in \a buf starting from \a pos.
+ *
+ * Returns the offset of the signature, or \a size if it was not found.
+ */
+size_t find_signature(const uint8_t* buf, size_t size, size_t pos,
+                      const char* sig, size_t sig_len)
+{
+    if (pos >= size)
+        return size;
+    const void* res = memmem(buf + pos, size - pos, sig, sig_len);
+    if (!res)
+        return size;
+    return static_cast<const uint8_t*>(res) - buf;
+}
+
+/// Memory map a file for reading
+sys::MMap map_file(const std::filesystem::path& path)
+{
+    sys::File in(path, O_RDONLY);
+    struct stat st;
+    in.fstat(st);
+    // Empty files cannot be mapped
+    if (st.st_size == 0)
+        return sys::MMap(MAP_FAILED, 0);
+    sys::MMap res = in.mmap(st.st_size, PROT_READ, MAP_PRIVATE);
+    // Messages are usually read sequentially
+    madvise(res, res.size(), MADV_SEQUENTIAL);
+    return res;
+}
+
+} // namespace
+
+FileScanner::FileScanner(const std::filesystem::path& path)
+    : m_pathname(path), m_map(map_file(path))
+{
+    m_size = m_map.size();
+    if (m_size)
+        m_data = m_map;
+}
+
+FileScanner::~FileScanner() {}
+
+bool FileScanner::next_bufr(ScannedMessage& msg)
+{
+    return scan_bufr(m_data, m_size, m_pos, msg, m_pathname.c_str());
+}
+
+bool FileScanner::next_crex(ScannedMessage& msg)
+{
+    return scan_crex(m_data, m_size, m_pos, msg, m_pathname.c_str());
+}
+
+bool FileScanner::scan_bufr(const uint8_t* buf, size_t size, size_t& pos,
+                            ScannedMessage& msg, const char* fname)
+{
+    /// A BUFR message starts with "BUFR", then the message length encoded in 3
+    /// bytes
+    size_t start = find_signature(buf, size, pos, "BUFR", 4);
+    if (start == size)
+    {
+        pos = size;
+        return false;
+    }
+
+    // From now on, errors resume scanning after this signature
+    pos = start + 4;
+
+    if (start + 8 > size)
+    {
+        if (fname)
+            error_consistency::throwf(
+                "cannot read BUFR section 0 from %s: end of file reached",
+                fname);
+        else
+            throw error_consistency(
+                "cannot read BUFR section 0: end of file reached");
+    }
+
+    // Read the message length
+    size_t bufrlen = ((size_t)buf[start + 4] << 16) |
+                     ((size_t)buf[start + 5] << 8) | buf[start + 6];
+    if (bufrlen < 12)
+    {
+        if (fname)
+            error_consistency::throwf(
+                "%s: the size declared by the BUFR message (%zu) is less than "
+                "the minimum of 12",
+                fname, bufrlen);
+        else
+            error_consistency::throwf("the size declared by the BUFR message "
+                                      "(%zu) is less than the minimum of 12",
+                                      bufrlen);
+    }
+
+    if (bufrlen > size - start)
+    {
+        if (fname)
+            error_consistency::throwf(
+                "cannot read BUFR message from %s: end of file reached",
+                fname);
+        else
+            throw error_consistency(
+                "cannot read BUFR message: end of file reached");
+    }
+
+    msg.offset = start;
+    msg.size   = bufrlen;
+    msg.data   = buf + start;
+    pos        = start + bufrlen;
+    return true;
+}
+
+bool FileScanner::scan_crex(const uint8_t* buf, size_t size, size_t& pos,
+                            ScannedMessage& msg, const char* fname)
+{
+    /*
+     * A CREX message starts with "CREX++" and ends with "++\r\r\n7777".
+     * Ideally any combination of \r and \n should be supported.
+     */
+    size_t start = find_signature(buf, size, pos, "CREX++", 6);
+    if (start == size)
+    {
+        pos = size;
+        return false;
+    }
+
+    // Look for "\+\+(\r|\n)+7777", with the same logic as CrexBulletin::read
+    const char* target           = "++\r\n7777";
+    static const int target_size = 8;
+    int got                      = 0;
+    size_t cur                   = start + 6;
+    while (got < target_size && cur < size)
+    {
+        uint8_t c = buf[cur++];
+        if (target[got] == '\r' && (c == '\n' || c == '\r'))
+            got++;
+        else if (target[got] == '\n' && (c == '\n' || c == '\r'))
+            ;
+        else if (target[got] == '\n' && c == '7')
+            got += 2;
+        else if (c == target[got])
+            got++;
+        else
+            got = 0;
+    }
+
+    if (got != target_size)
+    {
+        pos = start + 6;
+        throw error_parse(fname ? fname : "(unknown)", static_cast<int>(cur),
+                          "CREX message is incomplete");
+    }
+
+    msg.offset = start;
+    msg.size   = cur - start;
+    msg.data   = buf + start;
+    pos        = cur;
+    return true;
+}
+
+StreamScanner::StreamScanner(Format format, Callback callback)
+    : m_format(format), m_callback(callback)
+{
+}
+
+StreamScanner::~StreamScanner() {}
+
+bool StreamScanner::find_start(const uint8_t* data, size_t size, size_t& pos)
+{
+    const char* sig  = m_format == BUFR ? "BUFR" : "CREX++";
+    unsigned sig_len = m_format == BUFR ? 4 : 6;
+    while (pos < size)
+    {
+        if (m_sig_match == 0)
+        {
+            const void* found = memchr(data + pos, sig[0], size - pos);
+            if (!found)
+            {
+                pos = size;
+                return false;
+            }
+            pos         = static_cast<const uint8_t*>(found) - data + 1;
+            m_sig_match = 1;
+        }
+        else if (data[pos] == sig[m_sig_match])
+        {
+            ++pos;
+            if (++m_sig_match == sig_len)
+            {
+                m_sig_match = 0;
+                return true;
+            }
+        }
+        else
+            // Check the same byte again as the start of a signature: no
+            // signature has a prefix that is also a suffix
+            m_sig_match = 0;
+    }
+    return false;
+}
+
+bool StreamScanner::find_crex_end(const uint8_t* data, size_t size,
+                                  size_t& pos)
+{
+    // Look for "\+\+(\r|\n)+7777", with the same logic as scan_crex
+    const char* target           = "++\r\n7777";
+    static const int target_size = 8;
+    while (m_end_match < target_size && pos < size)
+    {
+        uint8_t c = data[pos++];
+        if (target[m_end_match] == '\r' && (c == '\n' || c == '\r'))
+            m_end_match++;
+        else if (target[m_end_match] == '\n' && (c == '\n' || c == '\r'))
+            ;
+        else if (target[m_end_match] == '\n' && c == '7')
+            m_end_match += 2;
+        else if (c == target[m_end_match])
+            m_end_match++;
+        else
+            m_end_match = 0;
+    }
+    if (m_end_match < target_size)
+        return false;
+    m_end_match = 0;
+    return true;
+}
+
+size_t StreamScanner::bufr_size(const uint8_t* sec0)
+{
+    size_t res = ((size_t)sec0[4] << 16) | ((size_t)sec0[5] << 8) | sec0[6];
+    // A BUFR message cannot be smaller than 12 bytes. The length bytes of a
+    // signature rejected here cannot contain the start of another signature
+    return res < 12 ? 0 : res;
+}
+
+size_t StreamScanner::scan_message(const uint8_t* data, size_t size,
+                                   size_t start, size_t pos, size_t base)
+{
+    // Pass messages entirely contained in the chunk without copying them
+    size_t end = 0;
+    if (m_format == BUFR)
+    {
+        if (start + 7 <= size)
+        {
+            size_t len = bufr_size(data + start);
+            if (!len)
+                return pos;
+            if (len <= size - start)
+                end = start + len;
+        }
+    }
+    else
+    {
+        size_t cur = pos;
+        if (find_crex_end(data, size, cur))
+            end = cur;
+    }
+
+    if (end)
+    {
+        ScannedMessage msg;
+        msg.offset = base + start;
+        msg.size   = end - start;
+        msg.data   = data + start;
+        m_callback(msg);
+        return end;
+    }
+
+    // The message continues in the next chunks
+    m_msg_offset = base + start;
+    m_buf.assign(reinterpret_cast<const char*>(data) + start, size - start);
+    m_in_message = true;
+    return size;
+}
+
+size_t StreamScanner::continue_message(const uint8_t* data, size_t size,
+                                       size_t pos)
+{
+    const char* chunk = reinterpret_cast<const char*>(data);
+    if (m_format == CREX)
+    {
+        size_t end = pos;
+        bool found = find_crex_end(data, size, end);
+        m_buf.append(chunk + pos, end - pos);
+        if (found)
+            deliver_buffered();
+        return end;
+    }
+
+    // Complete section 0 up to the message length
+    if (m_buf.size() < 7)
+    {
+        size_t count = std::min(7 - m_buf.size(), size - pos);
+        m_buf.append(chunk + pos, count);
+        pos += count;
+        if (m_buf.size() < 7)
+            return pos;
+        if (!bufr_size(reinterpret_cast<const uint8_t*>(m_buf.data())))
+        {
+            // Not a message: look for the next signature
+            m_buf.clear();
+            m_in_message = false;
+            return pos;
+        }
+    }
+
+    size_t len   = bufr_size(reinterpret_cast<const uint8_t*>(m_buf.data()));
+    size_t count = std::min(len - m_buf.size(), size - pos);
+    m_buf.append(chunk + pos, count);
+    pos += count;
+    if (m_buf.size() == len)
+        deliver_buffered();
+    return pos;
+}
+
+void StreamScanner::deliver_buffered()
+{
+    ScannedMessage msg;
+    msg.offset   = m_msg_offset;
+    msg.size     = m_buf.size();
+    msg.data     = reinterpret_cast<const uint8_t*>(m_buf.data());
+    m_in_message = false;
+    try
+    {
+        m_callback(msg);
+    }
+    catch (...)
+    {
+        m_buf.clear();
+        throw;
+    }
+    m_buf.clear();
+}
+
+void StreamScanner::feed(const void* data, size_t size)
+{
+    const uint8_t* chunk = static_cast<const uint8_t*>(data);
+    size_t base          = m_offset;
+    size_t sig_len       = m_format == BUFR ? 4 : 6;
+    m_offset += size;
+
+    size_t pos = 0;
+    while (pos < size)
+    {
+        if (m_in_message)
+        {
+            pos = continue_message(chunk, size, pos);
+            continue;
+        }
+
+        if (!find_start(chunk, size, pos))
+            break;
+
+        if (pos >= sig_len)
+            pos = scan_message(chunk, size, pos - sig_len, pos, base);
+        else
+        {
+            // The signature started in a previous chunk
+            m_msg_offset = base + pos - sig_len;
+            m_buf.assign(m_format == BUFR ? "BUFR" : "CREX++", sig_len);
+            m_in_message = true;
+        }
+    }
+}
+
+void StreamScanner::finish()
+{
+    bool incomplete = m_in_message;
+    m_buf.clear();
+    m_offset     = 0;
+    m_in_message = false;
+    m_sig_match  = 0;
+    m_end_match  = 0;
+    if (!incomplete)
+        return;
+    if (m_format == BUFR)
+        throw error_consistency(
+            "cannot read BUFR message: end of stream reached");
+    else
+        throw error_consistency(
+            "cannot read CREX message: end of stream reached");
+}
+
+} // namespace wreport
@@ -0,0 +1,251 @@
+#ifndef WREPORT_SCANNER_H
+#define WREPORT_SCANNER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <wreport/utils/sys.h>
+
+namespace wreport {
+
+/// Position of an encoded message found in a memory buffer
+struct ScannedMessage
+{
+    /// Offset of the start of the message from the start of the buffer
+    size_t offset       = 0;
+    /// Length of the message in bytes
+    size_t size         = 0;
+    /// Pointer to the start of the message
+    const uint8_t* data = nullptr;
+};
+
+/**
+ * Find BUFR or CREX messages in a file, without copying them.
+ *
+ * The file is memory mapped, and each message found is returned as a pointer
+ * into the mapped memory, which remains valid for the lifetime of the
+ * scanner. The message data can be decoded directly with
+ * BufrBulletin::decode(const uint8_t*, size_t, const char*, size_t).
+ *
+ * As with BufrBulletin::read() and CrexBulletin::read(), data before and after
+ * each message is skipped.
+ */
+class FileScanner
+{
+protected:
+    /// Pathname of the file, used for error messages
+    std::string m_pathname;
+    /// Mapped file contents
+    sys::MMap m_map;
+    /// Start of the mapped file contents, or nullptr if the file is empty
+    const uint8_t* m_data = nullptr;
+    /// Size of the file
+    size_t m_size         = 0;
+    /// Offset from which the next scan starts
+    size_t m_pos          = 0;
+
+public:
+    /// Memory map the given file
+    explicit FileScanner(const std::filesystem::path& path);
+    FileScanner(const FileScanner&)            = delete;
+    FileScanner& operator=(const FileScanner&) = delete;
+    ~FileScanner();
+
+    /// Pathname of the file being scanned
+    const std::string& pathname() const { return m_pathname; }
+
+    /// Start of the file contents
+    const uint8_t* data() const { return m_data; }
+
+    /// Size of the file
+    size_t size() const { return m_size; }
+
+    /// Offset in the file where the next scan will start
+    size_t tell() const { return m_pos; }
+
+    /// Restart scanning from the given offset
+    void seek(size_t pos) { m_pos = pos; }
+
+    /**
+     * Find the next BUFR message.
+     *
+     * @retval msg
+     *   Position of the message found
+     * @returns
+     *   true if a message was found, false on end of file
+     */
+    bool next_bufr(ScannedMessage& msg);
+
+    /**
+     * Find the next CREX message.
+     *
+     * @retval msg
+     *   Position of the message found
+     * @returns
+     *   true if a message was found, false on end of file
+     */
+    bool next_crex(ScannedMessage& msg);
+
+    /**
+     * Find the next BUFR message in a memory buffer.
+     *
+     * The search starts at \a pos, which is updated to point past the end of
+     * the message. If the message found is truncated or has an invalid length,
+     * \a pos is moved past its signature before throwing an exception, so that
+     * scanning can be resumed.
+     *
+     * @param buf
+     *   The buffer to scan
+     * @param size
+     *   The size of the buffer
+     * @param pos
+     *   Offset from which to start scanning
+     * @retval msg
+     *   Position of the message found
+     * @param fname
+     *   File name to use in error messages
+     * @returns
+     *   true if a message was found, false if the end of the buffer was
+     *   reached
+     */
+    static bool scan_bufr(const uint8_t* buf, size_t size, size_t& pos,
+                          ScannedMessage& msg, const char* fname = nullptr);
+
+    /**
+     * Find the next CREX message in a memory buffer.
+     *
+     * Same as scan_bufr(), for CREX messages.
+     */
+    static bool scan_crex(const uint8_t* buf, size_t size, size_t& pos,
+                          ScannedMessage& msg, const char* fname = nullptr);
+};
+
+/**
+ * Find BUFR or CREX messages in a stream of data that arrives in chunks of
+ * any size, like data read from a socket or a pipe.
+ *
+ * The caller feeds the data as it arrives, and each complete message is
+ * passed to a callback. The scanner never blocks, and never scans the same
+ * bytes twice. Messages that are entirely contained in a chunk are passed to
+ * the callback without copying them; the bytes of messages split across
+ * chunks are copied once into an internal buffer.
+ *
+ * BUFR messages are framed using the length in section 0, and CREX messages
+ * by their "++ 7777" terminator. Data before and after each message is
+ * skipped, and so are BUFR signatures followed by a length smaller than the
+ * minimum size of a BUFR message.
+ */
+class StreamScanner
+{
+public:
+    /// Encoding of the messages to look for
+    enum Format
+    {
+        BUFR,
+        CREX,
+    };
+
+    /**
+     * Callback receiving each message found.
+     *
+     * ScannedMessage::offset is the offset of the message from the start of
+     * the stream, and ScannedMessage::data is only valid during the call.
+     */
+    typedef std::function<void(const ScannedMessage&)> Callback;
+
+protected:
+    /// Encoding of the messages to look for
+    Format m_format;
+    /// Function called with each message found
+    Callback m_callback;
+    /// Bytes received so far of a message split across chunks
+    std::string m_buf;
+    /// Number of bytes fed so far
+    size_t m_offset      = 0;
+    /// Stream offset of the start of the current message
+    size_t m_msg_offset  = 0;
+    /// True if the start of a message has been found, and not its end
+    bool m_in_message    = false;
+    /// Number of signature bytes matched at the end of the data so far
+    unsigned m_sig_match = 0;
+    /// Number of bytes of the CREX terminator matched so far
+    unsigned m_end_match = 0;
+
+    /**
+     * Look for the message signature from \a pos, continuing a partial match
+     * at the end of the previous chunk.
+     *
+     * @returns true if the signature was found, with \a pos just after it,
+     * false if the end of the chunk was reached
+     */
+    bool find_start(const uint8_t* data, size_t size, size_t& pos);
+
+    /**
+     * Look for the end of a CREX message from \a pos, continuing a partial
+     * match at the end of the previous chunk.
+     *
+     * @returns true if the terminator was found, with \a pos just after it,
+     * false if the end of the chunk was reached
+     */
+    bool find_crex_end(const uint8_t* data, size_t size, size_t& pos);
+
+    /**
+     * Return the size of the BUFR message whose section 0 starts at \a sec0,
+     * or 0 if the size is invalid
+     */
+    static size_t bufr_size(const uint8_t* sec0);
+
+    /**
+     * Scan a message that starts at \a start in a chunk, when its signature
+     * ends at \a pos.
+     *
+     * @returns the position where scanning continues
+     */
+    size_t scan_message(const uint8_t* data, size_t size, size_t start,
+                        size_t pos, size_t base);
+
+    /**
+     * Continue a message whose start has been buffered.
+     *
+     * @returns the position where scanning continues
+     */
+    size_t continue_message(const uint8_t* data, size_t size, size_t pos);
+
+    /// Pass the buffered message to the callback, and reset the buffer
+    void deliver_buffered();
+
+public:
+    StreamScanner(Format format, Callback callback);
+    StreamScanner(const StreamScanner&)            = delete;
+    StreamScanner& operator=(const StreamScanner&) = delete;
+    ~StreamScanner();
+
+    /// Number of bytes fed so far
+    size_t tell() const { return m_offset; }
+
+    /// Number of bytes of an incomplete message currently buffered
+    size_t buffered() const { return m_buf.size(); }
+
+    /**
+     * Scan a chunk of data, calling the callback for each message that it
+     * completes.
+     *
+     * If the callback throws an exception, it is propagated and the rest of
+     * the chunk is not scanned.
+     */
+    void feed(const void* data, size_t size);
+
+    /**
+     * Signal the end of the stream.
+     *
+     * Throws error_consistency if the stream ended in the middle of a
+     * message. The scanner is then reset, and can be used for a new stream.
+     */
+    void finish();
+};
+
+} // namespace wreport
+
+#endif
@@ -19,11 +19,11 @@ Subset::Subset(const Tables& tables) : tables(&tables)
 
 Subset::~Subset() {}
 
-Subset& Subset::operator=(Subset&& s)
+Subset& Subset::operator=(Subset&& s) noexcept
 {
     if (this == &s)
         return *this;
-    std::vector<Var>::operator=(s);
+    std::vector<Var>::operator=(std::move(s));
     tables = s.tables;
     return *this;
 }
@@ -23,13 +23,13 @@ public:
      */
     Subset(const Tables& tables);
     Subset(const Subset& subset) = default;
-    Subset(Subset&& subset)
+    Subset(Subset&& subset) noexcept
         : std::vector<Var>(move(subset)), tables(subset.tables)
     {
     }
     ~Subset();
     Subset& operator=(const Subset&) = default;
-    Subset& operator=(Subset&& s);
+    Subset& operator=(Subset&& s) noexcept;
 
     /// Store a decoded variable in the message, to be encoded later.
     void store_variable(const Var& var);
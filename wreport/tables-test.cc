@@ -1,6 +1,10 @@
+#include "internals/tabledir.h"
 #include "tables.h"
 #include "tests.h"
 #include "wreport/dtable.h"
+#include "wreport/vartable.h"
+#include <atomic>
+#include <thread>
 
 using namespace wreport;
 using namespace wreport::tests;
@@ -17,6 +21,74 @@ class Tests : public TestCase
         add_method("empty", []() noexcept {
             // TODO: add test
         });
+
+        add_method("load_concurrent", []() {
+            // Load all the BUFR master tables from many threads at the same
+            // time, on a fresh tabledir index
+            const unsigned thread_count = 8;
+            tabledir::Tabledirs tabledirs;
+            tabledirs.add_default_directories();
+
+            struct Loaded
+            {
+                const tabledir::Table* table;
+                const Vartable* btable;
+                const DTable* dtable;
+            };
+            std::vector<std::vector<Loaded>> results(thread_count);
+            std::vector<std::string> errors(thread_count);
+            std::atomic<bool> start(false);
+
+            std::vector<std::thread> threads;
+            for (unsigned t = 0; t < thread_count; ++t)
+                threads.emplace_back([&, t] {
+                    while (!start.load())
+                        std::this_thread::yield();
+                    try
+                    {
+                        for (unsigned round = 0; round < 3; ++round)
+                            for (uint8_t v = 12; v <= 41; ++v)
+                            {
+                                BufrTableID id(0, 0, 0, v, 0);
+                                Loaded loaded;
+                                loaded.table = tabledirs.find_bufr(id);
+                                Tables tables;
+                                tables.load_bufr(id);
+                                loaded.btable = tables.btable;
+                                loaded.dtable = tables.dtable;
+                                results[t].push_back(loaded);
+                                tables.btable->query(WR_VAR(0, 1, 1));
+                            }
+                    }
+                    catch (std::exception& e)
+                    {
+                        errors[t] = e.what();
+                    }
+                });
+            start.store(true);
+            for (auto& t : threads)
+                t.join();
+
+            for (unsigned t = 0; t < thread_count; ++t)
+            {
+                WREPORT_TEST_INFO(info);
+                info() << "thread " << t;
+                wassert(actual(errors[t]) == "");
+                wassert(actual(results[t].size()) == results[0].size());
+                for (size_t i = 0; i < results[t].size(); ++i)
+                {
+                    wassert_true(results[t][i].table);
+                    wassert_true(results[t][i].table == results[0][i].table);
+                    wassert_true(results[t][i].btable ==
+                                 results[0][i].btable);
+                    wassert_true(results[t][i].dtable ==
+                                 results[0][i].dtable);
+                    wassert_true(results[t][i].btable ==
+                                 Vartable::load_bufr(
+                                     results[t][i].table->btable_pathname));
+                }
+            }
+        });
     }
 } test("tables");
 
@@ -75,6 +75,7 @@ void Tables::load_crex(const CrexTableID& id)
 
 Varinfo Tables::get_bitmap(Varcode code, const std::string& bitmap) const
 {
+    std::lock_guard<std::mutex> lock(local_mutex);
     auto res = bitmap_table.find(bitmap);
     if (res != bitmap_table.end())
     {
@@ -94,6 +95,7 @@ Varinfo Tables::get_bitmap(Varcode code, const std::string& bitmap) const
 
 Varinfo Tables::get_chardata(Varcode code, unsigned len) const
 {
+    std::lock_guard<std::mutex> lock(local_mutex);
     auto res = chardata_table.find(code);
     if (res != chardata_table.end())
     {
@@ -113,6 +115,7 @@ Varinfo Tables::get_chardata(Varcode code, unsigned len) const
 
 Varinfo Tables::get_unknown(Varcode code, unsigned bit_len) const
 {
+    std::lock_guard<std::mutex> lock(local_mutex);
     auto res = unknown_table.find(bit_len);
     if (res != unknown_table.end())
     {
@@ -2,6 +2,7 @@
 #define WREPORT_TABLES_H
 
 #include <map>
+#include <mutex>
 #include <string>
 #include <wreport/fwd.h>
 #include <wreport/varinfo.h>
@@ -23,6 +24,11 @@ struct Tables
     mutable std::map<Varcode, _Varinfo> chardata_table;
     /// Storage for temporary Varinfos for C06 unknown local descriptors
     mutable std::map<unsigned, _Varinfo> unknown_table;
+    /**
+     * Serialise access to the temporary Varinfo storage, so that messages
+     * using the same tables can be decoded from multiple threads
+     */
+    mutable std::mutex local_mutex;
 
     Tables();
     Tables(const Tables&) = delete;
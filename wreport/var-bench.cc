@@ -1,4 +1,5 @@
 #include "benchmark.h"
+#include "internals/varinfo.h"
 #include "var.h"
 #include <cstdlib>
 #include <vector>
@@ -15,17 +16,21 @@ struct VarBenchmark : Benchmark
     _Varinfo varinfo_double;
     _Varinfo varinfo_string;
     _Varinfo varinfo_binary;
+    _Varinfo varinfo_short_string;
+    _Varinfo varinfo_attrs[3];
     static const unsigned vars_count = 30000;
     Var* vars_unset;
     Var* vars_i;
     Var* vars_d;
     Var* vars_c;
     Var* vars_b;
+    Var* vars_cs;
     Task create_unset;
     Task create_i;
     Task create_d;
     Task create_c;
     Task create_b;
+    Task create_cs;
     Task isset;
     Task enqi;
     Task enqd;
@@ -36,36 +41,57 @@ struct VarBenchmark : Benchmark
     Task setd;
     Task setc;
     Task setb;
+    Task setcs;
+    Task copyc;
+    Task copycs;
+    Task seta;
+    Task enqa;
+    Task copya;
 
     VarBenchmark(const std::string& name)
         : Benchmark(name), create_unset(this, "new"), create_i(this, "newi"),
           create_d(this, "newd"), create_c(this, "newc"),
-          create_b(this, "newb"), isset(this, "isset"), enqi(this, "enqi"),
-          enqd(this, "enqd"), enqc(this, "enqc"), enqb(this, "enqb"),
-          unset(this, "unset"), seti(this, "seti"), setd(this, "setd"),
-          setc(this, "setc"), setb(this, "setb")
+          create_b(this, "newb"), create_cs(this, "newcs"),
+          isset(this, "isset"), enqi(this, "enqi"), enqd(this, "enqd"),
+          enqc(this, "enqc"), enqb(this, "enqb"), unset(this, "unset"),
+          seti(this, "seti"), setd(this, "setd"), setc(this, "setc"),
+          setb(this, "setb"), setcs(this, "setcs"), copyc(this, "copyc"),
+          copycs(this, "copycs"), seta(this, "seta", true),
+          enqa(this, "enqa"), copya(this, "copya", true)
     {
         repetitions = 100;
     }
 
-    void setup_main()
+    void setup_main() override
     {
         Benchmark::setup_main();
-        varinfo_int.set_bufr(WR_VAR(0, 0, 0), "test integer variable", "number",
-                             0, 0, 10);
-        varinfo_double.set_bufr(WR_VAR(0, 0, 0), "test double variable",
-                                "number", 5, -100000, 10);
-        varinfo_string.set_string(WR_VAR(0, 0, 0), "test string variable", 32);
-        varinfo_binary.set_binary(WR_VAR(0, 0, 0), "test binary variable", 20);
+        varinfo::set_crex(varinfo_int, WR_VAR(0, 0, 0), "test integer variable",
+                          "number", 10);
+        varinfo::set_crex(varinfo_double, WR_VAR(0, 0, 0),
+                          "test double variable", "number", 10, 5);
+        varinfo::set_string(varinfo_string, WR_VAR(0, 0, 0),
+                            "test string variable", 32);
+        varinfo::set_binary(varinfo_binary, WR_VAR(0, 0, 0),
+                            "test binary variable", 20);
+        varinfo::set_string(varinfo_short_string, WR_VAR(0, 0, 0),
+                            "test short string variable", 8);
+        // Quality flags, like those added by associated fields
+        varinfo::set_crex(varinfo_attrs[0], WR_VAR(0, 33, 50),
+                          "test attribute", "code table", 2);
+        varinfo::set_crex(varinfo_attrs[1], WR_VAR(0, 33, 2),
+                          "test attribute", "code table", 1);
+        varinfo::set_crex(varinfo_attrs[2], WR_VAR(0, 33, 7),
+                          "test attribute", "%", 3);
         // Allocate space for the test vars
         vars_unset = (Var*)malloc(vars_count * sizeof(Var));
         vars_i     = (Var*)malloc(vars_count * sizeof(Var));
         vars_d     = (Var*)malloc(vars_count * sizeof(Var));
         vars_c     = (Var*)malloc(vars_count * sizeof(Var));
         vars_b     = (Var*)malloc(vars_count * sizeof(Var));
+        vars_cs    = (Var*)malloc(vars_count * sizeof(Var));
     }
 
-    void teardown_main()
+    void teardown_main() override
     {
         Benchmark::teardown_main();
         free(vars_unset);
@@ -73,6 +99,7 @@ struct VarBenchmark : Benchmark
         free(vars_d);
         free(vars_c);
         free(vars_b);
+        free(vars_cs);
     }
 
     void main() override
@@ -158,8 +185,29 @@ struct VarBenchmark : Benchmark
                 }
             }
         });
+        // Short strings, like station identifiers
+        create_cs.collect([&]() {
+            for (unsigned i = 0; i < vars_count; ++i)
+            {
+                switch (i % 4)
+                {
+                    case 0:
+                        new (&vars_cs[i]) Var(&varinfo_short_string, "");
+                        break;
+                    case 1:
+                        new (&vars_cs[i]) Var(&varinfo_short_string, "foo");
+                        break;
+                    case 2:
+                        new (&vars_cs[i]) Var(&varinfo_short_string, "LIRF");
+                        break;
+                    case 3:
+                        new (&vars_cs[i]) Var(&varinfo_short_string, "D-ABCD");
+                        break;
+                }
+            }
+        });
         // Query the variables
-        isset.collect([&]() {
+        isset.collect([&]() noexcept {
             for (unsigned i = 0; i < vars_count; ++i)
             {
                 vars_unset[i].isset();
@@ -260,6 +308,57 @@ struct VarBenchmark : Benchmark
                 vars_b[i].setc("\xf0\xf0");
             }
         });
+        setcs.collect([&]() {
+            for (unsigned i = 0; i < vars_count; ++i)
+            {
+                vars_cs[i].setc("");
+                vars_cs[i].setc("foo");
+                vars_cs[i].setc("LIRF");
+                vars_cs[i].setc("D-ABCD");
+                vars_cs[i].setc("12345678");
+            }
+        });
+        // Copy string variables
+        copyc.collect([&]() {
+            std::vector<Var> copies;
+            copies.reserve(vars_count);
+            for (unsigned i = 0; i < vars_count; ++i)
+                copies.emplace_back(vars_c[i]);
+        });
+        copycs.collect([&]() {
+            std::vector<Var> copies;
+            copies.reserve(vars_count);
+            for (unsigned i = 0; i < vars_count; ++i)
+                copies.emplace_back(vars_cs[i]);
+        });
+        // Attributes
+        seta.collect([&]() {
+            for (unsigned i = 0; i < vars_count; ++i)
+            {
+                vars_i[i].clear_attrs();
+                vars_i[i].seta(Var(&varinfo_attrs[0], 1));
+                vars_i[i].seta(Var(&varinfo_attrs[1], 2));
+                vars_i[i].seta(Var(&varinfo_attrs[2], 70));
+            }
+        });
+        enqa.collect([&]() {
+            for (unsigned i = 0; i < vars_count; ++i)
+            {
+                vars_i[i].enqa(WR_VAR(0, 33, 2));
+                vars_i[i].enqa(WR_VAR(0, 33, 7));
+                vars_i[i].enqa(WR_VAR(0, 33, 50));
+                vars_i[i].enqa(WR_VAR(0, 33, 3));
+                for (const Var* a = vars_i[i].next_attr(); a;
+                     a             = a->next_attr())
+                    a->isset();
+            }
+        });
+        copya.collect([&]() {
+            std::vector<Var> copies;
+            copies.reserve(vars_count);
+            for (unsigned i = 0; i < vars_count; ++i)
+                copies.emplace_back(vars_i[i]);
+        });
     }
 } test("var");
 
@@ -5,6 +5,7 @@
 #include "vartable.h"
 #include <cmath>
 #include <cstring>
+#include <vector>
 
 using namespace wreport;
 using namespace wreport::tests;
@@ -612,6 +613,189 @@ void Tests::register_tests()
         wassert(actual(var3.enqc()) == "ciaon");
     });
 
+    add_method("string_storage", []() {
+        // Strings stored inline and on the heap
+        _Varinfo vi_short;
+        varinfo::set_string(vi_short, WR_VAR(0, 0, 0), "TEST SHORT", 15);
+        _Varinfo vi_long;
+        varinfo::set_string(vi_long, WR_VAR(0, 0, 0), "TEST LONG", 16);
+
+        Var vshort(&vi_short, "123456789012345");
+        Var vlong(&vi_long, "1234567890123456");
+        wassert(actual(vshort.enqc()) == "123456789012345");
+        wassert(actual(vlong.enqc()) == "1234567890123456");
+
+        // Copy and move, with both storages
+        Var vshort1(vshort);
+        wassert(actual(vshort1.enqc()) == "123456789012345");
+        Var vshort2(std::move(vshort1));
+        wassert(actual(vshort2.enqc()) == "123456789012345");
+        wassert_false(vshort1.isset());
+        Var vlong1(vlong);
+        wassert(actual(vlong1.enqc()) == "1234567890123456");
+        Var vlong2(std::move(vlong1));
+        wassert(actual(vlong2.enqc()) == "1234567890123456");
+        wassert_false(vlong1.isset());
+
+        // Move assignment reuses the moved-from variable
+        vshort1 = std::move(vshort2);
+        wassert(actual(vshort1.enqc()) == "123456789012345");
+        vshort1.setc("foo");
+        wassert(actual(vshort1.enqc()) == "foo");
+        vlong1 = std::move(vlong2);
+        wassert(actual(vlong1.enqc()) == "1234567890123456");
+        vlong1.setc("foo");
+        wassert(actual(vlong1.enqc()) == "foo");
+
+        // Assignment changing the storage
+        Var var(vshort);
+        var = vlong;
+        wassert(actual(var.enqc()) == "1234567890123456");
+        var = vshort;
+        wassert(actual(var.enqc()) == "123456789012345");
+        Var empty(&vi_long);
+        var = empty;
+        wassert_false(var.isset());
+        var.setc("12345678901234567");
+        wassert(actual(var.enqc()) == "1234567890123456");
+    });
+
+    add_method("attribute_storage", []() {
+        const Vartable* table = Vartable::get_bufr("B0000000000000014000");
+        Var var(table->query(WR_VAR(0, 21, 143)), 1);
+
+        // Attributes are kept ordered by code, whatever the insertion order
+        Varcode codes[] = {WR_VAR(0, 33, 50), WR_VAR(0, 33, 2),
+                           WR_VAR(0, 33, 7),  WR_VAR(0, 33, 3),
+                           WR_VAR(0, 33, 15)};
+        for (unsigned i = 0; i < 5; ++i)
+            var.seta(Var(table->query(codes[i]), (int)i));
+        Varcode expected[] = {WR_VAR(0, 33, 2), WR_VAR(0, 33, 3),
+                              WR_VAR(0, 33, 7), WR_VAR(0, 33, 15),
+                              WR_VAR(0, 33, 50)};
+        unsigned count = 0;
+        for (const Var* a = var.next_attr(); a; a = a->next_attr())
+            wassert(actual_varcode(a->code()) == expected[count++]);
+        wassert(actual(count) == 5u);
+        wassert(actual(*var.enqa(WR_VAR(0, 33, 50))) == 0);
+        wassert(actual(*var.enqa(WR_VAR(0, 33, 15))) == 4);
+
+        // Setting an existing attribute replaces its value
+        var.seta(Var(table->query(WR_VAR(0, 33, 7)), 70));
+        wassert(actual(*var.enqa(WR_VAR(0, 33, 7))) == 70);
+        count = 0;
+        for (const Var* a = var.next_attr(); a; a = a->next_attr())
+            ++count;
+        wassert(actual(count) == 5u);
+
+        // Copies and moves carry all the attributes
+        Var copy(var);
+        wassert(actual(copy) == var);
+        Var moved(std::move(copy));
+        wassert(actual(moved) == var);
+        wassert_false(copy.next_attr());
+
+        // Removing attributes keeps the others in order
+        moved.unseta(WR_VAR(0, 33, 3));
+        moved.unseta(WR_VAR(0, 33, 99));
+        wassert_false(moved.enqa(WR_VAR(0, 33, 3)));
+        wassert(actual(*moved.enqa(WR_VAR(0, 33, 2))) == 1);
+        wassert(actual(*moved.enqa(WR_VAR(0, 33, 7))) == 70);
+        wassert(actual_varcode(moved.next_attr()->next_attr()->code()) ==
+                WR_VAR(0, 33, 7));
+        moved.unseta(WR_VAR(0, 33, 2));
+        moved.unseta(WR_VAR(0, 33, 7));
+        moved.unseta(WR_VAR(0, 33, 15));
+        moved.unseta(WR_VAR(0, 33, 50));
+        wassert_false(moved.next_attr());
+        wassert(actual(moved.enqi()) == 1);
+
+        // A copy of an attribute does not depend on the variable it came from
+        Var attr(*var.enqa(WR_VAR(0, 33, 2)));
+        var.clear_attrs();
+        wassert(actual(attr.enqi()) == 1);
+    });
+
+    add_method("attribute_pointers", []() {
+        // Changing attributes does not move the other ones, as callers keep
+        // pointers to them
+        const Vartable* table = Vartable::get_bufr("B0000000000000014000");
+        Var var(table->query(WR_VAR(0, 21, 143)), 1);
+        var.seta(Var(table->query(WR_VAR(0, 33, 7)), 70));
+        const Var* a = var.enqa(WR_VAR(0, 33, 7));
+        wassert(actual(a) == var.next_attr());
+
+        // Adding attributes before and after it
+        var.seta(Var(table->query(WR_VAR(0, 33, 2)), 1));
+        var.seta(Var(table->query(WR_VAR(0, 33, 3)), 2));
+        var.seta(Var(table->query(WR_VAR(0, 33, 15)), 3));
+        var.seta(Var(table->query(WR_VAR(0, 33, 50)), 4));
+        wassert(actual(var.enqa(WR_VAR(0, 33, 7))) == a);
+        wassert(actual(*a) == 70);
+        const Var* b = var.enqa(WR_VAR(0, 33, 15));
+
+        // Removing the attributes around it, and reusing their slots
+        var.unseta(WR_VAR(0, 33, 2));
+        var.unseta(WR_VAR(0, 33, 50));
+        var.seta(Var(table->query(WR_VAR(0, 33, 40)), 5));
+        wassert(actual(var.enqa(WR_VAR(0, 33, 7))) == a);
+        wassert(actual(var.enqa(WR_VAR(0, 33, 15))) == b);
+        wassert(actual(*a) == 70);
+        wassert(actual(*b) == 3);
+
+        // Replacing the value of an attribute does not move it
+        var.seta(Var(table->query(WR_VAR(0, 33, 7)), 80));
+        wassert(actual(var.enqa(WR_VAR(0, 33, 7))) == a);
+        wassert(actual(*a) == 80);
+
+        // Iteration sees all the attributes in order
+        std::vector<Varcode> codes;
+        for (const Var* i = var.next_attr(); i; i = i->next_attr())
+            codes.push_back(i->code());
+        wassert(actual(codes.size()) == 4u);
+        wassert(actual_varcode(codes[0]) == WR_VAR(0, 33, 3));
+        wassert(actual_varcode(codes[1]) == WR_VAR(0, 33, 7));
+        wassert(actual_varcode(codes[2]) == WR_VAR(0, 33, 15));
+        wassert(actual_varcode(codes[3]) == WR_VAR(0, 33, 40));
+    });
+
+    add_method("move_from_attribute", []() {
+        // Moving or copying an attribute takes only its value, and not the
+        // attributes that follow it
+        const Vartable* table = Vartable::get_bufr("B0000000000000014000");
+        Var var(table->query(WR_VAR(0, 21, 143)), 1);
+        var.seta(Var(table->query(WR_VAR(0, 33, 2)), 1));
+        var.seta(Var(table->query(WR_VAR(0, 33, 7)), 70));
+        var.seta(Var(table->query(WR_VAR(0, 33, 15)), 3));
+        Var* attr = const_cast<Var*>(var.enqa(WR_VAR(0, 33, 7)));
+
+        Var copied(*attr);
+        wassert(actual(copied.enqi()) == 70);
+        wassert_false(copied.next_attr());
+
+        Var moved(std::move(*attr));
+        wassert(actual(moved.enqi()) == 70);
+        wassert_false(moved.next_attr());
+
+        Var assigned(table->query(WR_VAR(0, 33, 7)));
+        assigned.seta(Var(table->query(WR_VAR(0, 33, 2)), 2));
+        assigned = std::move(*const_cast<Var*>(var.enqa(WR_VAR(0, 33, 2))));
+        wassert(actual(assigned.enqi()) == 1);
+        wassert_false(assigned.next_attr());
+
+        // The moved-from attributes are still there, unset
+        wassert(actual(var.enqa(WR_VAR(0, 33, 7))) == attr);
+        wassert_false(attr->isset());
+        wassert_false(var.enqa(WR_VAR(0, 33, 2))->isset());
+        wassert(actual(*var.enqa(WR_VAR(0, 33, 15))) == 3);
+        wassert(actual(attr->next_attr()) == var.enqa(WR_VAR(0, 33, 15)));
+
+        // Moving the variable itself leaves its attributes where they are
+        Var var2(std::move(var));
+        wassert(actual(var2.enqa(WR_VAR(0, 33, 7))) == attr);
+        wassert_false(var.next_attr());
+    });
+
     add_method("issue17", []() {
         _Varinfo vi;
         varinfo::set_bufr(vi, WR_VAR(0, 0, 0), "TEST", "?", 16, 0, 2);
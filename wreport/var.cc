@@ -1,15 +1,19 @@
 #include "var.h"
+#include "arena.h"
 #include "config.h"
 #include "conv.h"
 #include "notes.h"
 #include "options.h"
 #include "vartable.h"
+#include <algorithm>
 #include <cctype>
 #include <cmath>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <iostream>
+#include <new>
+#include <utility>
 
 using namespace std;
 
@@ -108,51 +112,131 @@ bool isnumber(const char* str)
 
 namespace wreport {
 
-Var::Var(Varinfo info)
-    : m_info(info), m_isset(false), m_value{}, m_attrs(nullptr)
+/**
+ * Storage for the attributes of a Var.
+ *
+ * The header is followed by room for capacity Var objects, constructed in the
+ * slots marked in used. Blocks are chained, and the attributes in all of them
+ * are linked to each other in Varcode order, starting from first in the first
+ * block.
+ */
+struct alignas(Var) Var::AttrBlock
+{
+    /// Next block with attributes of the same variable
+    AttrBlock* next_block;
+    /// First attribute in Varcode order, only used in the first block
+    Var* first;
+    /// Number of attributes that fit in the block
+    unsigned capacity;
+    /// Bitmap of the slots holding an attribute
+    uint32_t used;
+    /// True if the block is allocated in an Arena
+    bool in_arena;
+
+    /// Largest capacity of a block, limited by the size of used
+    static constexpr unsigned max_capacity = 32;
+
+    /// Access the attribute slots
+    Var* items() { return reinterpret_cast<Var*>(this + 1); }
+
+    /// Return the attribute following \a attr, or nullptr if it is the last
+    static Var* following(const Var& attr)
+    {
+        return static_cast<Var*>(attr.attrs_ptr());
+    }
+
+    /// Allocate an empty block, in the current Arena if there is one
+    static AttrBlock* create(unsigned capacity)
+    {
+        size_t size   = sizeof(AttrBlock) + capacity * sizeof(Var);
+        bool in_arena = Arena::current != nullptr;
+        void* buf     = in_arena ? Arena::current->allocate(size)
+                                 : ::operator new(size);
+        AttrBlock* res  = new (buf) AttrBlock;
+        res->next_block = nullptr;
+        res->first      = nullptr;
+        res->capacity   = capacity;
+        res->used       = 0;
+        res->in_arena   = in_arena;
+        return res;
+    }
+
+    /// Take a free slot, or return nullptr if the block is full
+    Var* take_slot()
+    {
+        for (unsigned i = 0; i < capacity; ++i)
+            if (!(used & (1u << i)))
+            {
+                used |= 1u << i;
+                return &items()[i];
+            }
+        return nullptr;
+    }
+
+    /// Destroy \a attr and free its slot, if it is stored in this block
+    bool free_slot(Var* attr)
+    {
+        if (attr < items() || attr >= items() + capacity)
+            return false;
+        attr->~Var();
+        used &= ~(1u << (attr - items()));
+        return true;
+    }
+
+    /// Destroy the attributes and free the block
+    void destroy()
+    {
+        for (unsigned i = 0; i < capacity; ++i)
+            if (used & (1u << i))
+                items()[i].~Var();
+        if (!in_arena)
+            ::operator delete(this);
+    }
+
+    static_assert(alignof(Var) > FLAG_MASK,
+                  "Var pointers have no room for flags");
+    static_assert(sizeof(Var) == 2 * sizeof(void*) + 16,
+                  "Var is larger than its contents");
+};
+
+Var::Var(Varinfo info) : m_info(info), m_value{}, m_attrs(0)
 {
 }
 
-Var::Var(Varinfo info, int val)
-    : m_info(info), m_isset(false), m_value{}, m_attrs(nullptr)
+Var::Var(Varinfo info, int val) : m_info(info), m_value{}, m_attrs(0)
 {
     seti(val);
 }
 
-Var::Var(Varinfo info, double val)
-    : m_info(info), m_isset(false), m_value{}, m_attrs(nullptr)
+Var::Var(Varinfo info, double val) : m_info(info), m_value{}, m_attrs(0)
 {
     setd(val);
 }
 
-Var::Var(Varinfo info, const char* val)
-    : m_info(info), m_isset(false), m_value{}, m_attrs(nullptr)
+Var::Var(Varinfo info, const char* val) : m_info(info), m_value{}, m_attrs(0)
 {
     setc(val);
 }
 
 Var::Var(Varinfo info, const std::string& val)
-    : m_info(info), m_isset(false), m_value{}, m_attrs(nullptr)
+    : m_info(info), m_value{}, m_attrs(0)
 {
     sets(val);
 }
 
-Var::Var(const Var& var)
-    : m_info(var.m_info), m_isset(false), m_value{}, m_attrs(nullptr)
+Var::Var(const Var& var) : m_info(var.m_info), m_value{}, m_attrs(0)
 {
     copy_value(var);
     setattrs(var);
 }
 
-Var::Var(Var&& var)
-    : m_info(var.m_info), m_isset(false), m_value{}, m_attrs(var.m_attrs)
+Var::Var(Var&& var) : m_info(var.m_info), m_value{}, m_attrs(0)
 {
     move_value(var);
-    var.m_attrs = nullptr;
+    move_attrs(var);
 }
 
-Var::Var(Varinfo info, const Var& var)
-    : m_info(info), m_isset(false), m_value{}, m_attrs(nullptr)
+Var::Var(Varinfo info, const Var& var) : m_info(info), m_value{}, m_attrs(0)
 {
     setval(var);
     setattrs(var);
@@ -163,8 +247,12 @@ Var& Var::operator=(const Var& var)
     if (&var == this)
         return *this;
 
-    // Copy info
-    m_info = var.m_info;
+    // Copy info, dropping storage that does not fit the new one
+    if (m_info != var.m_info)
+    {
+        deallocate();
+        m_info = var.m_info;
+    }
 
     // Copy value
     copy_value(var);
@@ -179,24 +267,10 @@ Var& Var::operator=(Var&& var)
     if (&var == this)
         return *this;
     move_value(var);
-    delete m_attrs;
-    m_attrs     = var.m_attrs;
-    var.m_attrs = nullptr;
+    move_attrs(var);
     return *this;
 }
 
-Var::~Var()
-{
-    switch (m_info->type)
-    {
-        case Vartype::Binary:
-        case Vartype::String:  delete[] m_value.c; break;
-        case Vartype::Integer:
-        case Vartype::Decimal: break;
-    }
-    delete m_attrs;
-}
-
 bool Var::operator==(const Var& var) const
 {
     if (code() != var.code())
@@ -205,34 +279,77 @@ bool Var::operator==(const Var& var) const
         return false;
 
     // Compare attrs
-    if (!m_attrs && !var.m_attrs)
-        return true;
-    if (!m_attrs || !var.m_attrs)
-        return false;
-    return *m_attrs == *var.m_attrs;
+    const AttrBlock* block     = attr_block();
+    const AttrBlock* var_block = var.attr_block();
+    const Var* a1              = block ? block->first : nullptr;
+    const Var* a2              = var_block ? var_block->first : nullptr;
+    for (; a1 && a2; a1 = a1->next_attr(), a2 = a2->next_attr())
+        if (a1->code() != a2->code() || !a1->value_equals(*a2))
+            return false;
+    return !a1 && !a2;
 }
 
 void Var::allocate()
 {
-    if (!m_value.c && !(m_value.c = new char[m_info->len + 1]))
+    if (stores_inline(m_info) || m_value.c)
+        return;
+    if (Arena::current)
+        m_value.c = static_cast<char*>(
+            Arena::current->allocate(m_info->len + 1));
+    else if (!(m_value.c = new char[m_info->len + 1]))
         throw error_alloc("allocating space for Var value");
+    else
+        set_flag(FLAG_VALUE_ON_HEAP, true);
+}
+
+void Var::deallocate()
+{
+    if (has_flag(FLAG_VALUE_ON_HEAP))
+        delete[] m_value.c;
+    m_value = {};
+    set_flag(FLAG_VALUE_ON_HEAP, false);
+}
+
+void Var::release()
+{
+    deallocate();
+    clear_attrs();
+}
+
+void Var::move_attrs(Var& var)
+{
+    clear_attrs();
+    AttrBlock* block = var.attr_block();
+    if (!block)
+        return;
+    for (AttrBlock* b = block; b; b = b->next_block)
+        if (b->in_arena && !Arena::current)
+        {
+            // Leave arena memory behind, as it may be reset while we still
+            // use it
+            setattrs(var);
+            var.clear_attrs();
+            return;
+        }
+    set_attrs_ptr(block, true);
+    var.set_attrs_ptr(nullptr, false);
 }
 
 void Var::copy_value(const Var& var)
 {
-    m_isset = var.m_isset;
-    if (!m_isset)
+    set_flag(FLAG_ISSET, var.isset());
+    if (!isset())
         return;
 
     switch (m_info->type)
     {
         case Vartype::Binary:
             allocate();
-            memcpy(m_value.c, var.m_value.c, m_info->len);
+            memcpy(value_buf(), var.value_buf(), m_info->len);
             break;
         case Vartype::String:
             allocate();
-            memcpy(m_value.c, var.m_value.c, m_info->len + 1);
+            memcpy(value_buf(), var.value_buf(), m_info->len + 1);
             break;
         case Vartype::Integer:
         case Vartype::Decimal: m_value.i = var.m_value.i; break;
@@ -241,41 +358,55 @@ void Var::copy_value(const Var& var)
 
 void Var::move_value(Var& var)
 {
-    m_isset = var.m_isset;
-    if (!m_isset)
+    set_flag(FLAG_ISSET, var.isset());
+    if (!isset())
         return;
 
     switch (m_info->type)
     {
         case Vartype::Binary:
         case Vartype::String:
-            if (m_value.c)
-                delete[] m_value.c;
-            m_value.c     = var.m_value.c;
-            var.m_value.c = nullptr;
-            var.m_isset   = false;
+            if (stores_inline(m_info))
+                memcpy(m_value.s, var.m_value.s, m_info->len + 1);
+            else if (!var.has_flag(FLAG_VALUE_ON_HEAP) && !Arena::current)
+            {
+                // Leave arena memory behind, as it may be reset while we
+                // still use it
+                allocate();
+                memcpy(m_value.c, var.m_value.c, m_info->len + 1);
+            }
+            else
+            {
+                if (has_flag(FLAG_VALUE_ON_HEAP))
+                    delete[] m_value.c;
+                m_value.c = var.m_value.c;
+                set_flag(FLAG_VALUE_ON_HEAP, var.has_flag(FLAG_VALUE_ON_HEAP));
+                var.m_value.c = nullptr;
+                var.set_flag(FLAG_VALUE_ON_HEAP, false);
+            }
+            var.set_flag(FLAG_ISSET, false);
             break;
         case Vartype::Integer:
         case Vartype::Decimal:
-            m_value.i   = var.m_value.i;
-            var.m_isset = false;
+            m_value.i = var.m_value.i;
+            var.set_flag(FLAG_ISSET, false);
             break;
     }
 }
 
 bool Var::value_equals(const Var& var) const
 {
-    if (!m_isset && !var.m_isset)
+    if (!isset() && !var.isset())
         return true;
-    if (!m_isset || !var.m_isset)
+    if (!isset() || !var.isset())
         return false;
 
     // Compare value
     switch (m_info->type)
     {
         case Vartype::Binary:
-            return memcmp(m_value.c, var.m_value.c, m_info->len) == 0;
-        case Vartype::String:  return strcmp(m_value.c, var.m_value.c) == 0;
+            return memcmp(value_buf(), var.value_buf(), m_info->len) == 0;
+        case Vartype::String:  return strcmp(value_buf(), var.value_buf()) == 0;
         case Vartype::Integer:
         case Vartype::Decimal: return m_value.i == var.m_value.i;
     }
@@ -284,13 +415,19 @@ bool Var::value_equals(const Var& var) const
 
 void Var::clear_attrs()
 {
-    delete m_attrs;
-    m_attrs = 0;
+    AttrBlock* block = attr_block();
+    set_attrs_ptr(nullptr, false);
+    while (block)
+    {
+        AttrBlock* next = block->next_block;
+        block->destroy();
+        block = next;
+    }
 }
 
 int Var::enqi() const
 {
-    if (!m_isset)
+    if (!isset())
         error_notfound::throwf("enqi: %01d%02d%03d (%s) is not defined",
                                WR_VAR_FXY(m_info->code), m_info->desc);
     switch (m_info->type)
@@ -309,7 +446,7 @@ int Var::enqi() const
 
 double Var::enqd() const
 {
-    if (!m_isset)
+    if (!isset())
         error_notfound::throwf("enqd: %01d%02d%03d (%s) is not defined",
                                WR_VAR_FXY(m_info->code), m_info->desc);
     switch (m_info->type)
@@ -378,14 +515,14 @@ const char* Var::enqc() const
     static const unsigned buf_size   = 20;
     static thread_local char* tl_buf = 0;
 
-    if (!m_isset)
+    if (!isset())
         error_notfound::throwf("enqc: %01d%02d%03d (%s) is not defined",
                                WR_VAR_FXY(m_info->code), m_info->desc);
 
     switch (m_info->type)
     {
         case Vartype::String:
-        case Vartype::Binary:  return m_value.c;
+        case Vartype::Binary:  return value_buf();
         case Vartype::Integer:
         case Vartype::Decimal: {
             // Access tl_buf just once, to prevent a lot of calls to
@@ -403,14 +540,14 @@ const char* Var::enqc() const
 
 std::string Var::enqs() const
 {
-    if (!m_isset)
+    if (!isset())
         error_notfound::throwf("enqs: %01d%02d%03d (%s) is not defined",
                                WR_VAR_FXY(m_info->code), m_info->desc);
 
     switch (m_info->type)
     {
-        case Vartype::String:  return m_value.c;
-        case Vartype::Binary:  return std::string(m_value.c, m_info->len);
+        case Vartype::String:  return value_buf();
+        case Vartype::Binary:  return std::string(value_buf(), m_info->len);
         case Vartype::Integer:
         case Vartype::Decimal: return int32_to_stdstr(m_value.i);
     }
@@ -451,7 +588,7 @@ void Var::assign_i_checked(int32_t val)
         }
     }
     m_value.i = val;
-    m_isset   = true;
+    set_flag(FLAG_ISSET, true);
 }
 
 void Var::assign_d_checked(double val)
@@ -512,44 +649,46 @@ void Var::assign_d_checked(double val)
         }
     }
     m_value.i = m_info->encode_decimal(val);
-    m_isset   = true;
+    set_flag(FLAG_ISSET, true);
 }
 
 void Var::assign_b_checked(const uint8_t* val, unsigned size)
 {
     allocate();
+    char* buf = value_buf();
     if (size < m_info->len)
     {
         // If val is too short, copy it and zero pad the rest
-        memcpy(m_value.c, val, size);
+        memcpy(buf, val, size);
         for (unsigned i = size; i < m_info->len; ++i)
-            m_value.c[i] = 0;
+            buf[i] = 0;
     }
     else
     {
-        memcpy(m_value.c, val, m_info->len);
+        memcpy(buf, val, m_info->len);
         if (m_info->bit_len % 8)
-            m_value.c[m_info->len - 1] &=
+            buf[m_info->len - 1] &=
                 static_cast<unsigned char>((1 << (m_info->bit_len % 8)) - 1);
     }
-    m_value.c[m_info->len] = 0;
-    m_isset                = true;
+    buf[m_info->len] = 0;
+    set_flag(FLAG_ISSET, true);
 }
 
 void Var::assign_c_checked(const char* val, unsigned size)
 {
     allocate();
+    char* buf = value_buf();
     if (size < m_info->len)
     {
-        strncpy(m_value.c, val, size);
-        m_value.c[size] = 0;
+        strncpy(buf, val, size);
+        buf[size] = 0;
     }
     else
     {
-        strncpy(m_value.c, val, m_info->len);
-        m_value.c[m_info->len] = 0;
+        strncpy(buf, val, m_info->len);
+        buf[m_info->len] = 0;
     }
-    m_isset = true;
+    set_flag(FLAG_ISSET, true);
 }
 
 void Var::seti(int val)
@@ -674,65 +813,127 @@ void Var::setf(const char* val)
     }
 }
 
-void Var::unset() { m_isset = false; }
+void Var::unset() { set_flag(FLAG_ISSET, false); }
 
 const Var* Var::enqa(Varcode code) const
 {
-    for (const Var* cur = m_attrs; cur && cur->code() <= code;
-         cur            = cur->m_attrs)
+    for (const Var* cur = next_attr(); cur && cur->code() <= code;
+         cur            = cur->next_attr())
         if (cur->code() == code)
             return cur;
     return nullptr;
 }
 
-void Var::seta(const Var& attr) { seta(unique_ptr<Var>(new Var(attr))); }
+void Var::seta(const Var& attr)
+{
+    Var& dest = obtain_attr(attr.m_info);
+    if (&dest != &attr)
+        dest.copy_value(attr);
+}
+
+void Var::seta(Var&& attr)
+{
+    Var& dest = obtain_attr(attr.m_info);
+    if (&dest != &attr)
+        dest.move_value(attr);
+}
 
-void Var::seta(Var&& attr) { seta(unique_ptr<Var>(new Var(attr))); }
+void Var::seta(unique_ptr<Var>&& attr) { seta(std::move(*attr)); }
 
-void Var::seta(unique_ptr<Var>&& attr)
+Var& Var::obtain_attr(Varinfo info)
 {
-    // Ensure that the attribute does not have attributes of its own
-    attr->clear_attrs();
+    AttrBlock* block = attr_block();
 
-    if (!m_attrs || m_attrs->code() > attr->code())
+    // Look for the attribute, or for the one after which to insert it
+    Var* prev = nullptr;
+    for (Var* cur = block ? block->first : nullptr;
+         cur && cur->code() <= info->code; cur = AttrBlock::following(*cur))
     {
-        // Append / insert
-        attr->m_attrs = m_attrs;
-        m_attrs       = attr.release();
+        if (cur->code() == info->code)
+        {
+            // Replace the existing one, dropping storage that does not fit
+            if (cur->m_info != info)
+            {
+                cur->deallocate();
+                cur->m_info = info;
+            }
+            return *cur;
+        }
+        prev = cur;
+    }
+
+    // Attributes are never moved, to keep pointers to them valid: use a free
+    // slot, or chain a new block if there are none
+    Var* attr         = nullptr;
+    AttrBlock* last   = nullptr;
+    unsigned capacity = 0;
+    for (AttrBlock* b = block; b && !attr; b = b->next_block)
+    {
+        attr = b->take_slot();
+        capacity += b->capacity;
+        last = b;
     }
-    else if (m_attrs->code() == attr->code())
+    if (!attr)
     {
-        // Replace existing
-        attr->m_attrs      = m_attrs->m_attrs;
-        Var* old_attrs     = m_attrs;
-        m_attrs            = attr.release();
-        old_attrs->m_attrs = nullptr;
-        delete old_attrs;
+        // Variables usually have a single attribute, or a few quality flags
+        AttrBlock* added =
+            AttrBlock::create(std::min(capacity + 1, AttrBlock::max_capacity));
+        if (last)
+            last->next_block = added;
+        else
+        {
+            block = added;
+            set_attrs_ptr(block, true);
+        }
+        attr = added->take_slot();
     }
+
+    new (attr) Var(info);
+    attr->set_attrs_ptr(prev ? AttrBlock::following(*prev) : block->first,
+                        false);
+    if (prev)
+        prev->set_attrs_ptr(attr, false);
     else
-        // Recursively proceed along the chain
-        m_attrs->seta(move(attr));
+        block->first = attr;
+    return *attr;
 }
 
 void Var::unseta(Varcode code)
 {
-    if (!m_attrs || m_attrs->code() > code)
-        // Past the end, nothing to do
+    AttrBlock* block = attr_block();
+    if (!block)
         return;
-    else if (m_attrs->code() == code)
+
+    Var* prev = nullptr;
+    Var* cur  = block->first;
+    while (cur && cur->code() < code)
     {
-        // Got the right item, unlink and delete it
-        Var* old_attrs     = m_attrs;
-        m_attrs            = m_attrs->m_attrs;
-        old_attrs->m_attrs = nullptr;
-        delete old_attrs;
+        prev = cur;
+        cur  = AttrBlock::following(*cur);
     }
+    if (!cur || cur->code() != code)
+        return;
+
+    // Unlink the attribute, leaving the others where they are
+    if (prev)
+        prev->set_attrs_ptr(AttrBlock::following(*cur), false);
     else
-        // Recursively proceed along the chain
-        m_attrs->unseta(code);
+        block->first = AttrBlock::following(*cur);
+    if (!block->first)
+    {
+        clear_attrs();
+        return;
+    }
+    for (AttrBlock* b = block; !b->free_slot(cur); b = b->next_block)
+        ;
 }
 
-const Var* Var::next_attr() const { return m_attrs; }
+const Var* Var::next_attr() const
+{
+    if (const AttrBlock* block = attr_block())
+        return block->first;
+    return static_cast<const Var*>(attrs_ptr());
+}
 
 void Var::setval(const Var& src)
 {
@@ -758,9 +959,22 @@ void Var::setval(const Var& src)
 
 void Var::setattrs(const Var& src)
 {
+    if (&src == this)
+        return;
+    const AttrBlock* src_block = src.attr_block();
     clear_attrs();
-    if (src.m_attrs)
-        m_attrs = new Var(*src.m_attrs);
+    if (!src_block)
+        return;
+
+    // Make room for all the attributes in a single block
+    unsigned count = 0;
+    for (const Var* a = src_block->first; a; a = a->next_attr())
+        ++count;
+    set_attrs_ptr(
+        AttrBlock::create(std::min(count, AttrBlock::max_capacity)), true);
+
+    for (const Var* a = src_block->first; a; a = a->next_attr())
+        obtain_attr(a->m_info).copy_value(*a);
 }
 
 std::string Var::format(const char* ifundef) const
@@ -774,12 +988,12 @@ std::string Var::format(const char* ifundef) const
             for (unsigned i = 0; i < info()->len; ++i)
             {
                 char buf[4];
-                snprintf(buf, 4, "%02hhX", ((uint8_t*)m_value.c)[i]);
+                snprintf(buf, 4, "%02hhX", ((const uint8_t*)value_buf())[i]);
                 res += buf;
             }
             return res;
         }
-        case Vartype::String:  return m_value.c;
+        case Vartype::String:  return value_buf();
         case Vartype::Integer:
         case Vartype::Decimal: {
             Varinfo i = info();
@@ -802,9 +1016,9 @@ void Var::format(FILE* out, const char* ifundef) const
     {
         case Vartype::Binary:
             for (unsigned i = 0; i < info()->len; ++i)
-                fprintf(out, "%02hhX", ((uint8_t*)m_value.c)[i]);
+                fprintf(out, "%02hhX", ((const uint8_t*)value_buf())[i]);
             return;
-        case Vartype::String:  fputs(m_value.c, out); return;
+        case Vartype::String:  fputs(value_buf(), out); return;
         case Vartype::Integer:
         case Vartype::Decimal: {
             Varinfo i = info();
@@ -908,7 +1122,7 @@ unsigned Var::diff(const Var& var) const
                             var.info()->bit_len);
                 return 1;
             }
-            if (memcmp(m_value.c, var.m_value.c, m_info->len) != 0)
+            if (memcmp(value_buf(), var.value_buf(), m_info->len) != 0)
             {
                 string dump1 = format();
                 string dump2 = var.format();
@@ -920,12 +1134,12 @@ unsigned Var::diff(const Var& var) const
             }
             break;
         case Vartype::String:
-            if (strcmp(m_value.c, var.m_value.c) != 0)
+            if (strcmp(value_buf(), var.value_buf()) != 0)
             {
                 notes::logf("[%d%02d%03d %s] values differ: first is \"%s\", "
                             "second is \"%s\"\n",
-                            WR_VAR_FXY(code()), m_info->desc, m_value.c,
-                            var.m_value.c);
+                            WR_VAR_FXY(code()), m_info->desc, value_buf(),
+                            var.value_buf());
                 return 1;
             }
             break;
@@ -952,9 +1166,9 @@ unsigned Var::diff(const Var& var) const
             break;
     }
 
-    if ((m_attrs != 0) != (var.m_attrs != 0))
+    if ((attr_block() != nullptr) != (var.attr_block() != nullptr))
     {
-        if (m_attrs)
+        if (attr_block())
         {
             notes::logf("[%d%02d%03d %s] attributes differ: first has "
                         "attributes, second does not\n",
@@ -1,6 +1,7 @@
 #ifndef WREPORT_VAR_H
 #define WREPORT_VAR_H
 
+#include <cstdint>
 #include <cstdio>
 #include <memory>
 #include <string>
@@ -21,15 +22,12 @@ namespace wreport {
  *     data as specified by the Varinfo
  * \li zero or more attributes, represented by other wreport::Var objects
  */
-class Var
+class alignas(8) Var
 {
 protected:
     /// Metadata about the variable
     Varinfo m_info;
 
-    /// True if the variable is set, false otherwise
-    bool m_isset;
-
     /**
      * Value of the variable
      *
@@ -40,18 +38,133 @@ protected:
      *
      * For binary values, it is a raw buffer where the first m_info->bit_len
      * bits are the binary value, and the rest is set to 0.
+     *
+     * String and binary values that fit, including the trailing 0, are stored
+     * inline in s, and the others are allocated on the heap, or in the current
+     * Arena, and pointed to by c. Use value_buf() to access them.
      */
     union {
-        int32_t i;
         char* c;
+        int32_t i;
+        char s[16];
     } m_value;
 
-    /// Attribute list (ordered by Varcode)
-    Var* m_attrs;
+    /**
+     * Attributes, and state flags of the variable.
+     *
+     * The flags are stored in the low bits, which are always 0 in a pointer to
+     * a Var. The rest is 0 if there is nothing to point to.
+     *
+     * The attributes of a variable are stored in a chain of AttrBlock, and
+     * m_attrs points to the first one, with FLAG_ATTR_BLOCK set. Attributes
+     * are never moved once stored, and each of them points to the next one in
+     * Varcode order, so that they can be iterated with next_attr().
+     */
+    uintptr_t m_attrs;
+
+    /// Flag in m_attrs: the variable is set
+    static const uintptr_t FLAG_ISSET = 1;
+
+    /**
+     * Flag in m_attrs: the value is allocated on the heap, and owned by the
+     * variable.
+     *
+     * It is not set for values stored inline or allocated in an Arena, which
+     * need no cleanup.
+     */
+    static const uintptr_t FLAG_VALUE_ON_HEAP = 2;
+
+    /**
+     * Flag in m_attrs: it points to the AttrBlock with the attributes of this
+     * variable, instead of to the next attribute of the variable this one is
+     * an attribute of
+     */
+    static const uintptr_t FLAG_ATTR_BLOCK = 4;
+
+    /// Bits of m_attrs used for flags
+    static const uintptr_t FLAG_MASK = 7;
+
+    /// Storage for the attributes of a variable
+    struct AttrBlock;
+
+    /// Check a flag in m_attrs
+    bool has_flag(uintptr_t flag) const { return m_attrs & flag; }
+
+    /// Set or clear a flag in m_attrs
+    void set_flag(uintptr_t flag, bool value)
+    {
+        if (value)
+            m_attrs |= flag;
+        else
+            m_attrs &= ~flag;
+    }
+
+    /// Return the pointer stored in m_attrs
+    void* attrs_ptr() const
+    {
+        return reinterpret_cast<void*>(m_attrs & ~FLAG_MASK);
+    }
+
+    /**
+     * Set the pointer stored in m_attrs, and FLAG_ATTR_BLOCK according to
+     * \a block, preserving the other flags
+     */
+    void set_attrs_ptr(void* ptr, bool block)
+    {
+        m_attrs = reinterpret_cast<uintptr_t>(ptr) |
+                  (m_attrs & (FLAG_ISSET | FLAG_VALUE_ON_HEAP)) |
+                  (block ? FLAG_ATTR_BLOCK : 0);
+    }
+
+    /// Return the storage of the attributes, or nullptr if there are none
+    AttrBlock* attr_block() const
+    {
+        return has_flag(FLAG_ATTR_BLOCK) ? static_cast<AttrBlock*>(attrs_ptr())
+                                         : nullptr;
+    }
+
+    /// Check if string or binary values of \a info are stored inline
+    static bool stores_inline(Varinfo info)
+    {
+        return info->len < sizeof(m_value.s);
+    }
+
+    /// Access the buffer of a string or binary value
+    char* value_buf()
+    {
+        return stores_inline(m_info) ? m_value.s : m_value.c;
+    }
+
+    /// Access the buffer of a string or binary value
+    const char* value_buf() const
+    {
+        return stores_inline(m_info) ? m_value.s : m_value.c;
+    }
 
     /// Make sure that m_value is allocated. It does nothing if it already is.
     void allocate();
 
+    /// Free the heap-allocated value, if any, and reset m_value
+    void deallocate();
+
+    /// Free the heap-allocated value and the attributes
+    void release();
+
+    /**
+     * Take the attributes of \a var, which is left without attributes.
+     *
+     * Attributes allocated in an Arena are copied if no arena is active. If
+     * \a var is itself an attribute, it has no attributes to take, and the
+     * rest of the attributes it belongs to are left where they are.
+     */
+    void move_attrs(Var& var);
+
+    /**
+     * Return the attribute with the code of \a info, adding it unset if it
+     * does not exist yet
+     */
+    Var& obtain_attr(Varinfo info);
+
     /// Copy the value from var. var is assumed to have the same varinfo as us.
     void copy_value(const Var& var);
     /// Move the value from var. var is assumed to have the same varinfo as us.
@@ -117,7 +230,13 @@ public:
      */
     Var(Var&& var);
 
-    ~Var();
+    ~Var()
+    {
+        // Variables with their value inline or in an Arena, and without
+        // attributes, are destroyed without calling into the library
+        if (m_attrs & (FLAG_VALUE_ON_HEAP | FLAG_ATTR_BLOCK))
+            release();
+    }
 
     /// Assignment
     Var& operator=(const Var& var);
@@ -146,7 +265,7 @@ public:
     Varinfo info() const throw() { return m_info; }
 
     /// @returns true if the variable is defined, else false
-    bool isset() const throw() { return m_isset; }
+    bool isset() const throw() { return has_flag(FLAG_ISSET); }
 
     /**
      * Get the value as an integer.
@@ -311,8 +430,8 @@ public:
      * wreport::Varcode will be replaced.
      *
      * @param attr
-     *   The attribute to add.  It will be used directly, and var will take care
-     * of its memory management.
+     *   The attribute to add. Its value will be moved inside the destination
+     *   attribute, and attr will be deallocated.
      */
     void seta(std::unique_ptr<Var>&& attr);
 
@@ -7,9 +7,10 @@
 
 #include "vartable.h"
 #include "error.h"
+#include "internals/snapshot_cache.h"
+#include "internals/tablecache.h"
 #include "internals/tabledir.h"
 #include "internals/vartable.h"
-#include <map>
 
 using namespace std;
 
@@ -29,17 +30,12 @@ const Vartable* Vartable::load_bufr(const std::string& pathname)
 
 const Vartable* Vartable::load_bufr(const std::filesystem::path& pathname)
 {
-    static std::map<std::filesystem::path, vartable::Bufr*>* tables = 0;
-    if (!tables)
-        tables = new std::map<std::filesystem::path, vartable::Bufr*>;
+    // Allocated and never freed, as tables are used until program exit
+    static auto* tables =
+        new SnapshotCache<std::filesystem::path, const Vartable*>;
 
-    // Return it from cache if we have it
-    auto i = tables->find(pathname);
-    if (i != tables->end())
-        return i->second;
-
-    // Else, instantiate it
-    return (*tables)[pathname] = new vartable::Bufr(pathname);
+    return tables->get(pathname,
+                       [&] { return new vartable::Bufr(pathname); });
 }
 
 const Vartable* Vartable::load_crex(const char* pathname)
@@ -54,17 +50,37 @@ const Vartable* Vartable::load_crex(const std::string& pathname)
 
 const Vartable* Vartable::load_crex(const std::filesystem::path& pathname)
 {
-    static std::map<std::filesystem::path, vartable::Crex*>* tables = 0;
-    if (!tables)
-        tables = new std::map<std::filesystem::path, vartable::Crex*>;
+    // Allocated and never freed, as tables are used until program exit
+    static auto* tables =
+        new SnapshotCache<std::filesystem::path, const Vartable*>;
 
-    // Return it from cache if we have it
-    auto i = tables->find(pathname);
-    if (i != tables->end())
-        return i->second;
+    return tables->get(pathname,
+                       [&] { return new vartable::Crex(pathname); });
+}
 
-    // Else, instantiate it
-    return (*tables)[pathname] = new vartable::Crex(pathname);
+void Vartable::compile(const std::filesystem::path& pathname)
+{
+    tablecache::Writer writer(pathname, tablecache::Kind::B,
+                              vartable::compiled_layout);
+
+    vartable::Bufr bufr(pathname, false);
+    writer.add_section(0, bufr.entries, bufr.size, sizeof(_Varinfo));
+
+    // Tables without CREX information get an empty CREX section
+    std::unique_ptr<vartable::Crex> crex;
+    try
+    {
+        crex.reset(new vartable::Crex(pathname, false));
+    }
+    catch (error_consistency&)
+    {
+    }
+    if (crex)
+        writer.add_section(1, crex->entries, crex->size, sizeof(_Varinfo));
+    else
+        writer.add_section(1, nullptr, 0, sizeof(_Varinfo));
+
+    writer.write();
 }
 
 const Vartable* Vartable::get_bufr(const BufrTableID& id)
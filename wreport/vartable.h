@@ -101,6 +101,15 @@ public:
     static const Vartable* load_crex(const std::filesystem::path& pathname);
     static const Vartable* load_crex(const char* pathname);
 
+    /**
+     * Write a compiled version of the B table at \a pathname.
+     *
+     * load_bufr() and load_crex() memory map the compiled version and use it
+     * in place instead of parsing the text table, as long as the text table
+     * does not change.
+     */
+    static void compile(const std::filesystem::path& pathname);
+
     /// Find a BUFR table
     static const Vartable* get_bufr(const BufrTableID& id);
 
@@ -0,0 +1,109 @@
+#include "bulletin.h"
+#include "tests.h"
+#include "visitor.h"
+
+using namespace wreport;
+using namespace wreport::tests;
+using namespace std;
+
+namespace {
+
+/// Rebuild the subsets from the visitor notifications
+struct Collect : public DecodeVisitor
+{
+    std::vector<std::vector<Var>> subsets;
+    std::vector<unsigned> begun;
+    std::vector<unsigned> ended;
+
+    void begin_subset(unsigned subset) override
+    {
+        begun.push_back(subset);
+        if (subsets.size() <= subset)
+            subsets.resize(subset + 1);
+    }
+
+    void value(unsigned subset, const Var& var) override
+    {
+        subsets[subset].push_back(var);
+    }
+
+    void attribute(unsigned subset, unsigned pos, const Var& attr) override
+    {
+        subsets[subset][pos].seta(attr);
+    }
+
+    void end_subset(unsigned subset) override { ended.push_back(subset); }
+};
+
+class Tests : public TestCase
+{
+    using TestCase::TestCase;
+
+    void register_tests() override
+    {
+        add_method("decode", []() {
+            // The visitor receives the same values as decoding into subsets
+            unsigned tested_compressed   = 0;
+            unsigned tested_uncompressed = 0;
+            for (const auto& fname : all_test_files("bufr"))
+            {
+                std::string raw = slurpfile(fname);
+                std::unique_ptr<BufrBulletin> msg;
+                try
+                {
+                    msg = BufrBulletin::decode(raw, fname.c_str());
+                }
+                catch (std::exception&)
+                {
+                    continue;
+                }
+
+                WREPORT_TEST_INFO(info);
+                info() << fname;
+
+                // Declared before the visitor, as the variables it collects
+                // may use B table entries owned by the bulletin
+                std::unique_ptr<BufrBulletin> head;
+                Collect visitor;
+                head = wcallchecked(
+                    BufrBulletin::decode(raw, visitor, fname.c_str()));
+                wassert_true(head->subsets.empty());
+                wassert(actual(head->datadesc.size()) ==
+                        msg->datadesc.size());
+                wassert(actual(visitor.begun.size()) == msg->subsets.size());
+                wassert(actual(visitor.ended.size()) == msg->subsets.size());
+                wassert(actual(visitor.subsets.size()) ==
+                        msg->subsets.size());
+
+                for (unsigned s = 0; s < msg->subsets.size(); ++s)
+                {
+                    const Subset& subset = msg->subsets[s];
+                    const auto& got      = visitor.subsets[s];
+                    wassert(actual(got.size()) == subset.size());
+                    for (unsigned i = 0; i < subset.size(); ++i)
+                        wassert_true(got[i] == subset[i]);
+                }
+
+                if (msg->compression)
+                    ++tested_compressed;
+                else
+                    ++tested_uncompressed;
+            }
+            wassert(actual(tested_compressed) > 0u);
+            wassert(actual(tested_uncompressed) > 0u);
+        });
+
+        add_method("order", []() {
+            std::unique_ptr<BufrBulletin> head;
+            Collect visitor;
+            std::string raw = slurpfile("bufr/obs0-1.22.bufr");
+            head            = BufrBulletin::decode(raw, visitor);
+            wassert(actual(visitor.begun.size()) == 1u);
+            wassert(actual(visitor.begun[0]) == 0u);
+            wassert(actual(visitor.ended[0]) == 0u);
+            wassert_false(visitor.subsets[0].empty());
+        });
+    }
+} test("visitor");
+
+} // namespace
@@ -0,0 +1,15 @@
+#include "visitor.h"
+
+namespace wreport {
+
+DecodeVisitor::~DecodeVisitor() {}
+
+void DecodeVisitor::begin_subset(unsigned subset) {}
+
+void DecodeVisitor::attribute(unsigned subset, unsigned pos, const Var& attr)
+{
+}
+
+void DecodeVisitor::end_subset(unsigned subset) {}
+
+} // namespace wreport
@@ -0,0 +1,58 @@
+#ifndef WREPORT_VISITOR_H
+#define WREPORT_VISITOR_H
+
+#include <wreport/var.h>
+
+namespace wreport {
+
+/**
+ * Receive the contents of a BUFR data section while it is decoded.
+ *
+ * This can be used with BufrBulletin::decode(const std::string&,
+ * DecodeVisitor&, const char*, size_t) to process the decoded values without
+ * storing them into subsets: memory usage does not depend on the size of the
+ * message.
+ *
+ * Variables are identified by their position in the subset, counting all the
+ * variables notified with value(), in the same way as they would be stored in
+ * a Subset.
+ *
+ * In uncompressed messages, subsets are decoded one after the other. In
+ * compressed messages, all subsets are decoded at the same time:
+ * begin_subset() is called for all subsets before the first value, each
+ * variable is notified for all subsets in turn, and end_subset() is called
+ * for all subsets after the last value.
+ */
+class DecodeVisitor
+{
+public:
+    virtual ~DecodeVisitor();
+
+    /// Start decoding the subset with the given index
+    virtual void begin_subset(unsigned subset);
+
+    /**
+     * Notify a decoded variable.
+     *
+     * \a var is only valid for the duration of the call. Its Varinfo describes
+     * the variable, including the changes made by C modifiers, and may be
+     * owned by the tables of the returned bulletin: copies of \a var must not
+     * outlive it. It can be unset, if the value is missing.
+     */
+    virtual void value(unsigned subset, const Var& var) = 0;
+
+    /**
+     * Notify an attribute of the variable at position \a pos in the subset.
+     *
+     * \a attr is only valid for the duration of the call. Missing attributes
+     * are not notified.
+     */
+    virtual void attribute(unsigned subset, unsigned pos, const Var& attr);
+
+    /// Finish decoding the subset with the given index
+    virtual void end_subset(unsigned subset);
+};
+
+} // namespace wreport
+
+#endif